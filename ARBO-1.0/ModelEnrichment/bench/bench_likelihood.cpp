@@ -0,0 +1,201 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * Micro-benchmark of one likelihood evaluation (forward solve plus
+ * misfit, as in src/likelihood.cpp but without QUESO). Reports the
+ * number of heap allocations and the wall time per call, and the time
+ * per right-hand side call of the generic zikaFunction against the
+ * kernel picked by zikaSelectKernel, and the right-hand side calls per
+ * solve on the weekly and a daily grid, stopping at every output time
+ * against dense output. Last, the steps and rejected steps per solve over
+ * the same proposals, with and without per-component tolerances and the
+ * smooth positivity ramp.
+ *
+ *   make bench
+ *   ./bin/bench_likelihood [n_calls] [inad_type] [warm_start] [dense_output]
+ *-----------------------------------------------------------------*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <sys/time.h>
+#include "model.h"
+#include "dynamics_info.h"
+
+//count every malloc/calloc/realloc made by the process (C++ operator new
+//and GSL both end up here)
+static unsigned long n_allocs = 0;
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) { n_allocs++; return __libc_malloc(size); }
+void* calloc(size_t n, size_t size) { n_allocs++; return __libc_calloc(n, size); }
+void* realloc(void* ptr, size_t size) { n_allocs++; return __libc_realloc(ptr, size); }
+}
+
+//right-hand side calls made by the solver, counted through a wrapper of
+//the selected kernel
+static unsigned long n_rhs_calls = 0;
+static int (*countedRhs)(double, const double[], double[], void*) = NULL;
+
+static int countingRhs(double t, const double Y[], double dYdt[], void* params)
+{
+  n_rhs_calls++;
+  return countedRhs(t, Y, dYdt, params);
+}
+
+int main(int argc, char* argv[])
+{
+  unsigned int n_calls = (argc > 1) ? atoi(argv[1]) : 2000;
+  unsigned int inad_type = (argc > 2) ? atoi(argv[2]) : 1;
+  unsigned int warm_start = (argc > 3) ? atoi(argv[3]) : 0;
+  unsigned int dense_output = (argc > 4) ? atoi(argv[4]) : 0;
+
+  unsigned int n_s = 7;
+  unsigned int dim = n_s + 1;
+  unsigned int n_weeks = 52;
+  double var = 25000000;
+  unsigned int params_factor = 1;
+  if( inad_type == 1 ) { params_factor = 2;}
+  if( inad_type == 2 ) { params_factor = 6;}
+  if( inad_type == 3 ) { params_factor = 2 * n_s;}
+  unsigned int n_params = params_factor * n_s;
+
+  //read in data points, same layout as in src/compute.cpp
+  std::vector<double> times(n_weeks, 0.);
+  std::vector<double> cum_sum_cases(n_weeks, 0.);
+  FILE *dataFile = fopen("./inputs/data.txt","r");
+  if (dataFile == NULL) {
+    std::printf("could not open ./inputs/data.txt\n");
+    return 1;
+  }
+  double tmpWeeks, tmpx, sum = 0.;
+  unsigned int numLines = 0;
+  while (numLines < n_weeks && fscanf(dataFile,"%lf %lf ", &tmpWeeks, &tmpx) == 2) {
+    times[numLines] = 7 * tmpWeeks;
+    sum += tmpx;
+    cum_sum_cases[numLines] = sum;
+    numLines++;
+  }
+  fclose(dataFile);
+
+  //S_h, E_h, I_h, R_h, S_v E_v, I_v, C
+  std::vector<double> initialValues(dim, 0.);
+  initialValues[0] = 206.e6 - 8201.0 - 8201.0 - 29639.0;
+  initialValues[1] = 8201.0;
+  initialValues[2] = 8201.0;
+  initialValues[3] = 29639.0;
+  initialValues[4] = 1. - 0.00044;
+  initialValues[5] = 0.00022;
+  initialValues[6] = 0.00022;
+  initialValues[7] = 8201.0;
+
+  //the context a chain builds once
+  std::vector<double> deltas(n_params, 0.);
+  dynamics_info dyn(n_s, n_weeks, inad_type, params_factor, deltas);
+  zikaSelectKernel(&dyn);
+  dyn.WarmStart = warm_start;
+  dyn.WarmStartRadius = 0.05;
+  dyn.DenseOutput = dense_output;
+  std::vector<double> returnValues(n_weeks * dim, 0.);
+
+  double misfitValue = 0.;
+  unsigned long allocsBefore = n_allocs;
+  struct timeval start, stop;
+  gettimeofday(&start, NULL);
+  for (unsigned int k = 0; k < n_calls; k++){
+    //small deterministic proposals around zero
+    for (unsigned int i = 0; i < n_params; i++){
+      dyn.Deltas[i] = 1.e-3 * std::sin(1. + i + 0.1 * k);
+    }
+    zikaComputeModel(initialValues, times, &dyn, returnValues);
+    for (unsigned int j = 0; j < n_weeks; j++){
+      double diff = returnValues[dim * j + 7] - cum_sum_cases[j];
+      misfitValue += diff * diff / var;
+    }
+  }
+  gettimeofday(&stop, NULL);
+  unsigned long allocs = n_allocs - allocsBefore;
+  double seconds = (stop.tv_sec - start.tv_sec) + 1.e-6 * (stop.tv_usec - start.tv_usec);
+
+  std::printf("inad_type        = %u\n", inad_type);
+  std::printf("warm start       = %u\n", warm_start);
+  std::printf("dense output     = %u\n", dense_output);
+  std::printf("calls            = %u\n", n_calls);
+  std::printf("allocs per call  = %.2f\n", (double) allocs / n_calls);
+  std::printf("usec per call    = %.2f\n", 1.e6 * seconds / n_calls);
+
+  //right-hand side alone, on the initial state
+  unsigned int n_rhs = 100 * n_calls;
+  double Y[8], dYdt[8];
+  double rhsSum = 0.;
+  double usecRhs[2];
+  zika_system system = { &dyn, &dyn.Deltas[0] };
+  for (unsigned int r = 0; r < 2; r++){
+    int (*rhs)(double, const double[], double[], void*) = (r == 0) ? zikaFunction : dyn.Rhs;
+    gettimeofday(&start, NULL);
+    for (unsigned int k = 0; k < n_rhs; k++){
+      for (unsigned int i = 0; i < dim; i++){
+        Y[i] = initialValues[i] * (1. + 1.e-9 * (k % 7));
+      }
+      rhs(0., Y, dYdt, &system);
+      rhsSum += dYdt[1];
+    }
+    gettimeofday(&stop, NULL);
+    usecRhs[r] = (stop.tv_sec - start.tv_sec) + 1.e-6 * (stop.tv_usec - start.tv_usec);
+  }
+  std::printf("ns per RHS call  = %.2f (generic), %.2f (specialized)\n",
+      1.e9 * usecRhs[0] / n_rhs, 1.e9 * usecRhs[1] / n_rhs);
+
+  //right-hand side calls of one solve, weekly and daily outputs
+  std::vector<double> days((unsigned int) (times[n_weeks - 1] - times[0]) + 1, 0.);
+  for (unsigned int i = 0; i < days.size(); i++){
+    days[i] = times[0] + i;
+  }
+  std::vector<double> dailyValues(days.size() * dim, 0.);
+  countedRhs = dyn.Rhs;
+  dyn.Rhs = countingRhs;
+  dyn.WarmStart = 0;
+  for (unsigned int r = 0; r < 2; r++){
+    const std::vector<double> & grid = (r == 0) ? times : days;
+    std::vector<double> & values = (r == 0) ? returnValues : dailyValues;
+    unsigned long calls[2];
+    for (unsigned int dense = 0; dense < 2; dense++){
+      dyn.DenseOutput = dense;
+      n_rhs_calls = 0;
+      zikaComputeModel(initialValues, grid, &dyn, values);
+      calls[dense] = n_rhs_calls;
+    }
+    std::printf("RHS per solve    = %lu (stops), %lu (dense), %u outputs\n",
+        calls[0], calls[1], (unsigned int) grid.size());
+  }
+  dyn.Rhs = countedRhs;
+  dyn.DenseOutput = dense_output;
+
+  //steps per solve, plain/scaled tolerance x clamp/smooth ramp
+  for (unsigned int c = 0; c < 4; c++){
+    dyn.ScaledTolerance = c & 1;
+    dyn.PositivityWidth = (c & 2) ? 1.e-8 : 0.;
+    zikaResetSolverStats();
+    for (unsigned int k = 0; k < n_calls; k++){
+      for (unsigned int i = 0; i < n_params; i++){
+        dyn.Deltas[i] = 1.e-3 * std::sin(1. + i + 0.1 * k);
+      }
+      zikaComputeModel(initialValues, times, &dyn, returnValues);
+    }
+    const zika_solver_stats stats = zikaSolverStats();
+    std::printf("steps per solve  = %.1f, %.1f rejected (%s tolerance, %s)\n",
+        (double) stats.Steps / stats.Solves, (double) stats.Rejected / stats.Solves,
+        (c & 1) ? "scaled" : "plain", (c & 2) ? "smooth ramp" : "clamp");
+  }
+  std::printf("(checksum %g %g)\n", misfitValue, rhsSum);
+  return 0;
+}
@@ -0,0 +1,31 @@
+#!/bin/bash
+
+# Checks that delayed acceptance samples the posterior of plain MH: runs
+# bin/zika_ip with 'zika_sampler = threads' then 'delayed', with the seed,
+# chains and chain length of inputs/zika.inp, and compares the marginals
+# of the two filtered chains with postprocessing/compare_chains.py (means
+# in batch-means standard errors, standard deviations, Kolmogorov-Smirnov
+# distance). inputs/zika.inp is restored afterwards. Exits with 1 if a
+# delta differs at the 1% level.
+#
+# usage: bench/compare_delayed.sh [procs] [mpirun options...]
+
+procs=${1:-1}
+shift
+backup=outputData/zika.inp.compare_delayed
+
+mkdir -p outputData
+cp inputs/zika.inp $backup
+trap 'cp $backup inputs/zika.inp; rm -f $backup' EXIT
+
+for sampler in threads delayed; do
+  sed -E -e "s/^( *zika_sampler *=).*/\1 $sampler/" \
+         -e "s/^( *zika_binaryOutput *=).*/\1 1/" $backup > inputs/zika.inp
+  rm -rf outputData/sip_* outputData/sfp_*
+  mpirun -np $procs "$@" ./bin/zika_ip inputs/mhInput.inp > /dev/null || exit 1
+  cp outputData/sip_filtered_chain.zbin outputData/compare_$sampler.zbin
+done
+
+chains=$(awk -F= '/^ *zika_nChains/ { print $2 + 0 }' $backup)
+python3 postprocessing/compare_chains.py outputData/compare_threads.zbin \
+  outputData/compare_delayed.zbin $((procs * ${chains:-1}))
@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# Weak scaling of the population sampler: runs bin/zika_ip on 1 to 64
+# processes (same chains per process) and prints, for each run, the
+# sampling rate and its efficiency against the 1 process run.
+# inputs/zika.inp must set 'zika_sampler = population'.
+#
+# usage: bench/scaling.sh [max_procs] [mpirun options...]
+
+if ! grep -Eq '^ *zika_sampler *= *population' inputs/zika.inp; then
+  echo "set 'zika_sampler = population' in inputs/zika.inp first"
+  exit 1
+fi
+
+max_procs=${1:-64}
+shift
+report=outputData/sip_population_scaling.txt
+
+mkdir -p outputData
+rm -f $report
+p=1
+while [ $p -le $max_procs ]; do
+  #the outputs of the last run, all but the report every run adds a line to
+  find outputData -maxdepth 1 \( -name 'sip_*' -o -name 'sfp_*' \) \
+    ! -name "${report##*/}" -exec rm -rf {} +
+  mpirun -np $p "$@" ./bin/zika_ip inputs/mhInput.inp > /dev/null
+  p=$((2 * p))
+done
+
+echo "# procs  temps  wall[s]  steps/s  efficiency  busy  max_wait[s]"
+awk 'NR == 1 { base = $5 }
+     { printf "%7d %6d %8.2f %8.1f %11.3f %5.3f %11.2e\n", $1, $2, $4, $5, $5 / ($1 * base), $6, $7 }' $report
+
+exit 0
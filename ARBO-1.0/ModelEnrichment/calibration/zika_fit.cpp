@@ -0,0 +1,132 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Multistart least-squares calibration of the SEIR-SEI model
+ * (src/calibration.cpp), in place of
+ * CalibrationProblem/main_SEIR_SEI_TRR_example*.m: a bound-constrained
+ * Levenberg-Marquardt fit with exact sensitivities from every start of
+ * a Latin hypercube, the starts spread over the OpenMP threads. Prints
+ * the best fit and the distinct minima found, and writes
+ * <fit_output>_starts.txt, the result of every start, and
+ * <fit_output>_best.txt, the best unknowns and its weekly new cases
+ * against the data.
+ *
+ *   make fit
+ *   OMP_NUM_THREADS=8 ./bin/zika_fit [inputs/fit.inp]
+ *-----------------------------------------------------------------*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include "calibration.h"
+
+static bool zikaFitByCost(const fit_result* a, const fit_result* b)
+{
+  return a->Cost < b->Cost;
+}
+
+int main(int argc, char* argv[])
+{
+  const char * fileName = (argc > 1) ? argv[1] : "./inputs/fit.inp";
+  fit_problem problem(fileName);
+  if (problem.NewCases.size() < 2) return 1;
+  if (!problem.Ok) {
+    printf("WARNING: some lines of %s were ignored\n", fileName);
+  }
+  printf("Calibration of the SEIR-SEI model to %u weeks of %s: %u starts, seed %llu\n",
+      (unsigned int) problem.NewCases.size(), problem.Data.c_str(), problem.Starts,
+      (unsigned long long) problem.Seed);
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const std::vector<fit_result> results = zikaFitMultistart(problem);
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  unsigned int solves = 0, failed = 0;
+  std::vector<const fit_result *> sorted;
+  for (unsigned int s = 0; s < results.size(); s++){
+    solves += results[s].Solves;
+    if (std::isfinite(results[s].Cost)) sorted.push_back(&results[s]);
+    else failed++;
+  }
+  printf("%u starts in %.3f s, %u solves, %u failed\n", problem.Starts, seconds, solves, failed);
+  if (sorted.empty()) return 1;
+  std::stable_sort(sorted.begin(), sorted.end(), zikaFitByCost);
+  const fit_result & best = *sorted[0];
+
+  printf("best cost %.9e, R0 %.6f\n", best.Cost, best.R0);
+  for (unsigned int i = 0; i < ZIKA_FIT_UNKNOWNS; i++){
+    printf("  %-7s %.9e\n", zikaFitUnknownName(i), best.X[i]);
+  }
+
+  //distinct minima: starts whose costs agree to 1e-3 end in the same one
+  printf("minima found:\n");
+  for (unsigned int a = 0; a < sorted.size(); ){
+    unsigned int b = a;
+    double r0Min = sorted[a]->R0, r0Max = sorted[a]->R0;
+    while (b < sorted.size() && sorted[b]->Cost <= sorted[a]->Cost * (1. + 1.e-3)) {
+      r0Min = std::min(r0Min, sorted[b]->R0);
+      r0Max = std::max(r0Max, sorted[b]->R0);
+      b++;
+    }
+    printf("  cost %.6e from %u starts, R0 in [%.4f, %.4f]\n", sorted[a]->Cost, b - a, r0Min, r0Max);
+    a = b;
+  }
+
+  //how well the unknowns are determined: their spread over the starts
+  //that got within 1% of the best cost
+  printf("unknowns over the starts within 1%% of the best:\n");
+  for (unsigned int i = 0; i < ZIKA_FIT_UNKNOWNS; i++){
+    double lo = best.X[i], hi = best.X[i];
+    for (unsigned int k = 1; k < sorted.size() && sorted[k]->Cost <= 1.01 * best.Cost; k++){
+      lo = std::min(lo, sorted[k]->X[i]);
+      hi = std::max(hi, sorted[k]->X[i]);
+    }
+    printf("  %-7s [%.6e, %.6e]\n", zikaFitUnknownName(i), lo, hi);
+  }
+
+  mkdir("outputData", 0755);
+  const std::string startsName = problem.Output + "_starts.txt";
+  FILE * file = fopen(startsName.c_str(), "w");
+  if (!file) {
+    printf("WARNING: could not write %s\n", startsName.c_str());
+    return 1;
+  }
+  fprintf(file, "# start converged iterations solves cost R0");
+  for (unsigned int i = 0; i < ZIKA_FIT_UNKNOWNS; i++) fprintf(file, " %s", zikaFitUnknownName(i));
+  fprintf(file, "\n");
+  for (unsigned int s = 0; s < results.size(); s++){
+    const fit_result & r = results[s];
+    fprintf(file, "%u %d %u %u %.9e %.9e", s, (int) r.Converged, r.Iterations, r.Solves, r.Cost, r.R0);
+    for (unsigned int i = 0; i < ZIKA_FIT_UNKNOWNS; i++) fprintf(file, " %.9e", r.X[i]);
+    fprintf(file, "\n");
+  }
+  fclose(file);
+
+  //the model at the best fit: the residuals are its new cases minus the data
+  std::vector<double> residuals;
+  zikaFitResiduals(problem, best.X, residuals, NULL);
+  const std::string bestName = problem.Output + "_best.txt";
+  file = fopen(bestName.c_str(), "w");
+  if (!file) {
+    printf("WARNING: could not write %s\n", bestName.c_str());
+    return 1;
+  }
+  for (unsigned int i = 0; i < ZIKA_FIT_UNKNOWNS; i++){
+    fprintf(file, "# %s = %.9e\n", zikaFitUnknownName(i), best.X[i]);
+  }
+  fprintf(file, "# R0 = %.9e\n# cost = %.9e\n# week data model\n", best.R0, best.Cost);
+  fprintf(file, "0 %.9e %.9e\n", problem.NewCases[0], problem.NewCases[0]);
+  for (unsigned int j = 1; j < problem.NewCases.size(); j++){
+    fprintf(file, "%u %.9e %.9e\n", j, problem.NewCases[j], problem.NewCases[j] + residuals[j - 1]);
+  }
+  fclose(file);
+  printf("written to %s and %s\n", startsName.c_str(), bestName.c_str());
+  return 0;
+}
@@ -0,0 +1,239 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Check of the reading of the weekly case data (src/cases.cpp), on files
+ * written to a temporary directory: a 'week cases' file as
+ * inputs/data.txt and a row of weeks and a row of cases as the series of
+ * Datasets/ (2016zika_Prob250117.dat, 2016zika_Conf250117.dat) must give
+ * the same series, and so must their layouts with two named regions.
+ * YYYYWW labels and week numbers that wrap at the end of a year must be
+ * unwrapped to consecutive weeks, a gap must be kept and warned about,
+ * and malformed files (a short row, a word, negative cases, a week out
+ * of order) must be refused with a warning. The .zbin cache must be
+ * mapped when it is newer than the file and parsed again when the file
+ * changes. Exits with 1 if any of these does not hold.
+ *
+ *   make check
+ *-----------------------------------------------------------------*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include <vector>
+#include "cases.h"
+
+//weeks of the season, as in the data
+#define __ZIKA_CHECK_WEEKS 52
+
+//files made in the temporary directory, removed at the end
+static std::vector<std::string> created;
+
+static std::string zikaCheckWrite(const std::string& dir, const char* name,
+    const std::string& text)
+{
+  const std::string path = dir + "/" + name;
+  std::ofstream file(path.c_str());
+  file << text;
+  created.push_back(path);
+  created.push_back(path + ".zbin");
+  return path;
+}
+
+//moves the modification time of path by seconds from now, so that the
+//cache is older or newer than the file whatever the clock resolution
+static void zikaCheckAge(const std::string& path, double seconds)
+{
+  struct utimbuf times;
+  times.actime = times.modtime = time(NULL) + (time_t) seconds;
+  utime(path.c_str(), &times);
+}
+
+//reads path into a new series, with what it prints in output
+static zika_case_series* zikaCheckRead(const std::string& path, const std::string& dir,
+    std::string& output)
+{
+  const std::string logName = dir + "/output.txt";
+  fflush(stdout);
+  const int saved = dup(1);
+  const int log = open(logName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  dup2(log, 1);
+  close(log);
+  zika_case_series * series = new zika_case_series(path.c_str());
+  fflush(stdout);
+  dup2(saved, 1);
+  close(saved);
+  std::ifstream file(logName.c_str());
+  std::ostringstream text;
+  text << file.rdbuf();
+  output = text.str();
+  unlink(logName.c_str());
+  return series;
+}
+
+//the series holds the given weeks and the cases of its regions
+static bool zikaCheckSeries(const zika_case_series& series, const std::vector<double>& weeks,
+    const std::vector<std::vector<double> >& cases, const std::vector<std::string>& names)
+{
+  if (!series.ok() || series.weeks() != weeks.size() || series.regions() != cases.size()) {
+    return false;
+  }
+  for (unsigned int j = 0; j < weeks.size(); j++){
+    if (series.week()[j] != weeks[j]) return false;
+  }
+  for (unsigned int k = 0; k < cases.size(); k++){
+    if (series.name(k) != names[k] || series.region(names[k]) != (int) k) return false;
+    for (unsigned int j = 0; j < weeks.size(); j++){
+      if (series.cases(k)[j] != cases[k][j]) return false;
+    }
+  }
+  return true;
+}
+
+static bool zikaCheckReport(const char* label, bool ok)
+{
+  printf("%-34s %s\n", label, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+int main()
+{
+  char tmpl[] = "/tmp/zika_check_cases.XXXXXX";
+  if (!mkdtemp(tmpl)) {
+    printf("could not make a temporary directory  FAILED\n");
+    return 1;
+  }
+  const std::string dir(tmpl);
+  bool passed = true;
+  std::string output;
+
+  //a season of probable and confirmed cases, one epidemic curve
+  std::vector<double> weeks(__ZIKA_CHECK_WEEKS);
+  std::vector<std::vector<double> > cases(2, std::vector<double>(__ZIKA_CHECK_WEEKS));
+  for (unsigned int j = 0; j < __ZIKA_CHECK_WEEKS; j++){
+    weeks[j] = j + 1;
+    cases[0][j] = std::floor(8000. * std::exp(-std::pow((j - 7.) / 10., 2))) + 69.;
+    cases[1][j] = std::floor(0.55 * cases[0][j]);
+  }
+  std::vector<std::vector<double> > prob(1, cases[0]);
+  std::vector<std::string> single(1, "cases"), named;
+  named.push_back("Prob");
+  named.push_back("Conf");
+
+  //the same season in the layouts of inputs/ and Datasets/
+  std::ostringstream dataTxt, datasets, dataNamed, datasetsNamed;
+  dataNamed << "# weekly cases\nweek\tProb\tConf\n";
+  datasetsNamed << "week";
+  for (unsigned int j = 0; j < __ZIKA_CHECK_WEEKS; j++){
+    dataTxt << weeks[j] << " " << cases[0][j] << "\n";
+    dataNamed << weeks[j] << "\t" << cases[0][j] << "\t" << cases[1][j] << "\n";
+    datasets << weeks[j] << (j + 1 < __ZIKA_CHECK_WEEKS ? "," : "\n");
+    datasetsNamed << "," << weeks[j];
+  }
+  datasetsNamed << "\r\nProb";
+  for (unsigned int j = 0; j < __ZIKA_CHECK_WEEKS; j++){
+    datasets << cases[0][j] << ",";
+    datasetsNamed << "," << cases[0][j];
+  }
+  datasets << "\n";
+  datasetsNamed << "\r\nConf";
+  for (unsigned int j = 0; j < __ZIKA_CHECK_WEEKS; j++) datasetsNamed << "," << cases[1][j];
+  datasetsNamed << "\r\n";
+
+  zika_case_series * series;
+  series = zikaCheckRead(zikaCheckWrite(dir, "data.txt", dataTxt.str()), dir, output);
+  passed &= zikaCheckReport("inputs/data.txt layout", zikaCheckSeries(*series, weeks, prob, single));
+  delete series;
+  series = zikaCheckRead(zikaCheckWrite(dir, "Prob.dat", datasets.str()), dir, output);
+  passed &= zikaCheckReport("Datasets/ layout", zikaCheckSeries(*series, weeks, prob, single));
+  delete series;
+  series = zikaCheckRead(zikaCheckWrite(dir, "named.txt", dataNamed.str()), dir, output);
+  passed &= zikaCheckReport("week per line, two named regions",
+      zikaCheckSeries(*series, weeks, cases, named));
+  delete series;
+  series = zikaCheckRead(zikaCheckWrite(dir, "named.dat", datasetsNamed.str()), dir, output);
+  passed &= zikaCheckReport("row per region, two named regions",
+      zikaCheckSeries(*series, weeks, cases, named));
+  delete series;
+
+  //the end of a year, as YYYYWW labels and as week numbers; a gap of two
+  //weeks is kept, with a warning
+  std::vector<double> wrapped(4);
+  std::vector<std::vector<double> > few(1, std::vector<double>(4));
+  for (unsigned int j = 0; j < 4; j++){
+    wrapped[j] = 51. + j;
+    few[0][j] = 10. * (j + 1);
+  }
+  series = zikaCheckRead(zikaCheckWrite(dir, "yyyyww.txt",
+      "201551 10\n201552 20\n201601 30\n201602 40\n"), dir, output);
+  passed &= zikaCheckReport("YYYYWW across a year",
+      zikaCheckSeries(*series, wrapped, few, single) && output.empty());
+  delete series;
+  series = zikaCheckRead(zikaCheckWrite(dir, "wrap.dat", "51,52,1,2\n10,20,30,40\n"), dir, output);
+  passed &= zikaCheckReport("week numbers across a year",
+      zikaCheckSeries(*series, wrapped, few, single) && output.empty());
+  delete series;
+  wrapped[2] = 55.;
+  wrapped[3] = 56.;
+  series = zikaCheckRead(zikaCheckWrite(dir, "gap.txt", "201551 10\n201552 20\n201603 30\n201604 40\n"),
+      dir, output);
+  passed &= zikaCheckReport("gap of two weeks",
+      zikaCheckSeries(*series, wrapped, few, single) &&
+      output.find("2 weeks missing between weeks 201552 and 201603") != std::string::npos);
+  delete series;
+
+  //malformed files are refused, and say where
+  static const char * malformed[][3] = {
+    { "short.txt", "1 10\n2\n3 30\n", "short.txt:2 has 1 fields instead of 2" },
+    { "word.dat", "1,2,3\n10,n/a,30\n", "'n/a' is not a number" },
+    { "negative.txt", "1 10\n2 -5\n", "negative.txt:2: -5 cases" },
+    { "order.txt", "201602 10\n201601 20\n", "week 201601 does not follow week 201602" },
+  };
+  for (unsigned int m = 0; m < sizeof(malformed) / sizeof(malformed[0]); m++){
+    series = zikaCheckRead(zikaCheckWrite(dir, malformed[m][0], malformed[m][1]), dir, output);
+    std::ostringstream label;
+    label << "malformed " << malformed[m][0];
+    passed &= zikaCheckReport(label.str().c_str(),
+        !series->ok() && output.find(malformed[m][2]) != std::string::npos &&
+        access((dir + "/" + malformed[m][0] + ".zbin").c_str(), F_OK) != 0);
+    delete series;
+  }
+
+  //the cache: written by the first read, mapped while newer than the
+  //file (a file changed behind it is not seen), parsed again once the
+  //file is newer
+  const std::string path = zikaCheckWrite(dir, "cached.txt", dataTxt.str());
+  zikaCheckAge(path, -10.);
+  series = zikaCheckRead(path, dir, output);
+  delete series;
+  const bool written = access((path + ".zbin").c_str(), R_OK) == 0;
+  zikaCheckWrite(dir, "cached.txt", "1 1\n2 2\n");
+  zikaCheckAge(path, -10.);
+  series = zikaCheckRead(path, dir, output);
+  passed &= zikaCheckReport("cache mapped while newer",
+      written && zikaCheckSeries(*series, weeks, prob, single));
+  delete series;
+  zikaCheckAge(path, 10.);
+  std::vector<double> two(2);
+  two[0] = 1.;
+  two[1] = 2.;
+  series = zikaCheckRead(path, dir, output);
+  passed &= zikaCheckReport("file parsed again once newer",
+      zikaCheckSeries(*series, two, std::vector<std::vector<double> >(1, two), single));
+  delete series;
+
+  for (unsigned int f = 0; f < created.size(); f++) unlink(created[f].c_str());
+  rmdir(dir.c_str());
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Check of the chain diagnostics (src/diagnostics.cpp) on AR(1) chains
+ * x_t = rho x_{t-1} + e_t, started from their stationary distribution,
+ * whose ESS is known: N (1 - rho) / (1 + rho) per chain of N positions,
+ * with lag 1 autocorrelation rho. The chains are fed in pieces, as the
+ * samplers do every DiagnosticsPeriod steps. Split R-hat must be close
+ * to 1, except for a delta whose chains are centered apart, where it
+ * must flag them. Exits with 1 if any diagnostic is off.
+ *
+ *   make check
+ *-----------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "diagnostics.h"
+#include "philox.h"
+
+//batch means from 32 to 64 batches per chain: a relative error of about
+//0.2 per chain, 0.1 over the four; the autocorrelation time is far
+//more accurate
+#define __ZIKA_CHECK_ESS_TOLERANCE 0.3
+#define __ZIKA_CHECK_ESS_ACF_TOLERANCE 0.1
+#define __ZIKA_CHECK_ACF1_TOLERANCE 0.01
+#define __ZIKA_CHECK_RHAT_TOLERANCE 0.01
+//chains one stationary sd apart
+#define __ZIKA_CHECK_RHAT_APART 1.1
+
+int main()
+{
+  const unsigned int n_chains = 4;
+  const unsigned int length = 200000;
+  const unsigned int period = 10000;
+  //the last delta has the coefficient of the first, and chain c centered
+  //at c stationary sds
+  static const double rhos[4] = { 0., 0.5, 0.9, 0. };
+  const unsigned int n_params = 4;
+  const unsigned int apart = 3;
+
+  std::vector<double> chains(n_chains * length * n_params);
+  for (unsigned int c = 0; c < n_chains; c++){
+    double * chain = &chains[c * length * n_params];
+    for (unsigned int i = 0; i < n_params; i++){
+      zika_philox rng(30081984, c, i);
+      const double rho = rhos[i];
+      const double sd = 1. / std::sqrt(1. - rho * rho);
+      const double center = (i == apart) ? c * sd : 0.;
+      double x = sd * rng.normal();
+      for (unsigned int t = 0; t < length; t++){
+        if (t > 0) x = rho * x + rng.normal();
+        chain[t * n_params + i] = center + x;
+      }
+    }
+  }
+
+  chain_diagnostics diagnostics(n_chains, n_params);
+  for (unsigned int done = period; done <= length; done += period){
+    for (unsigned int c = 0; c < n_chains; c++){
+      diagnostics.update(c, &chains[c * length * n_params], done);
+    }
+  }
+  std::vector<double> packed;
+  diagnostics.pack(packed);
+  chain_report report;
+  zikaCombineDiagnostics(packed, n_chains, n_params, report);
+
+  bool passed = true;
+  for (unsigned int i = 0; i < n_params; i++){
+    const double rho = rhos[i];
+    const double expected = n_chains * length * (1. - rho) / (1. + rho);
+    const double essError = std::fabs(report.Ess[i] / expected - 1.);
+    const double essAcfError = std::fabs(report.EssAcf[i] / expected - 1.);
+    const double acf1Error = std::fabs(report.Acf1[i] - rho);
+    bool ok;
+    if (i == apart) {
+      ok = report.Rhat[i] > __ZIKA_CHECK_RHAT_APART;
+    }
+    else {
+      ok = essError <= __ZIKA_CHECK_ESS_TOLERANCE && essAcfError <= __ZIKA_CHECK_ESS_ACF_TOLERANCE &&
+        acf1Error <= __ZIKA_CHECK_ACF1_TOLERANCE &&
+        std::fabs(report.Rhat[i] - 1.) <= __ZIKA_CHECK_RHAT_TOLERANCE;
+    }
+    printf("rho %.1f%s: ESS %.0f (batch means), %.0f (autocorrelation), expected %.0f; "
+        "acf1 %.4f; split R-hat %.4f  %s\n", rho, (i == apart) ? ", chains apart" : "",
+        report.Ess[i], report.EssAcf[i], expected, report.Acf1[i], report.Rhat[i],
+        ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  return passed ? 0 : 1;
+}
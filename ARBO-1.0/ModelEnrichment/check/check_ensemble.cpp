@@ -0,0 +1,149 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Check of the batched ensemble integrator (src/ensemble.cpp) against
+ * zikaComputeModel, sample by sample, for every inadequacy type. The
+ * samples fill two blocks of lanes and part of a third, and one of them
+ * blows up: its status must be GSL_FAILURE with a zero row, and the
+ * others must agree with the scalar solves to the tolerance of the
+ * stepper. With a single output time every row must be the initial
+ * state, whatever the buffers held before. Exits with 1 if any sample
+ * does not.
+ *
+ *   make check
+ *-----------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <gsl/gsl_errno.h>
+#include "dynamics_info.h"
+#include "ensemble.h"
+#include "model.h"
+
+//both solvers control the error to 1e-4 relative, but take different
+//steps: the rows must agree to a few times that
+#define __ZIKA_CHECK_TOLERANCE 1.e-3
+
+int main()
+{
+  unsigned int n_s = 7;
+  unsigned int dim = n_s + 1;
+  unsigned int n_weeks = 52;
+  const unsigned int n_samples = 2 * __ZIKA_LANES + 3;
+  const unsigned int failing = __ZIKA_LANES + 1;
+
+  std::vector<double> times(n_weeks);
+  for (unsigned int j = 0; j < n_weeks; j++) times[j] = 7. * (j + 1);
+
+  //S_h, E_h, I_h, R_h, S_v E_v, I_v, C, as in bench/bench_likelihood.cpp
+  std::vector<double> initialValues(dim, 0.);
+  initialValues[0] = 206.e6 - 8201.0 - 8201.0 - 29639.0;
+  initialValues[1] = 8201.0;
+  initialValues[2] = 8201.0;
+  initialValues[3] = 29639.0;
+  initialValues[4] = 1. - 0.00044;
+  initialValues[5] = 0.00022;
+  initialValues[6] = 0.00022;
+  initialValues[7] = 8201.0;
+
+  bool passed = true;
+  for (unsigned int inad_type = 0; inad_type < 4; inad_type++){
+    unsigned int params_factor = 1;
+    if( inad_type == 1 ) { params_factor = 2;}
+    if( inad_type == 2 ) { params_factor = 6;}
+    if( inad_type == 3 ) { params_factor = 2 * n_s;}
+    const unsigned int n_params = params_factor * n_s;
+
+    std::vector<double> unused(n_params, 0.);
+    dynamics_info dyn(n_s, n_weeks, inad_type, params_factor, unused);
+    zikaSelectKernel(&dyn);
+    dyn.MaxRhsCalls = 200000;
+
+    //small deterministic proposals around zero, and one far out. The
+    //quadratic terms of types 2 and 3 multiply squared populations of up
+    //to 4e16, those of type 3 summed over every compartment
+    const double size = (inad_type < 2) ? 1.e-3 : (inad_type == 2) ? 1.e-12 : 1.e-15;
+    std::vector<double> deltas(n_samples * n_params);
+    for (unsigned int s = 0; s < n_samples; s++){
+      for (unsigned int i = 0; i < n_params; i++){
+        deltas[s * n_params + i] = size * std::sin(1. + i + 0.7 * s);
+      }
+    }
+    if (inad_type > 0) {
+      for (unsigned int i = 0; i < n_params; i += params_factor) deltas[failing * n_params + i] = 40.;
+    }
+
+    std::vector<double> values;
+    std::vector<int> status;
+    zikaComputeEnsemble(initialValues, times, &dyn, deltas, n_samples, values, status);
+
+    const unsigned int rowSize = n_weeks * dim;
+    std::vector<double> sampleDeltas(n_params + 2, 0.);
+    std::vector<double> expected(rowSize);
+    double worst = 0.;
+    unsigned int n_failed = 0;
+    for (unsigned int s = 0; s < n_samples; s++){
+      std::copy(&deltas[s * n_params], &deltas[s * n_params] + n_params, sampleDeltas.begin());
+      bool failed = false;
+      try
+        {
+          zikaComputeModel(initialValues, times, &dyn, &sampleDeltas[0], expected);
+        } catch( const zika_solve_failure & failure )
+        {
+          failed = true;
+        }
+      const double * row = &values[s * rowSize];
+      if (failed || status[s] != GSL_SUCCESS) {
+        n_failed++;
+        bool zero = true;
+        for (unsigned int k = 0; k < rowSize; k++) zero = zero && row[k] == 0.;
+        if (!failed || status[s] != GSL_FAILURE || !zero) {
+          printf("inad_type %u sample %u: scalar %s, ensemble status %d%s\n", inad_type, s,
+              failed ? "failed" : "solved", status[s], zero ? "" : " with a nonzero row");
+          passed = false;
+        }
+        continue;
+      }
+      //every variable relative to its largest value over the season
+      for (unsigned int i = 0; i < dim; i++){
+        double scale = 0.;
+        for (unsigned int j = 0; j < n_weeks; j++) scale = std::max(scale, std::fabs(expected[dim * j + i]));
+        for (unsigned int j = 0; j < n_weeks; j++){
+          worst = std::max(worst, std::fabs(row[dim * j + i] - expected[dim * j + i]) / scale);
+        }
+      }
+    }
+    const bool ok = worst <= __ZIKA_CHECK_TOLERANCE && n_failed == (inad_type > 0 ? 1u : 0u);
+    printf("inad_type %u: %u samples, %u failed, largest difference %.2e  %s\n", inad_type,
+        n_samples, n_failed, worst, ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+
+  //one output time: nothing to integrate, no lane is loaded
+  {
+    //dynamics_info keeps references to these
+    unsigned int n_times = 1, inad_type = 1, params_factor = 2;
+    std::vector<double> unused(params_factor * n_s, 0.);
+    dynamics_info dyn(n_s, n_times, inad_type, params_factor, unused);
+    zikaSelectKernel(&dyn);
+    std::vector<double> once(n_times, times[0]);
+    std::vector<double> deltas(n_samples * params_factor * n_s, 1.e-3);
+    std::vector<double> values(n_samples * dim, -1.);
+    std::vector<int> status(n_samples, GSL_FAILURE);
+    zikaComputeEnsemble(initialValues, once, &dyn, deltas, n_samples, values, status);
+    bool ok = true;
+    for (unsigned int s = 0; s < n_samples; s++){
+      ok = ok && status[s] == GSL_SUCCESS &&
+           std::equal(initialValues.begin(), initialValues.end(), &values[s * dim]);
+    }
+    printf("one output time: %u samples  %s\n", n_samples, ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Check of the binned FFT kernel density estimates (src/kde.cpp)
+ * against the direct sum of the Gaussian kernels, as ksdensity computes
+ * it, at the same points and with the same bandwidth, for a normal, a
+ * skewed (lognormal) and a bimodal variable laid out as the columns of
+ * a .zbin file, one of them with failed (NaN) samples. The bandwidths
+ * must be those of ksdensity's rule. Exits with 1 if any density is
+ * further off than the binning on the grid allows.
+ *
+ *   make check
+ *-----------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "kde.h"
+#include "philox.h"
+
+//linear binning on GridSize points of width dx: an error of order
+//(dx/h)^2 of the peak, the tolerance is this fraction of it
+#define __ZIKA_CHECK_DENSITY_TOLERANCE 0.1
+#define __ZIKA_CHECK_BANDWIDTH_TOLERANCE 1.e-12
+
+int main()
+{
+  const unsigned int n_vars = 3;
+  //odd, so that the median of ksdensity's rule is one of the samples
+  const size_t n_samples = 20001;
+  const unsigned int n_failed = 100;
+  static const char * names[n_vars] = { "normal", "lognormal", "bimodal" };
+
+  //columns one after the other, as in a .zbin file
+  std::vector<double> samples(n_vars * n_samples);
+  for (size_t s = 0; s < n_samples; s++){
+    zika_philox rng(30081984, s, 0);
+    samples[s] = 100. + 15. * rng.normal();
+    samples[n_samples + s] = 1000. * std::exp(0.8 * rng.normal());
+    samples[2 * n_samples + s] = (rng.uniform() < 0.3) ? 40. + 5. * rng.normal() :
+      120. + 10. * rng.normal();
+  }
+  for (unsigned int f = 0; f < n_failed; f++) samples[n_samples + 7 * f] = NAN;
+
+  kde_settings settings;
+  std::vector<double> density, support, bandwidth;
+  zikaKernelDensities(&samples[0], n_samples, n_vars, 1, n_samples, settings, density, support,
+      bandwidth);
+
+  bool passed = true;
+  const unsigned int P = settings.Points;
+  for (unsigned int v = 0; v < n_vars; v++){
+    std::vector<double> x;
+    for (size_t s = 0; s < n_samples; s++){
+      if (std::isfinite(samples[v * n_samples + s])) x.push_back(samples[v * n_samples + s]);
+    }
+    const size_t n = x.size();
+
+    //ksdensity's rule: sigma = MAD / 0.6745, h = sigma (4 / 3n)^(1/5)
+    std::vector<double> sorted(x);
+    std::sort(sorted.begin(), sorted.end());
+    const double median = sorted[n / 2];
+    std::vector<double> deviations(n);
+    for (size_t s = 0; s < n; s++) deviations[s] = std::fabs(x[s] - median);
+    std::sort(deviations.begin(), deviations.end());
+    const double h = deviations[n / 2] / 0.6745 * std::pow(4. / (3. * n), 0.2);
+    const double bandwidthError = std::fabs(bandwidth[v] / h - 1.);
+
+    std::vector<double> direct(P);
+    for (unsigned int i = 0; i < P; i++){
+      const double xi = sorted[0] + i * (sorted[n - 1] - sorted[0]) / (P - 1);
+      double sum = 0.;
+      for (size_t s = 0; s < n; s++){
+        const double z = (xi - x[s]) / h;
+        sum += std::exp(-0.5 * z * z);
+      }
+      direct[i] = sum / (n * h * std::sqrt(2. * M_PI));
+    }
+    const double peak = *std::max_element(direct.begin(), direct.end());
+    double worst = 0.;
+    for (unsigned int i = 0; i < P; i++){
+      worst = std::max(worst, std::fabs(density[i * n_vars + v] - direct[i]) / peak);
+    }
+    //the grid of zikaKdeColumn, padded by 4h on both sides
+    const double dx = (sorted[n - 1] - sorted[0] + 8. * h) / settings.GridSize;
+    const double tolerance = __ZIKA_CHECK_DENSITY_TOLERANCE * (dx / h) * (dx / h);
+    const bool ok = bandwidthError <= __ZIKA_CHECK_BANDWIDTH_TOLERANCE && worst <= tolerance;
+    printf("%-9s: %zu samples, bandwidth %.6g (ksdensity's %.6g), largest difference "
+        "%.2e of the peak (tolerance %.2e)  %s\n", names[v], n, bandwidth[v], h, worst,
+        tolerance, ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Check of the maximum entropy densities (src/maxent.cpp) on densities
+ * of the form exp(-sum_n lambda_n x^n) with n < 5: a normal, a quartic
+ * well, a truncated exponential and a uniform density. Their moments are
+ * taken with the trapezoid rule on the grid the solver uses, so the
+ * solution is the density itself. All four are solved in one call, one
+ * batch of lanes partly filled; the densities and entropies must match
+ * those of the given densities. Exits with 1 if any does not.
+ *
+ *   make check
+ *-----------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "maxent.h"
+
+//the Newton iteration stops at a relative step of 1e-9: the densities
+//must agree to far better than a part in a million of their peak
+#define __ZIKA_CHECK_PDF_TOLERANCE 1.e-6
+#define __ZIKA_CHECK_ENTROPY_TOLERANCE 1.e-6
+
+//unnormalized density of variable v at x
+static double density(unsigned int v, double x)
+{
+  switch (v) {
+  case 0: { const double z = (x - 0.3) / 0.5; return std::exp(-0.5 * z * z); }
+  case 1: { const double z = (x - 20.) / 4.; return std::exp(-0.5 * z * z - 0.25 * z * z * z * z); }
+  case 2: return std::exp(-2. * x);
+  default: return 1.;
+  }
+}
+
+int main()
+{
+  const unsigned int n_vars = 4;
+  static const char * names[n_vars] = { "normal", "quartic", "exponential", "uniform" };
+  static const double xMin[n_vars] = { -4., 10., 0., 2. };
+  static const double xMax[n_vars] = { 4.6, 30., 3., 5. };
+
+  maxent_settings settings;
+  settings.Moments = 5;
+  const unsigned int N = settings.Moments;
+  const unsigned int Nx = settings.Points;
+
+  //normalized densities on the grid, their moments and entropies, all
+  //with the trapezoid rule
+  std::vector<std::vector<double> > pdfs(n_vars, std::vector<double>(Nx));
+  std::vector<double> moments(n_vars * N, 0.);
+  std::vector<double> entropies(n_vars, 0.);
+  for (unsigned int v = 0; v < n_vars; v++){
+    const double dx = (xMax[v] - xMin[v]) / (Nx - 1);
+    double mass = 0.;
+    for (unsigned int j = 0; j < Nx; j++){
+      const double w = (j == 0 || j == Nx - 1) ? 0.5 * dx : dx;
+      pdfs[v][j] = density(v, xMin[v] + j * dx);
+      mass += w * pdfs[v][j];
+    }
+    for (unsigned int j = 0; j < Nx; j++){
+      const double w = (j == 0 || j == Nx - 1) ? 0.5 * dx : dx;
+      const double x = xMin[v] + j * dx;
+      const double p = pdfs[v][j] /= mass;
+      for (unsigned int n = 0; n < N; n++) moments[v * N + n] += w * p * std::pow(x, (double) n);
+      entropies[v] -= w * p * std::log(p);
+    }
+  }
+
+  std::vector<maxent_density> densities;
+  zikaMaxEntFromMoments(xMin, xMax, &moments[0], n_vars, settings, densities);
+
+  bool passed = true;
+  for (unsigned int v = 0; v < n_vars; v++){
+    const maxent_density & d = densities[v];
+    const double peak = *std::max_element(pdfs[v].begin(), pdfs[v].end());
+    double worst = 0.;
+    for (unsigned int j = 0; j < Nx; j++) worst = std::max(worst, std::fabs(d.Pdf[j] - pdfs[v][j]) / peak);
+    const double entropyError = std::fabs(d.Entropy - entropies[v]);
+    const bool ok = d.Converged && worst <= __ZIKA_CHECK_PDF_TOLERANCE &&
+      entropyError <= __ZIKA_CHECK_ENTROPY_TOLERANCE;
+    printf("%-11s: %u iterations%s, largest density difference %.2e of the peak, entropy %.6f "
+        "(exact %.6f)  %s\n", names[v], d.Iterations, d.Converged ? "" : " (not converged)", worst,
+        d.Entropy, entropies[v], ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  return passed ? 0 : 1;
+}
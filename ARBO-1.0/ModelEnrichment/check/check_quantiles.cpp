@@ -0,0 +1,125 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Check of the qoi sketches (src/quantiles.cpp) against the exact
+ * percentiles of the same values, as numpy.percentile computes them
+ * (linear interpolation between order statistics), for a normal, a
+ * skewed (lognormal) and a bimodal qoi. The values are fed to four
+ * zika_qoi_stats, merged as the SFP merges those of the processes; the
+ * percentiles with the observation noise are compared with the exact
+ * quantiles of the mixture of all values plus N(0, sigma^2). Errors
+ * are ranks, how far the exact CDF at the estimate is from the level,
+ * and for the plain percentiles of qoi-stats (2.5 to 97.5) also values,
+ * as a share of the 95% range. Exits with 1 if any is above its
+ * tolerance.
+ *
+ *   make check
+ *-----------------------------------------------------------------*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "philox.h"
+#include "quantiles.h"
+
+//t-digest with the compression of zika_qoi_stats: ranks within a few
+//tenths of a percent of the level in the middle, far less in the tails,
+//and at the levels written to qoi-stats values within a percent of the
+//95% range of the qoi (the order statistics are too sparse beyond)
+#define __ZIKA_CHECK_RANK_TOLERANCE 2.e-3
+#define __ZIKA_CHECK_VALUE_TOLERANCE 1.e-2
+
+//percentile of sorted values, numpy's default ('linear')
+static double exactQuantile(const std::vector<double>& sorted, double q)
+{
+  const double h = (sorted.size() - 1) * q;
+  const unsigned int lo = (unsigned int) std::floor(h);
+  const unsigned int hi = std::min(lo + 1, (unsigned int) sorted.size() - 1);
+  return sorted[lo] + (h - lo) * (sorted[hi] - sorted[lo]);
+}
+
+//share of the sorted values at or below x
+static double exactRank(const std::vector<double>& sorted, double x)
+{
+  return (std::upper_bound(sorted.begin(), sorted.end(), x) - sorted.begin()) /
+    (double) sorted.size();
+}
+
+//CDF at x of the values plus N(0, sigma^2) noise
+static double mixtureCdf(const std::vector<double>& values, double sigma, double x)
+{
+  double cdf = 0.;
+  for (unsigned int s = 0; s < values.size(); s++){
+    cdf += 0.5 * std::erfc((values[s] - x) / (sigma * M_SQRT2));
+  }
+  return cdf / values.size();
+}
+
+int main()
+{
+  const unsigned int n_qoi = 3;
+  const unsigned int n_procs = 4;
+  const unsigned int n_samples = 40000;
+  static const double levels[7] = { 0.001, 0.025, 0.175, 0.5, 0.825, 0.975, 0.999 };
+  static const char * names[n_qoi] = { "normal", "lognormal", "bimodal" };
+  //noise of the order of the spread of each qoi
+  static const double sigmas[n_qoi] = { 10., 500., 20. };
+
+  std::vector<zika_qoi_stats> stats(n_procs, zika_qoi_stats(n_qoi));
+  std::vector<std::vector<double> > values(n_qoi, std::vector<double>(n_samples));
+  double row[n_qoi];
+  for (unsigned int s = 0; s < n_samples; s++){
+    zika_philox rng(30081984, s, 0);
+    row[0] = 100. + 15. * rng.normal();
+    row[1] = 1000. * std::exp(0.8 * rng.normal());
+    row[2] = (rng.uniform() < 0.3) ? 40. + 5. * rng.normal() : 120. + 10. * rng.normal();
+    for (unsigned int i = 0; i < n_qoi; i++) values[i][s] = row[i];
+    //the samples of a process are consecutive, as in solveSfpBatch
+    stats[s * n_procs / n_samples].add(row);
+  }
+  for (unsigned int p = 1; p < n_procs; p++){
+    std::vector<double> buffer;
+    std::vector<int> counts;
+    stats[p].pack(buffer, counts);
+    stats[0].unpack(&buffer[0], &counts[0]);
+  }
+
+  bool passed = true;
+  for (unsigned int i = 0; i < n_qoi; i++){
+    std::vector<double> sorted(values[i]);
+    std::sort(sorted.begin(), sorted.end());
+    const double range = exactQuantile(sorted, 0.975) - exactQuantile(sorted, 0.025);
+    double worst = 0., worstValue = 0., worstNoise = 0.;
+    for (unsigned int l = 0; l < 7; l++){
+      const double q = levels[l];
+      const double estimate = stats[0][i].quantile(q);
+      const double exact = exactQuantile(sorted, q);
+      const double error = std::fabs(exactRank(sorted, estimate) - q);
+      const double valueError = (q < 0.025 || q > 0.975) ? 0. : std::fabs(estimate - exact) / range;
+      worst = std::max(worst, error);
+      worstValue = std::max(worstValue, valueError);
+      if (error > __ZIKA_CHECK_RANK_TOLERANCE || valueError > __ZIKA_CHECK_VALUE_TOLERANCE) {
+        printf("%s: percentile %g is %.6g, numpy's %.6g\n", names[i], 100. * q, estimate, exact);
+      }
+      const double noisy = stats[0][i].quantile(q, sigmas[i]);
+      const double noiseError = std::fabs(mixtureCdf(values[i], sigmas[i], noisy) - q);
+      worstNoise = std::max(worstNoise, noiseError);
+      if (noiseError > __ZIKA_CHECK_RANK_TOLERANCE) {
+        printf("%s: percentile %g with noise %g is %.6g, at rank %.6g of the mixture\n",
+            names[i], 100. * q, sigmas[i], noisy, q + noiseError);
+      }
+    }
+    const bool ok = worst <= __ZIKA_CHECK_RANK_TOLERANCE &&
+      worstValue <= __ZIKA_CHECK_VALUE_TOLERANCE && worstNoise <= __ZIKA_CHECK_RANK_TOLERANCE;
+    printf("%-9s: %zu centroids, largest rank error %.2e (value %.2e of the 95%% range), "
+        "with noise %.2e  %s\n", names[i], stats[0][i].means().size(), worst, worstValue,
+        worstNoise, ok ? "ok" : "FAILED");
+    passed = passed && ok;
+  }
+  return passed ? 0 : 1;
+}
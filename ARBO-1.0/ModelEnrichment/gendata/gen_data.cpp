@@ -37,6 +37,7 @@ int main()
   std::vector<double> delta(n_delta,0.);
   /* dynamics_info dynMain(n_s, n_times, delta); */
   dynamics_info dynMain(n_s, n_weeks, inad_type, params_factor, delta);
+  zikaSelectKernel(&dynMain);
   
   std::vector<double> phiPoints(1,0.);
   for (unsigned int i = 0; i < 1; i++){
@@ -0,0 +1,102 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/binfile.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_BINFILE_H__
+#define __ZIKA_BINFILE_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Binary output of the chains and qois ('.zbin'), in place of the .m text
+// files. The file is columnar: a page holding this header and the column
+// names, then one column of Capacity doubles after the other, from
+// DataOffset (page aligned). Rows are written as they come and NRows is
+// updated after each block, so a run that stops midway leaves a readable
+// file. Everything is in the byte order of the machine that wrote it.
+// postprocessing/zikabin.py maps the same layout with numpy.
+struct zika_bin_header
+{
+  char     Magic[8];      //"ZIKABIN" and a zero
+  uint32_t Version;       //1
+  uint32_t NCols;
+  uint64_t Capacity;      //rows allocated in every column
+  uint64_t NRows;         //rows written so far
+  uint32_t NWeeks;        //of the model run, for the qoi layout
+  uint32_t Dim;           //N_s + 1
+  double   RepFactor;     //under-reporting factor applied to the data
+  uint64_t DataOffset;    //bytes from the start of the file to column 0
+};
+
+// length of a column name in the file, zero padded
+#define __ZIKA_BIN_NAME 32
+
+// writes a .zbin file of names.size() columns and up to capacity rows
+struct zika_bin_writer { zika_bin_writer(
+  const char*                     fileName,
+  const std::vector<std::string>& names,
+  uint64_t                        capacity,
+  unsigned int                    n_weeks,
+  unsigned int                    dim,
+  double                          rep_factor);
+ ~zika_bin_writer();
+
+  // appends n_rows rows of NCols values each (row major, as the samplers
+  // hold them), scattered into the columns; rows past the capacity are
+  // dropped. Returns false if the file could not be written.
+  bool append(const double* rows, uint64_t n_rows);
+
+  bool ok() const { return m_fd >= 0; }
+
+private:
+  int             m_fd;
+  zika_bin_header m_header;
+  std::vector<double> m_column;
+};
+
+// maps a .zbin file read-only: the columns are read in place, nothing is
+// copied
+struct zika_bin_reader { zika_bin_reader(const char* fileName);
+ ~zika_bin_reader();
+
+  bool ok() const { return m_data != NULL; }
+
+  const zika_bin_header& header() const { return *m_header; }
+  uint64_t rows() const { return m_header->NRows; }
+  unsigned int cols() const { return m_header->NCols; }
+  std::string name(unsigned int col) const;
+
+  // NRows values of column col, or NULL past the last column
+  const double* column(unsigned int col) const;
+
+  // value of row r of column col
+  double operator()(uint64_t r, unsigned int col) const { return column(col)[r]; }
+
+private:
+  void*                   m_data;
+  size_t                  m_size;
+  const zika_bin_header * m_header;
+};
+
+// column names delta_0, ..., delta_{n_params-1}, followed by extra if not
+// empty
+std::vector<std::string>
+zikaParamNames(
+  unsigned int                    n_params,
+  const char*                     extra);
+
+// column names of the qois, Y<i>_w<j> for state variable i at week j, in
+// the order of zikaComputeModel's returnValues
+std::vector<std::string>
+zikaQoiNames(
+  unsigned int                    n_weeks,
+  unsigned int                    dim);
+
+#endif
@@ -0,0 +1,111 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/calibration.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_CALIBRATION_H__
+#define __ZIKA_CALIBRATION_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//unknowns of the least-squares calibration of the SEIR-SEI model, as in
+//CalibrationProblem/main_SEIR_SEI_TRR_example2.m: the six rates, then the
+//initial conditions but RH0 (fixed) and C0 (the first week of data)
+enum zika_fit_unknown
+{
+  ZIKA_FIT_BETAH = 0,   //vector-to-human transmission rate (days^-1)
+  ZIKA_FIT_ALPHAH,      //human latent rate (days^-1)
+  ZIKA_FIT_GAMMA,       //human recovery rate (days^-1)
+  ZIKA_FIT_BETAV,       //human-to-vector transmission rate (days^-1)
+  ZIKA_FIT_ALPHAV,      //vector latent rate (days^-1)
+  ZIKA_FIT_DELTA,       //vector birth/mortality rate (days^-1)
+  ZIKA_FIT_SH0,         //initial susceptible humans
+  ZIKA_FIT_EH0,         //initial exposed humans
+  ZIKA_FIT_IH0,         //initial infectious humans
+  ZIKA_FIT_SV0,         //initial proportion of susceptible vectors
+  ZIKA_FIT_EV0,         //initial proportion of exposed vectors
+  ZIKA_FIT_IV0,         //initial proportion of infectious vectors
+  ZIKA_FIT_UNKNOWNS
+};
+
+//name of unknown i, as in the fit_ keys and the outputs
+const char* zikaFitUnknownName(unsigned int i);
+
+//a calibration, read from a 'key = value' file (see inputs/fit.inp)
+struct fit_problem { fit_problem(const char* fileName);
+ ~fit_problem();
+
+  double Lower[ZIKA_FIT_UNKNOWNS];  //fit_<name> = <lower> <upper> [guess];
+  double Upper[ZIKA_FIT_UNKNOWNS];  //lower = upper holds the unknown fixed
+  double Guess[ZIKA_FIT_UNKNOWNS];  //the initial guess of the MATLAB example,
+                                    //the first start
+  double N;                   //fit_N: human population size
+  double RH0;                 //fit_RH0: initial recovered humans
+  std::string Data;           //fit_data: weekly new cases, see include/cases.h
+  std::string DataRegion;     //fit_dataRegion: its column of cases, the first by default
+  unsigned int Starts;        //fit_starts: Latin hypercube starts, the guess included
+  uint64_t Seed;              //fit_seed
+  unsigned int MaxIterations; //fit_maxIterations: of each start
+  double Tolerance;           //fit_tolerance: on the relative change of the cost
+  std::string Output;         //fit_output: prefix of the output files
+  bool Ok;                    //every line of the file was understood
+
+  std::vector<double> NewCases; //weekly new cases, read from Data
+};
+
+//one local minimum, found from one start
+struct fit_result
+{
+  double X[ZIKA_FIT_UNKNOWNS];
+  double Cost;                //half the sum of the squared residuals
+  double R0;                  //basic reproduction number at X
+  unsigned int Iterations;
+  unsigned int Solves;        //of the model with its sensitivities
+  bool Converged;             //false: out of iterations, or the solves failed
+};
+
+//basic reproduction number of the rates in x, as in the MATLAB examples
+double zikaFitR0(const double x[]);
+
+//residuals of x and their jacobian: the model's weekly new cases minus the
+//data at weeks 1..n_weeks-1 (week 0 is C0, the data), then the human total
+//SH0 + EH0 + IH0 minus N - RH0 and the vector total SV0 + EV0 + IV0 minus
+//1, the latter times N so that it counts in individuals like the rest.
+//jacobian is residuals x ZIKA_FIT_UNKNOWNS, row major, from the forward
+//sensitivities of the model (the rates enter the right-hand side as dual
+//numbers, the initial conditions seed the sensitivities with the
+//identity). Returns false if the solve failed.
+bool
+zikaFitResiduals(
+  const fit_problem&            problem,
+  const double                  x[],
+  std::vector<double>&          residuals,
+  std::vector<double>*          jacobian);
+
+//bound-constrained Levenberg-Marquardt from x0, in the unknowns scaled to
+//[0, 1] by their bounds: at each iteration the unknowns on a bound whose
+//gradient points out of the box are held, the damped Gauss-Newton step of
+//the others is projected back on the box, and the damping follows the
+//ratio of actual to predicted reduction of the cost (Nielsen's update),
+//which is the trust region of lsqcurvefit in multiplier form
+fit_result
+zikaFitLocal(
+  const fit_problem&            problem,
+  const double                  x0[]);
+
+//problem.Starts local fits on every thread OpenMP gives: start 0 from the
+//guess, the others from a Latin hypercube over the box of the free
+//unknowns (Philox streams, a pure function of the seed and the start);
+//the results in start order
+std::vector<fit_result>
+zikaFitMultistart(
+  const fit_problem&            problem);
+
+#endif
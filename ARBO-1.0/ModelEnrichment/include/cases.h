@@ -0,0 +1,68 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/cases.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_CASES_H__
+#define __ZIKA_CASES_H__
+
+#include "binfile.h"
+#include <string>
+#include <vector>
+
+// weekly new cases of one or more regions, of any number of weeks. The
+// text file is read in any of the layouts of the data:
+//   - a 'week cases' line per week, as inputs/data.txt, with more case
+//     columns for more regions and an optional header line naming them;
+//   - a row of weeks followed by a row of cases per region, as the SINAN
+//     series of Datasets/ (2016zika_Prob250117.dat, ...), each row
+//     optionally led by its name.
+// Fields are separated by commas, semicolons, tabs or blanks, '#' starts
+// a comment. Weeks are epidemiological week numbers, that start again at
+// 1 with every year, or YYYYWW labels; they are unwrapped to consecutive
+// numbers counted from the first week of the file. Every count must be a
+// finite non negative number and every week must come after the one
+// before it. The spreadsheets (.xlsx) are not read: save them as CSV.
+//
+// The file is parsed once into fileName.zbin (columns 'week' and one per
+// region, NWeeks the weeks and Dim the regions of the header) and mapped
+// from there on every later run, as long as it is newer than the file.
+// When the cache cannot be written the parsed columns are kept in memory.
+struct zika_case_series { zika_case_series(const char* fileName);
+ ~zika_case_series();
+
+  bool ok() const { return m_weeks > 0; }
+
+  unsigned int weeks() const { return m_weeks; }
+  unsigned int regions() const { return m_names.size(); }
+  const std::string& name(unsigned int region) const { return m_names[region]; }
+
+  // the region named key, or numbered key (from 0); the first for an
+  // empty key, -1 for none
+  int region(const std::string& key) const;
+
+  // weeks() unwrapped week numbers, and the new cases of a region
+  const double* week() const { return column(0); }
+  const double* cases(unsigned int region) const { return column(region + 1); }
+
+private:
+  zika_case_series(const zika_case_series&);
+  zika_case_series& operator=(const zika_case_series&);
+
+  const double* column(unsigned int col) const;
+  bool map(const char* cacheName, const char* fileName);
+  bool parse(const char* fileName);
+  void cache(const char* cacheName) const;
+
+  zika_bin_reader *        m_reader;   //the cache, when mapped
+  std::vector<double>      m_columns;  //... or the parsed columns, one after the other
+  std::vector<std::string> m_names;    //of the regions
+  unsigned int             m_weeks;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/convergence.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_CONVERGENCE_H__
+#define __ZIKA_CONVERGENCE_H__
+
+#include <stddef.h>
+#include <cstdio>
+#include <vector>
+
+// scalar summaries of one forward solve whose Monte Carlo estimates are
+// watched, from its weekly cumulative cases
+enum zika_conv_quantity
+{
+  ZIKA_CONV_NORM = 0,     //integral of C(t)^2 dt, the ||Q||^2 of randvar_mc_conv.m
+  ZIKA_CONV_FINAL,        //cumulative cases at the last week
+  ZIKA_CONV_PEAK,         //largest weekly new cases
+  ZIKA_CONV_PEAK_WEEK,    //week of those
+  ZIKA_CONV_QUANTITIES
+};
+
+// name of quantity q, for the convergence logs
+const char* zikaConvQuantityName(unsigned int q);
+
+// the quantities of one sample from its n_weeks cumulative cases,
+// cumCases[j * stride] at week j (7 days apart)
+void
+zikaConvQuantities(
+  const double*                   cumCases,
+  size_t                          stride,
+  unsigned int                    n_weeks,
+  double                          quantities[]);
+
+// Running Monte Carlo estimates of the mean and of the second moment of
+// every quantity, as the samples come. Per quantity and for both q and
+// q^2 it keeps the mean and the sum of squared deviations (Welford), so
+// that the estimates of two sample sets combine exactly (Chan et al.) -
+// the blocks of every MPI process or thread are merged this way. The run
+// has converged when the standard errors of all the estimates are below
+// Tolerance times their magnitude, after MinSamples samples at least.
+struct mc_convergence { mc_convergence(double tolerance, unsigned long minSamples);
+ ~mc_convergence();
+
+  // one sample, ZIKA_CONV_QUANTITIES values; samples with a value that is
+  // not finite (failed solves) are left out
+  void add(const double quantities[]);
+
+  // adds the estimates of other, given as its data()
+  void merge(const double* other);
+
+  // the state, __ZIKA_CONV_FIELDS doubles, for reductions over processes
+  const double* data() const { return &m_state[0]; }
+
+  // standard error of the mean (moment 1) or of the second moment (moment
+  // 2) of quantity q, relative to the estimate
+  double relativeError(unsigned int q, unsigned int moment) const;
+
+  // largest of all the relative errors
+  double worstError() const;
+
+  // sqrt of the running mean of ZIKA_CONV_NORM, the MC_conv metric of
+  // randvar_mc_conv.m at the current number of samples
+  double metric() const;
+
+  double samples() const { return m_state[0]; }
+  double mean(unsigned int q) const;
+  bool converged() const;
+
+  // one line of the log: samples, metric, then mean and worst relative
+  // error of every quantity; with header, their names first
+  void write(FILE* file, bool header) const;
+
+  double Tolerance;
+  unsigned long MinSamples;
+
+private:
+  std::vector<double> m_state;  //n, then mean and M2 of q and of q^2 per quantity
+};
+
+// doubles of an mc_convergence state
+#define __ZIKA_CONV_FIELDS (1 + 4 * ZIKA_CONV_QUANTITIES)
+
+#endif
@@ -0,0 +1,101 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/diagnostics.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_DIAGNOSTICS_H__
+#define __ZIKA_DIAGNOSTICS_H__
+
+#include <vector>
+
+// Convergence diagnostics of MCMC chains, kept up to date as the chains
+// grow: every update only reads the positions added since the last one.
+// Per chain and delta it holds
+//  - the running mean and variance, and those of the first half of the
+//    chain (the half boundary moves forward with the chain), for split
+//    R-hat;
+//  - the sums of x_t x_{t-l} for lags l = 1..MaxLag, over a ring of the
+//    last MaxLag positions, for the autocorrelation function and the
+//    integrated autocorrelation time (Geyer's initial positive sequence,
+//    truncated at MaxLag);
+//  - between NBatches and 2 NBatches batch sums, whose batch size doubles
+//    (pairs of batches are merged) when there are 2 NBatches of them, for
+//    the batch-means ESS.
+// Values are shifted by the first position of their chain, which keeps
+// the sums of squares well conditioned.
+struct chain_diagnostics { chain_diagnostics(unsigned int n_chains, unsigned int n_params,
+    unsigned int max_lag = 50, unsigned int n_batches = 32);
+ ~chain_diagnostics();
+
+  // takes in positions [seen, n) of chain c, stored one row of n_params
+  // values after the other from 'chain'. Touches only chain c's state, so
+  // the chains can be updated from different threads.
+  void update(unsigned int c, const double* chain, unsigned int n);
+
+  // __ZIKA_DIAG_FIELDS summaries per chain and delta (see diagnostics.cpp),
+  // chain after chain, for gathering the chains of all processes
+  void pack(std::vector<double>& buffer) const;
+
+  unsigned int chains() const { return m_chains; }
+  unsigned int params() const { return m_params; }
+
+private:
+  unsigned int m_chains;
+  unsigned int m_params;
+  unsigned int m_maxLag;
+  unsigned int m_batches;
+  std::vector<unsigned int> m_n;          //positions seen, per chain
+  std::vector<unsigned int> m_half;       //of which in the first half
+  std::vector<unsigned int> m_batchSize;  //per chain
+  std::vector<unsigned int> m_batchFill;  //positions in the open batch
+  std::vector<double> m_shift;            //first position, chain x delta
+  std::vector<double> m_sum, m_sumSq;     //chain x delta
+  std::vector<double> m_halfSum, m_halfSumSq;
+  std::vector<double> m_ring;             //chain x lag x delta
+  std::vector<double> m_lagged;           //chain x lag x delta
+  std::vector<double> m_open;             //sum of the open batch, chain x delta
+  std::vector<std::vector<double> > m_batchSums;  //per chain, batch x delta
+};
+
+#define __ZIKA_DIAG_FIELDS 10
+
+// diagnostics of all the chains, combined from their packed summaries
+struct chain_report
+{
+  unsigned int Positions;     //in all chains
+  unsigned int Shortest;      //positions of the shortest chain
+  std::vector<double> Ess;    //batch means, summed over the chains
+  std::vector<double> EssAcf; //positions / autocorrelation time, summed
+  std::vector<double> Rhat;   //split R-hat
+  std::vector<double> Acf1;   //lag 1 autocorrelation, mean over the chains
+  std::vector<double> Tau;    //autocorrelation time, mean over the chains
+  double MinEss;
+  double MaxRhat;
+};
+
+// combines the summaries of n_chains chains (packed one after the other,
+// as by chain_diagnostics::pack) of n_params deltas
+void zikaCombineDiagnostics(
+  const std::vector<double>&      packed,
+  unsigned int                    n_chains,
+  unsigned int                    n_params,
+  chain_report&                   report);
+
+// writes report to fileName, through a temporary file renamed in place so
+// that a reader never sees it half written; step and length are the
+// positions done and planned per chain, targetEss is 0 without a target
+void zikaWriteDiagnostics(
+  const char*                     fileName,
+  const chain_report&             report,
+  unsigned int                    n_chains,
+  unsigned int                    step,
+  unsigned int                    length,
+  double                          targetEss,
+  double                          targetRhat);
+
+#endif
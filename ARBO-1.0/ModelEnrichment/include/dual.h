@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * Minimal forward-mode automatic differentiation: a value together with
+ * its N partial derivatives. Only the operations needed by the
+ * templated right-hand side in src/model.cpp are provided.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_DUAL_H__
+#define __ZIKA_DUAL_H__
+
+template <unsigned int N>
+struct dual
+{
+  dual() : v(0.) { for (unsigned int k = 0; k < N; k++) d[k] = 0.; }
+  dual(double x) : v(x) { for (unsigned int k = 0; k < N; k++) d[k] = 0.; }
+
+  double v;     //value
+  double d[N];  //partial derivatives
+
+  dual & operator+=(const dual & b) { v += b.v; for (unsigned int k = 0; k < N; k++) d[k] += b.d[k]; return *this; }
+};
+
+template <unsigned int N>
+inline dual<N> operator-(const dual<N> & a)
+{ dual<N> r; r.v = -a.v; for (unsigned int k = 0; k < N; k++) r.d[k] = -a.d[k]; return r; }
+
+template <unsigned int N>
+inline dual<N> operator+(const dual<N> & a, const dual<N> & b)
+{ dual<N> r; r.v = a.v + b.v; for (unsigned int k = 0; k < N; k++) r.d[k] = a.d[k] + b.d[k]; return r; }
+
+template <unsigned int N>
+inline dual<N> operator-(const dual<N> & a, const dual<N> & b)
+{ dual<N> r; r.v = a.v - b.v; for (unsigned int k = 0; k < N; k++) r.d[k] = a.d[k] - b.d[k]; return r; }
+
+template <unsigned int N>
+inline dual<N> operator-(double a, const dual<N> & b)
+{ dual<N> r; r.v = a - b.v; for (unsigned int k = 0; k < N; k++) r.d[k] = -b.d[k]; return r; }
+
+template <unsigned int N>
+inline dual<N> operator*(const dual<N> & a, const dual<N> & b)
+{ dual<N> r; r.v = a.v * b.v; for (unsigned int k = 0; k < N; k++) r.d[k] = a.d[k] * b.v + a.v * b.d[k]; return r; }
+
+template <unsigned int N>
+inline dual<N> operator*(double a, const dual<N> & b)
+{ dual<N> r; r.v = a * b.v; for (unsigned int k = 0; k < N; k++) r.d[k] = a * b.d[k]; return r; }
+
+template <unsigned int N>
+inline dual<N> operator*(const dual<N> & a, double b)
+{ return b * a; }
+
+template <unsigned int N>
+inline dual<N> operator/(const dual<N> & a, double b)
+{ dual<N> r; r.v = a.v / b; for (unsigned int k = 0; k < N; k++) r.d[k] = a.d[k] / b; return r; }
+
+//|x| has derivative sign(x); zero is taken at the kink
+template <unsigned int N>
+inline dual<N> abs(const dual<N> & a)
+{
+  dual<N> r;
+  r.v = (a.v < 0) ? -a.v : a.v;
+  const double s = (a.v > 0) ? 1. : (a.v < 0) ? -1. : 0.;
+  for (unsigned int k = 0; k < N; k++) r.d[k] = s * a.d[k];
+  return r;
+}
+
+//max(x,0) as in clampPositive, with zero derivative on the clamped side
+template <unsigned int N>
+inline dual<N> clampPositive(const dual<N> & a)
+{ return (a.v <= 0) ? dual<N>(0.) : a; }
+
+//smoothPositive, with the derivative 4s - 3s^2 (s = x/w) of the ramp
+template <unsigned int N>
+inline dual<N> smoothPositive(const dual<N> & a, double w)
+{
+  if (a.v <= 0) return dual<N>(0.);
+  if (a.v >= w) return a;
+  const double s = a.v / w;
+  dual<N> r;
+  r.v = a.v * s * (2. - s);
+  const double slope = s * (4. - 3. * s);
+  for (unsigned int k = 0; k < N; k++) r.d[k] = slope * a.d[k];
+  return r;
+}
+
+#endif
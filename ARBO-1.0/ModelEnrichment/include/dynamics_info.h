@@ -8,6 +8,15 @@
 //c++
 #include <vector>
 
+//GSL stepper used by zikaComputeModel (see zika_solver in inputs/zika.inp)
+enum zika_solver {
+  ZIKA_SOLVER_RKF45 = 0,   //explicit Runge-Kutta-Fehlberg (4,5), the default
+  ZIKA_SOLVER_RK8PD,       //explicit Runge-Kutta Prince-Dormand (8,9)
+  ZIKA_SOLVER_MSBDF,       //implicit multistep BDF, for stiff proposals
+  ZIKA_SOLVER_BSIMP,       //implicit Bulirsch-Stoer
+  ZIKA_SOLVER_RK4IMP       //implicit Gaussian 4th order Runge-Kutta
+};
+
 // define struct that holds all dyanamical system info, except params
 struct dynamics_info { dynamics_info(
   const unsigned int & n_s,
@@ -22,5 +31,58 @@ struct dynamics_info { dynamics_info(
   const unsigned int & Inad_type;
   const unsigned int & Params_factor;
   std::vector<double> & Deltas;
+
+  //reduced model parameters, resolved once here instead of on every RHS call
+  double Bh;  //\beta_h
+  double Ah;  //\alpha_h
+  double G;   //\gamma
+  double D;   //\delta
+  double Bv;  //\beta_v
+  double Av;  //\alpha_v
+  double Nv;  //N_v
+  double Nh;  //N_h
+
+  //right-hand side and jacobian used by the ODE solve, set by
+  //zikaSelectKernel; NULL means the generic zikaFunction/zikaJacobian
+  int (*Rhs)(double t, const double Y[], double dYdt[], void* params);
+  int (*Jac)(double t, const double Y[], double *dfdY, double dfdt[], void* params);
+
+  //right-hand side of the state plus its forward sensitivities to the
+  //deltas, set by zikaSelectKernel; NULL when there is no specialized
+  //kernel, and then no gradients are available
+  int (*SensRhs)(double t, const double Z[], double dZdt[], void* params);
+
+  //one of zika_solver
+  unsigned int Solver;
+
+  //start the solve from the step size of the previous one when all deltas
+  //are within WarmStartRadius of its deltas (off by default)
+  unsigned int WarmStart;
+  double WarmStartRadius;
+
+  //step freely to the last output time and interpolate the state at the
+  //others from the accepted steps (cubic Hermite), instead of stopping
+  //the stepper at every output time (off by default)
+  unsigned int DenseOutput;
+
+  //error control on the state in units of Scale(i), so that the absolute
+  //tolerance means the same for the human compartments (~Nh) as for the
+  //vector proportions (~Nv) (off by default)
+  unsigned int ScaledTolerance;
+
+  //when > 0, negative states are removed by a C1 ramp of width
+  //PositivityWidth*Scale(i) instead of the kink of clamping them to zero
+  double PositivityWidth;
+
+  //budget of one solve, 0 for no limit: right-hand side calls, step size
+  //and wall-clock seconds. A solve that exceeds it throws a
+  //zika_solve_failure (see model.h)
+  unsigned long MaxRhsCalls;
+  double MinStep;
+  double MaxSeconds;
+
+  //natural scale of state variable i: Nv for the vectors, Nh for the human
+  //compartments and the cumulative cases
+  double Scale(unsigned int i) const { return (i >= 4 && i <= 6) ? Nv : Nh; }
 };
 #endif
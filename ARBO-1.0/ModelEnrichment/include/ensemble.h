@@ -0,0 +1,38 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * This is the header file for src/ensemble.cpp. 
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_ENSEMBLE_H__
+#define __ZIKA_ENSEMBLE_H__
+
+#include "dynamics_info.h"
+#include <vector>
+
+//number of parameter sets advanced together: 8 doubles fill an AVX-512
+//register, or two AVX2 registers
+#ifndef __ZIKA_LANES
+#define __ZIKA_LANES 8
+#endif
+
+//solves the model for n_samples parameter sets at once. deltas holds one
+//row of n_params = Params_factor * N_s values per sample; returnValues gets
+//one row of timePoints.size() * dim values per sample, laid out as in
+//zikaComputeModel. status[s] is GSL_SUCCESS, or GSL_FAILURE if the solve of
+//sample s did not converge (its row is then left at zero).
+void
+zikaComputeEnsemble(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  dynamics_info*              p_dyn,
+  const std::vector<double>&  deltas,
+  unsigned int                n_samples,
+  std::vector<double>&        returnValues,
+  std::vector<int>&           status);
+
+#endif
@@ -0,0 +1,53 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/kde.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_KDE_H__
+#define __ZIKA_KDE_H__
+
+#include <stddef.h>
+#include <vector>
+
+// Gaussian kernel density estimates of many variables, the output of
+// UncertaintyQuantification/randvar_ksd.m: the density of each variable at
+// Points points from its minimum to its maximum. Instead of summing the
+// kernels at every point (ksdensity, O(samples x points) per variable),
+// the samples are linearly binned onto GridSize points and smoothed by a
+// product with the Fourier transform of the kernel (a real FFT of the
+// bins, Silverman 1982), then interpolated to the output points.
+struct kde_settings { kde_settings();
+ ~kde_settings();
+
+  unsigned int Points;        //of the output, as numpts of randvar_ksd
+  unsigned int GridSize;      //bins, rounded up to a power of two
+  double Bandwidth;           //0 for the rule of ksdensity: sigma (4/3n)^(1/5)
+                              //with sigma = MAD/0.6745, else this one
+};
+
+// Densities of n_vars variables from an ensemble, without copying it:
+// sample s of variable v is samples[s * sampleStride + v * varStride]
+// (rows of a qoi block: sampleStride = n_cols, varStride = 1; columns of
+// a .zbin file: sampleStride = 1, varStride = capacity). Samples that are
+// not finite are left out. As randvar_ksd, density and support are Points
+// x n_vars, row major; bandwidth holds the one used for every variable. A
+// variable without spread has a zero density at its single value. The
+// variables are spread over the OpenMP threads.
+void
+zikaKernelDensities(
+  const double*                   samples,
+  size_t                          n_samples,
+  unsigned int                    n_vars,
+  size_t                          sampleStride,
+  size_t                          varStride,
+  const kde_settings&             settings,
+  std::vector<double>&            density,
+  std::vector<double>&            support,
+  std::vector<double>&            bandwidth);
+
+#endif
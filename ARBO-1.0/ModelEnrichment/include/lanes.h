@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * A fixed-width pack of doubles, one per ensemble member, with
+ * element-wise arithmetic. Every operation is a short loop with a
+ * constant trip count, which the compiler turns into SIMD instructions
+ * (AVX2/AVX-512 with -march=native, see SIMD_FLAGS in the Makefile).
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_LANES_H__
+#define __ZIKA_LANES_H__
+
+#include <cmath>
+
+template <unsigned int L>
+struct lanes
+{
+  lanes() {}
+  lanes(double x) { for (unsigned int k = 0; k < L; k++) v[k] = x; }
+
+  double v[L];
+
+  lanes & operator+=(const lanes & b) { for (unsigned int k = 0; k < L; k++) v[k] += b.v[k]; return *this; }
+};
+
+template <unsigned int L>
+inline lanes<L> operator-(const lanes<L> & a)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = -a.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator+(const lanes<L> & a, const lanes<L> & b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a.v[k] + b.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator-(const lanes<L> & a, const lanes<L> & b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a.v[k] - b.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator-(double a, const lanes<L> & b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a - b.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator*(const lanes<L> & a, const lanes<L> & b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a.v[k] * b.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator*(double a, const lanes<L> & b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a * b.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator*(const lanes<L> & a, double b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a.v[k] * b; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator+(double a, const lanes<L> & b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a + b.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator/(const lanes<L> & a, const lanes<L> & b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a.v[k] / b.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> operator/(const lanes<L> & a, double b)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = a.v[k] / b; return r; }
+
+template <unsigned int L>
+inline lanes<L> abs(const lanes<L> & a)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = std::fabs(a.v[k]); return r; }
+
+template <unsigned int L>
+inline lanes<L> clampPositive(const lanes<L> & a)
+{ lanes<L> r; for (unsigned int k = 0; k < L; k++) r.v[k] = (a.v[k] <= 0) ? 0. : a.v[k]; return r; }
+
+template <unsigned int L>
+inline lanes<L> smoothPositive(const lanes<L> & a, double w)
+{
+  lanes<L> r;
+  for (unsigned int k = 0; k < L; k++){
+    const double x = a.v[k];
+    const double s = x / w;
+    r.v[k] = (x <= 0) ? 0. : (x >= w) ? x : x * s * (2. - s);
+  }
+  return r;
+}
+
+#endif
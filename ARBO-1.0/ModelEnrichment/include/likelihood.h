@@ -31,6 +31,32 @@ struct likelihoodRoutine_Data // user defined class
   const std::vector<double> & m_csc;
   double & m_var;
   dynamics_info       * m_dynMain;
+
+  //scratch for the model output, sized once here so that a likelihood
+  //evaluation does not touch the heap
+  std::vector<double>   m_returnValues;
+
+  //scratch for the forward sensitivities, N_times*(N_s+1)*n_params, sized
+  //only when dynInfo has a sensitivity kernel (zikaSelectKernel must have
+  //been called before)
+  std::vector<double>   m_sensitivities;
+
+  //log-likelihood of a proposal whose solve failed or ran out of budget
+  //(zika_solve_failure), -500000 unless set after construction
+  double                m_failureLogLikelihood;
+
+  //weeks of m_csc that are data, the first m_nObserved: the misfit is
+  //summed over them only and the likelihood solves stop there, the weeks
+  //after them up to N_times are only forecast. N_times unless set with
+  //setObservedWeeks after construction
+  unsigned int          m_nObserved;
+  std::vector<double>   m_observedTimes;   //the first m_nObserved of m_times
+
+  void setObservedWeeks(unsigned int n_observed);
+
+  //scratch for likelihoodRoutineBatch, grown to the largest batch seen
+  std::vector<double>   m_batchValues;
+  std::vector<int>      m_batchStatus;
 };
 
 double likelihoodRoutine( // user defined routine
@@ -41,4 +67,54 @@ double likelihoodRoutine( // user defined routine
   QUESO::GslMatrix*       hessianMatrix,
   QUESO::GslVector*       hessianEffect);
 
+// log-likelihood of one vector of deltas over the observed weeks. Only reads
+// data, writes the model output of those weeks to the first
+// m_nObserved*(N_s+1) of the caller's returnValues (N_times*(N_s+1)
+// entries): several threads can call it at once, each with its own
+// returnValues
+double zikaLogLikelihood(
+  const double*                 deltas,
+  const likelihoodRoutine_Data& data,
+  std::vector<double>&          returnValues);
+
+// same log-likelihood, but the solve stops at the first week where the
+// partial misfit already puts it below minLogLikelihood (the misfit only
+// grows with time). The value returned is then the partial log-likelihood,
+// itself below minLogLikelihood, so an MH step that draws its uniform first
+// takes the same decision as with the full evaluation. n_weeks is the
+// number of weeks actually integrated, m_nObserved when the solve ran to
+// the end. The result is bitwise that of zikaLogLikelihood in that case.
+// A solve that fails later would have returned m_failureLogLikelihood, so
+// when minLogLikelihood is below that penalty the failure could still pass
+// the test: the solve is then never stopped early.
+double zikaLogLikelihoodBounded(
+  const double*                 deltas,
+  const likelihoodRoutine_Data& data,
+  std::vector<double>&          returnValues,
+  double                        minLogLikelihood,
+  unsigned int&                 n_weeks);
+
+// same log-likelihood, plus its gradient with respect to the deltas
+// (n_params entries) from the forward sensitivities and, when hessian is not
+// NULL, the Gauss-Newton approximation of its hessian (n_params x n_params,
+// row major): -sum_j dC_j/d(delta) dC_j/d(delta)^T / var. Needs
+// data.m_dynMain->SensRhs; reentrant like zikaLogLikelihood, with the
+// caller's returnValues and sensitivities (sized as in the data struct).
+double zikaLogLikelihoodGradient(
+  const double*                 deltas,
+  const likelihoodRoutine_Data& data,
+  std::vector<double>&          returnValues,
+  std::vector<double>&          sensitivities,
+  double*                       gradient,
+  double*                       hessian);
+
+// same log-likelihood for n_samples parameter vectors at once (one row of
+// n_params values each in paramValues), solved together by the ensemble
+// integrator over the observed weeks
+void likelihoodRoutineBatch(
+  const std::vector<double>& paramValues,
+  unsigned int               n_samples,
+  const void*                functionDataPtr,
+  std::vector<double>&       logLikelihoods);
+
 #endif
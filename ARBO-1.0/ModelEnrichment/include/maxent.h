@@ -0,0 +1,87 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/maxent.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_MAXENT_H__
+#define __ZIKA_MAXENT_H__
+
+#include <stddef.h>
+#include <vector>
+
+// Maximum entropy densities from the first moments, the problem of
+// UncertaintyQuantification/maxent_lagrange_mc.m: on a support [XMin, XMax]
+// discretized by Points points, the density exp(-sum_n lambda_n x^n) whose
+// moments of order 0..Moments-1 are the given ones, found by Newton's
+// method on the Lagrange multipliers lambda.
+//
+// Unlike the MATLAB code, every problem is solved in t = (2x - XMin -
+// XMax)/(XMax - XMin) on [-1, 1], where the moments are of order one
+// whatever the scale of x, and the Newton steps are damped (halved until
+// the dual objective lambda.mu + integral of the density decreases), so
+// that a poor initial guess cannot make the iteration diverge.
+struct maxent_settings { maxent_settings();
+ ~maxent_settings();
+
+  unsigned int Moments;       //constraints, the zeroth (mass 1) included
+  unsigned int Points;        //of the support grid
+  double Tolerance;           //on the moments in t, and on the relative step
+  unsigned int MaxIterations;
+  double Padding;             //support widened by this fraction of the sample
+                              //range on either side
+};
+
+// density of one variable
+struct maxent_density
+{
+  double XMin, XMax;          //support
+  std::vector<double> Lambda; //multipliers, of the powers of t (see above)
+  std::vector<double> Pdf;    //density in x at linspace(XMin, XMax, Points)
+  double Entropy;             //differential entropy in x
+  unsigned int Iterations;
+  bool Converged;
+  bool Degenerate;            //all samples equal: a point mass, Pdf left at 0
+};
+
+// Densities of n_vars variables from an ensemble, without copying it:
+// sample s of variable v is samples[s * sampleStride + v * varStride], so
+// rows of a qoi block (sampleStride = n_cols, varStride = 1) and the
+// columns of a .zbin file (sampleStride = 1, varStride = capacity) are
+// read in place. Samples that are not finite (failed solves) are left
+// out. The variables are solved __ZIKA_MAXENT_BATCH at a time, the batches
+// in parallel on OpenMP threads.
+void
+zikaMaxEntDensities(
+  const double*                   samples,
+  size_t                          n_samples,
+  unsigned int                    n_vars,
+  size_t                          sampleStride,
+  size_t                          varStride,
+  const maxent_settings&          settings,
+  std::vector<maxent_density>&    densities);
+
+// Same from given raw moments, as maxent_lagrange_mc(xmin, xmax, Nx, mu):
+// moments holds settings.Moments values per variable, mu_0 = 1 first, of
+// x itself, on supports [xMin[v], xMax[v]].
+void
+zikaMaxEntFromMoments(
+  const double*                   xMin,
+  const double*                   xMax,
+  const double*                   moments,
+  unsigned int                    n_vars,
+  const maxent_settings&          settings,
+  std::vector<maxent_density>&    densities);
+
+// variables solved together, their grids laid out side by side so the
+// accumulation of the moments and of the Hankel matrix over the grid is
+// one SIMD loop
+#ifndef __ZIKA_MAXENT_BATCH
+#define __ZIKA_MAXENT_BATCH 8
+#endif
+
+#endif
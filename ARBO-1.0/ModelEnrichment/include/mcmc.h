@@ -0,0 +1,127 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * This is the header file for src/mcmc.cpp. 
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_MCMC_H__
+#define __ZIKA_MCMC_H__
+
+#include "likelihood.h"
+#include <queso/Environment.h>
+#include <vector>
+
+// settings of the in-process Metropolis-Hastings sampler, filled from
+// zika_options
+struct mcmc_settings
+{
+  mcmc_settings();
+ ~mcmc_settings();
+
+  unsigned int NChains;       //chains run by every MPI process, one per thread at a time
+  unsigned int ChainLength;   //raw positions per chain, initial position included
+  double ProposalStd;         //std of the gaussian random walk, same for every delta
+  unsigned int FilterLag;     //keep one position in FilterLag for the filtered chain
+  unsigned int Seed;          //key of the Philox streams of every chain (see below)
+  double MaxTemp;             //population: temperature of the hottest chain
+  unsigned int ExchangeInterval; //population: steps between exchanges of cold positions
+  unsigned int Langevin;      //threads: MALA proposals from the likelihood gradient
+  unsigned int EarlyStop;     //stop solving a proposal once it is rejected (not for MALA)
+  unsigned int DelayedAcceptance;  //threads: screen proposals with a surrogate first
+  unsigned int SurrogateInterval;  //delayed: steps before the surrogate is first re-expanded
+  unsigned int BinaryOutput;  //write the chains as .zbin files (binfile.h), not .m
+  double RepFactor;           //under-reporting factor, recorded in the .zbin headers
+  unsigned int DiagnosticsPeriod;  //steps between convergence diagnostics, 0 for none
+  double TargetEss;           //stop once every delta has this ESS (0: run ChainLength)
+  double TargetRhat;          //... and a split R-hat at most this
+};
+
+// Philox streams, zika_philox(Seed, rank, stream), of the threaded chain c
+// of a process, and of the resampling of the filtered chains for the SFP
+// on that process. The SFP stream lies past those of every sampler
+// (chains, temperatures, smc weeks), so it never replays one of them
+#define __ZIKA_MH_CHAIN_STREAM(c) (1 + (c))
+#define __ZIKA_SFP_RESAMPLE_STREAM 0xFFFFFFFFu
+
+// Runs settings.NChains independent random-walk Metropolis-Hastings chains
+// on this process, on as many threads as OpenMP gives it, with a uniform
+// prior on [paramMin, paramMax]. Every chain owns its RNG and scratch and
+// calls zikaLogLikelihood, which leaves 'data' untouched.
+//
+// With settings.EarlyStop the uniform of each MH test is drawn before the
+// proposal is solved, and the solve stops at the first week where the
+// proposal can no longer be accepted (zikaLogLikelihoodBounded): same
+// chains, fewer weeks integrated for rejected proposals. The summary
+// printed by process 0 gives the weeks integrated per proposal.
+//
+// With settings.DelayedAcceptance every chain keeps a quadratic_surrogate of
+// the log-likelihood, expanded around its own position with the gradient
+// and Gauss-Newton hessian of a solve it has done, and each proposal first
+// goes through an MH test on the surrogate, its log-ratio dS bounded to
+// [-1, 1]; only those that pass are solved, and accepted with
+// exp(dL - dS) (Christen & Fox), so the chain still targets the exact
+// posterior. The surrogate is re-expanded after
+// SurrogateInterval steps, then at intervals that double, an adaptation
+// that dies out. The summary gives the share of full solves avoided.
+//
+// With settings.Langevin the proposals are MALA, drifted by the gradient
+// from zikaLogLikelihoodGradient (step ProposalStd).
+//
+// Every settings.DiagnosticsPeriod steps the chains wait for each other and
+// the chain_diagnostics (diagnostics.h) of all processes are combined:
+// batch-means ESS, split R-hat and autocorrelation per delta, written to
+// outputData/sip_mcmc_status.txt. With settings.TargetEss the chains stop
+// there once the smallest ESS reaches it and the largest R-hat is at most
+// settings.TargetRhat; the outputs then hold the positions run so far.
+//
+// Process 0 gathers the chains of all processes and writes them, one chain
+// after the other, in the layout of QUESO's outputs:
+//   outputData/sip_raw_chain.m, sip_raw_chain_logtarget.m,
+//   outputData/sip_filtered_chain.m, sip_filtered_chain_loglikelihood.m
+// or with settings.BinaryOutput appends every segment of DiagnosticsPeriod
+// positions of all chains, as it is done, to sip_raw_chain.zbin and
+// sip_filtered_chain.zbin, with the index of the chain as the last column.
+//
+// On return filteredChain holds this process' filtered positions, one row
+// of n_params values each.
+void zikaSolveThreadedMH(
+  const QUESO::FullEnvironment& env,
+  const likelihoodRoutine_Data& data,
+  const std::vector<double>&    paramMin,
+  const std::vector<double>&    paramMax,
+  const std::vector<double>&    paramInitials,
+  const mcmc_settings&          settings,
+  std::vector<double>&          filteredChain);
+
+// Population sampler: every process holds settings.NChains chains on a
+// geometric temperature ladder from 1 to settings.MaxTemp, stepped on
+// threads with differential-evolution proposals (DE-MCz) drawn from an
+// archive of past cold positions of all processes, plus swaps between
+// neighbouring temperatures. The archive grows through an MPI_Iallgather
+// posted every settings.ExchangeInterval steps and completed while the
+// chains keep stepping, so no process waits on the others during sampling.
+// The random numbers come from zika_philox streams of (Seed, process,
+// temperature), which never overlap whatever the number of processes and
+// chains.
+//
+// The cold chains of all processes are checked for convergence, and may
+// stop early, as in zikaSolveThreadedMH (the diagnostics are a blocking
+// collective, keep DiagnosticsPeriod a multiple of ExchangeInterval and
+// large against it), and written as for zikaSolveThreadedMH,
+// and process 0 appends one line of timings to
+// outputData/sip_population_scaling.txt:
+//   n_procs n_temps length wall_time steps_per_s busy_fraction max_wait
+void zikaSolvePopulation(
+  const QUESO::FullEnvironment& env,
+  const likelihoodRoutine_Data& data,
+  const std::vector<double>&    paramMin,
+  const std::vector<double>&    paramMax,
+  const std::vector<double>&    paramInitials,
+  const mcmc_settings&          settings,
+  std::vector<double>&          filteredChain);
+
+#endif
@@ -0,0 +1,77 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/mlmc.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_MLMC_H__
+#define __ZIKA_MLMC_H__
+
+#include "dynamics_info.h"
+#include <queso/Environment.h>
+#include <stdint.h>
+#include <vector>
+
+// settings of the multilevel SFP, filled from zika_options
+struct mlmc_settings
+{
+  mlmc_settings();
+ ~mlmc_settings();
+
+  unsigned int Levels;          //fixed-step levels below the adaptive solver
+  unsigned int CoarseSteps;     //RK4 steps per week of level 0, doubled at every level
+  double Tolerance;             //relative root mean square error of the mean cumulative cases
+  unsigned int InitialSamples;  //samples of every level in the first round, all processes
+  unsigned int MaxSamples;      //ceiling of the samples of one level, all processes
+  unsigned int GridPoints;      //points of the distribution function of every qoi
+  uint64_t Seed;                //draws are Philox streams of the seed, the sample and the level
+  double Sigma;                 //sd of the observation noise of the percentiles, 0 for none
+};
+
+// Statistical forward problem by multilevel Monte Carlo, in place of one
+// adaptive solve per posterior sample.
+//
+// Level l < settings.Levels solves the model with
+// zikaComputeModelFixedStep, CoarseSteps * 2^l RK4 steps per week; the
+// last level is the adaptive solver of zikaComputeModel, so the estimates
+// have the expectation of the usual SFP. Every sample of level l > 0 is a
+// pair of solves of the same deltas, at level l and at level l - 1, and
+// only adds their difference: the fine levels correct the many cheap
+// samples of level 0 with few samples, whose corrections vary little. The
+// deltas are rows of samples (n_local rows of n_params values, the
+// posterior samples of this process), drawn with replacement.
+//
+// After a first round of settings.InitialSamples samples per level, the
+// variance of the corrections and the wall time of a sample are measured
+// on every level, and the samples are raised to Giles' optimum
+// N_l = eps^-2 sqrt(V_l / C_l) sum_k sqrt(V_k C_k) for the cumulative
+// cases of every week, eps being settings.Tolerance times their mean,
+// until no level needs more. A fixed-step solve that blows up is done
+// again with twice the steps, then with the adaptive solver, the same way
+// for the fine and the coarse solve of a level, so that no sample is
+// dropped for its coarse solve; only the samples whose adaptive solve
+// fails are, as in the usual SFP. Both are counted per level.
+//
+// The percentiles are those of a distribution function estimated on
+// settings.GridPoints points per qoi in the same way (the indicator of
+// every qoi smoothed over one grid spacing, so the corrections stay
+// small), convolved with N(0, Sigma^2) when Sigma > 0, made monotone and
+// inverted. Process 0 writes them to statsFile in the layout of
+// zika_qoi_stats::write, the mean and standard error of every qoi to
+// outputData/sfp_mlmc_mean.txt and the samples, variance and cost of
+// every level to outputData/sfp_mlmc_levels.txt.
+void zikaSolveSfpMlmc(
+  const QUESO::FullEnvironment& env,
+  const std::vector<double>&    initialValues,
+  const std::vector<double>&    timePoints,
+  const dynamics_info*          p_dyn,
+  const std::vector<double>&    samples,
+  unsigned int                  n_params,
+  const mlmc_settings&          settings,
+  const char*                   statsFile);
+
+#endif
@@ -12,13 +12,165 @@
 #define __ZIKA_MODEL_H__
 
 #include "dynamics_info.h"
+#include <exception>
 #include <vector>
 
+//called by zikaComputeModel after output time i is stored, with Y the N_s+1
+//values at that time; returning false stops the solve there
+typedef bool (*zika_observer)(unsigned int i, const double Y[], void* context);
+
+//why a solve was given up
+enum zika_failure
+{
+  ZIKA_FAILURE_SOLVER = 1,    //GSL could not take a step (NaN, no progress)
+  ZIKA_FAILURE_RHS_CALLS,     //more than dynamics_info::MaxRhsCalls
+  ZIKA_FAILURE_MIN_STEP,      //step size below dynamics_info::MinStep
+  ZIKA_FAILURE_WALL_CLOCK     //longer than dynamics_info::MaxSeconds
+};
+
+//thrown by zikaComputeModel and zikaComputeSensitivities when a solve
+//fails or exceeds the budget of the dynamics_info, instead of stopping
+//the process; Reason is one of zika_failure
+struct zika_solve_failure : public std::exception
+{
+  zika_solve_failure(int reason) : Reason(reason) {}
+  const char* what() const throw();
+
+  int Reason;
+};
+
+//budget of the solve under way, checked by the right-hand side wrapper
+//the solver calls, see dynamics_info::MaxRhsCalls
+struct zika_budget
+{
+  int (*Rhs)(double t, const double Y[], double dYdt[], void* params);
+  unsigned long Calls;
+  unsigned long MaxCalls;
+  double        Deadline;   //steady clock, in seconds; 0 for none
+  int           Failure;    //zika_failure that stopped the solve, or 0
+};
+
+//what the right-hand side and jacobian receive as 'params': the shared,
+//read-only description of the system, the deltas of one evaluation and
+//the budget of the solve (NULL outside of the solvers)
+struct zika_system
+{
+  const dynamics_info * Dyn;
+  const double        * Deltas;
+  zika_budget         * Budget;
+};
+
+//generic right-hand side of the SEIR-SEI system plus inadequacy terms,
+//branches on dynamics_info::Inad_type at every call. params is a
+//zika_system, as for every Rhs/Jac below.
+int
+zikaFunction(
+  double        t,
+  const double  Y[],
+  double        dYdt[],
+  void*         params);
+
+//jacobian of zikaFunction (finite differences), fallback for systems
+//without a specialized kernel
+int
+zikaJacobian(
+  double        t,
+  const double  Y[],
+  double*       dfdY,
+  double        dfdt[],
+  void*         params);
+
+//set dynamics_info::Rhs and ::Jac to the kernels specialized for the
+//inadequacy type and number of species, call once after building the
+//dynamics_info
+void
+zikaSelectKernel(
+  dynamics_info*        p_dyn);
+
+//solves the model with the deltas held in p_dyn->Deltas; with
+//p_dyn->DenseOutput the stepper is not stopped at the output times, the
+//values there are interpolated from the steps it takes. Throws a
+//zika_solve_failure when GSL cannot go on or the budget of p_dyn is spent
+void
+zikaComputeModel(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  dynamics_info*              p_dyn,
+  std::vector<double>&        returnValues);
+
+//same, with the deltas of this evaluation passed in: p_dyn is not written,
+//so this version can run concurrently on several threads
 void
 zikaComputeModel(
-  std::vector<double>&  initialValues,
-  std::vector<double>&  timePoints,
-  dynamics_info*        p_dyn,
-  std::vector<double>&  returnValues);
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info*        p_dyn,
+  const double*               deltas,
+  std::vector<double>&        returnValues);
+
+//same, calling observer(i, Y, context) at every output time, the initial
+//one included; returns the number of output times stored (the remaining
+//rows of returnValues are left as they were)
+unsigned int
+zikaComputeModel(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info*        p_dyn,
+  const double*               deltas,
+  std::vector<double>&        returnValues,
+  zika_observer               observer,
+  void*                       context);
+
+//same, with the classical fourth-order Runge-Kutta method and
+//stepsPerInterval fixed steps between consecutive output times, no error
+//control and no budget: the cheap, coarse solves of the multilevel SFP
+//(src/mlmc.cpp). Throws a zika_solve_failure when the state is no longer
+//finite, as a step too long for the dynamics makes it blow up
+void
+zikaComputeModelFixedStep(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info*        p_dyn,
+  const double*               deltas,
+  unsigned int                stepsPerInterval,
+  std::vector<double>&        returnValues);
+
+//steps taken by the solves of this process (all threads), as counted by
+//GSL's evolve object, or by the ensemble integrator lane by lane
+struct zika_solver_stats
+{
+  unsigned long Solves;
+  unsigned long Steps;      //accepted steps
+  unsigned long Rejected;   //steps retried with a smaller step size
+  unsigned long Failed;     //solves given up, see zika_solve_failure
+};
+
+zika_solver_stats
+zikaSolverStats();
+
+void
+zikaResetSolverStats();
+
+//adds to the counts of zikaSolverStats
+void
+zikaCountSteps(
+  unsigned long               solves,
+  unsigned long               steps,
+  unsigned long               rejected,
+  unsigned long               failed = 0);
+
+//same solve plus the forward sensitivities of every output to the deltas:
+//sensitivities[(dim*j + i)*n_params + p] = d returnValues[dim*j + i] / d deltas[p],
+//with n_params = Params_factor*N_s, sized N_times*dim*n_params by the
+//caller. Returns false, and computes nothing, when p_dyn has no
+//specialized kernel (see dynamics_info::SensRhs).
+bool
+zikaComputeSensitivities(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info*        p_dyn,
+  const double*               deltas,
+  std::vector<double>&        returnValues,
+  std::vector<double>&        sensitivities);
 
 #endif
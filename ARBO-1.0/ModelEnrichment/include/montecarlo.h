@@ -0,0 +1,146 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/montecarlo.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_MONTECARLO_H__
+#define __ZIKA_MONTECARLO_H__
+
+#include "dynamics_info.h"
+#include "philox.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//inputs of the SEIR-SEI model sampled by the Monte Carlo engine, in the
+//order of its output columns (the parameters of rhs_SEIR_SEI.m, then the
+//initial conditions; SH0 = N - EH0 - IH0 - RH0 and SV0 = 1 - EV0 - IV0)
+enum zika_mc_input
+{
+  ZIKA_MC_N = 0,    //human population size
+  ZIKA_MC_BETAH,    //vector-to-human transmission rate (days^-1)
+  ZIKA_MC_ALPHAH,   //human latent rate (days^-1)
+  ZIKA_MC_GAMMA,    //human recovery rate (days^-1)
+  ZIKA_MC_BETAV,    //human-to-vector transmission rate (days^-1)
+  ZIKA_MC_ALPHAV,   //vector latent rate (days^-1)
+  ZIKA_MC_DELTA,    //vector birth/mortality rate (days^-1)
+  ZIKA_MC_EH0,      //initial exposed humans
+  ZIKA_MC_IH0,      //initial infectious humans
+  ZIKA_MC_RH0,      //initial recovered humans
+  ZIKA_MC_EV0,      //initial proportion of exposed vectors
+  ZIKA_MC_IV0,      //initial proportion of infectious vectors
+  ZIKA_MC_C0,       //initial cumulative cases
+  ZIKA_MC_INPUTS
+};
+
+//distribution of one input
+enum zika_distribution
+{
+  ZIKA_DIST_FIXED = 0,  //A
+  ZIKA_DIST_UNIFORM,    //on [A, B]
+  ZIKA_DIST_NORMAL,     //mean A, std B
+  ZIKA_DIST_LOGNORMAL,  //log of it normal, mean A, std B
+  ZIKA_DIST_GAMMA,      //shape A, scale B
+  ZIKA_DIST_MAXENT      //maximum entropy on [A, B] with mean C: a truncated
+                        //exponential (maxent_lagrange_mc.m)
+};
+
+struct zika_random_input { zika_random_input();
+ ~zika_random_input();
+
+  //parses "fixed a", "uniform a b", "normal mu sigma", "lognormal mu sigma",
+  //"gamma k theta" or "maxent a b mean"; false if it cannot
+  bool parse(const std::string& text);
+
+  //one draw from the stream of this input
+  double sample(zika_philox& rng) const;
+
+  unsigned int Type;
+  double A, B, C;
+  double Lambda;      //maxent: rate of the exponential, solved by parse
+};
+
+//a Monte Carlo run, read from a 'key = value' file (see inputs/mc.inp)
+struct mc_problem { mc_problem(const char* fileName);
+ ~mc_problem();
+
+  zika_random_input Inputs[ZIKA_MC_INPUTS];   //mc_<name> = <distribution>
+  unsigned int Samples;       //mc_samples
+  uint64_t Seed;              //mc_seed
+  unsigned int NWeeks;        //mc_nWeeks: outputs every 7 days from day 7
+  unsigned int Solver;        //mc_solver: as zika_solver
+  unsigned long MaxRhsCalls;  //mc_maxRhsCalls: budget of one solve, 0 for none
+  unsigned int BlockSize;     //mc_blockSize: samples solved between writes
+  double Tolerance;           //mc_tolerance: stop once the estimates are this accurate, 0 for never
+  unsigned int MinSamples;    //mc_minSamples: ... but not before this many samples
+  std::string Output;         //mc_output: .zbin file of the ensemble
+  unsigned int MaxEntMoments; //mc_maxentMoments: of the densities of the cases, 0 for none
+  unsigned int MaxEntPoints;  //mc_maxentPoints: of their support grids
+  std::string MaxEntOutput;   //mc_maxentOutput: <prefix>.txt and <prefix>.zbin
+  bool Ok;                    //every line of the file was understood
+};
+
+//name of input i, as in the mc_ keys and the output columns
+const char* zikaMcInputName(unsigned int i);
+
+//the inputs of sample s, a pure function of (problem.Seed, s)
+void
+zikaDrawInputs(
+  const mc_problem&             problem,
+  uint64_t                      s,
+  double                        inputs[]);
+
+//solves the model for one set of inputs with dyn (a dynamics_info of
+//inad_type 0 owned by the calling thread; its rates are overwritten) and
+//writes the weekly new cases and cumulative cases, NWeeks of each. The
+//new cases of week 0 are the initial cumulative cases, as in the MATLAB
+//examples. Returns false, and NaNs, when the solve fails.
+bool
+zikaSolveSample(
+  const double                  inputs[],
+  const std::vector<double>&    timePoints,
+  dynamics_info&                dyn,
+  std::vector<double>&          returnValues,
+  double                        newCases[],
+  double                        cumCases[]);
+
+//totals of a run
+struct mc_summary
+{
+  unsigned int Samples;
+  unsigned int Failed;
+  double Seconds;
+  double MeanFinalCases;  //cumulative cases at the last week, failures left out
+  double RelativeError;   //largest of mc_convergence, when a tolerance is set
+  bool Converged;
+};
+
+//Monte Carlo over samples [0, problem.Samples) of problem, on every thread
+//OpenMP gives, in blocks of BlockSize samples written in sample order to
+//problem.Output: one row per sample, columns the ZIKA_MC_INPUTS inputs,
+//then NC_w0..NC_w{NWeeks-1}, then C_w0..C_w{NWeeks-1}. The file is the
+//same bit for bit whatever the number of threads. With a Tolerance, the
+//run stops after the first block at which the running estimates of the
+//epidemic quantities (convergence.h) are accurate enough, Samples being
+//the ceiling; their progress goes to problem.Output with .conv.txt in
+//place of its extension. The blocks are checked in sample order, so
+//where the run stops does not depend on the threads either.
+mc_summary
+zikaRunMonteCarlo(
+  const mc_problem&             problem);
+
+//maximum entropy densities (src/maxent.cpp) of the NC_w* and C_w* columns
+//of problem.Output, read in place: multipliers and supports to
+//MaxEntOutput.txt, the densities on their grids to MaxEntOutput.zbin (one
+//column per variable, MaxEntPoints rows). Returns the number of densities
+//that did not converge, or -1 if a file could not be opened.
+int
+zikaMcMaxEnt(
+  const mc_problem&             problem);
+
+#endif
@@ -0,0 +1,105 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * This is the header file for src/options.cpp. 
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_OPTIONS_H__
+#define __ZIKA_OPTIONS_H__
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+enum zika_sampler
+{
+  ZIKA_SAMPLER_QUESO = 0,     //QUESO's Metropolis-Hastings, inputs/mhInput.inp
+  ZIKA_SAMPLER_THREADS,       //independent chains on threads, src/mcmc.cpp
+  ZIKA_SAMPLER_POPULATION,    //tempered DE-MC chains over MPI processes, src/mcmc.cpp
+  ZIKA_SAMPLER_MALA,          //as threads, with Langevin proposals from the gradient
+  ZIKA_SAMPLER_DELAYED,       //as threads, with a surrogate screening stage
+  ZIKA_SAMPLER_SMC,           //particle filter over the weeks of data, src/smc.cpp
+};
+
+// run options of the zika model that are not QUESO's, read from a plain
+// 'key = value' file (see inputs/zika.inp). Keys missing from the file,
+// or a missing file, keep the defaults set in the constructor. The few
+// defaults taken from QUESO's options are read from quesoFileName, in the
+// same format, when given.
+struct zika_options { zika_options(const char* fileName, const char* quesoFileName = NULL);
+ ~zika_options();
+
+  unsigned int Solver;        //zika_solver: one of enum zika_solver
+  unsigned int WarmStart;     //zika_warmStart: reuse the last initial step size
+  double WarmStartRadius;     //zika_warmStartRadius: max |delta change| for it
+  unsigned int DenseOutput;   //zika_denseOutput: interpolate the output times
+  unsigned int ScaledTolerance; //zika_scaledTolerance: per-component absolute tolerance
+  double PositivityWidth;     //zika_positivityWidth: smooth ramp instead of clamping
+  unsigned int MaxRhsCalls;   //zika_maxRhsCalls: budget of one solve, 0 for none
+  double MinStep;             //zika_minStep: smallest step size allowed, 0 for none
+  double MaxSeconds;          //zika_maxSeconds: wall-clock budget of one solve, 0 for none
+  double FailureLogLikelihood; //zika_failureLogLikelihood: of a solve given up
+  unsigned int SfpBatch;      //zika_sfpBatch: solve the SFP with the ensemble integrator
+  unsigned int SfpSamples;    //zika_sfpSamples: number of qoi samples in that case, at most
+                              //with a tolerance; fp_mc_qseq_size by default
+  double SfpTolerance;        //zika_sfpTolerance: stop once the estimates are this accurate, 0 for never
+  unsigned int SfpMinSamples; //zika_sfpMinSamples: ... but not before this many samples
+  unsigned int SfpMlmc;       //zika_sfpMlmc: solve the SFP by multilevel Monte Carlo
+  unsigned int MlmcLevels;    //zika_mlmcLevels: fixed-step RK4 levels below the adaptive solver
+  unsigned int MlmcCoarseSteps; //zika_mlmcCoarseSteps: RK4 steps per week of the coarsest level
+  double MlmcTolerance;       //zika_mlmcTolerance: relative error of the mean cumulative cases
+  unsigned int MlmcInitialSamples; //zika_mlmcInitialSamples: samples per level of the first round
+  unsigned int MlmcMaxSamples; //zika_mlmcMaxSamples: ceiling of the samples of one level
+  unsigned int MlmcGrid;      //zika_mlmcGrid: points of the distribution function of every qoi
+  unsigned int Sampler;       //zika_sampler: one of enum zika_sampler
+  unsigned int NChains;       //zika_nChains: chains per process for the threads sampler
+  unsigned int ChainLength;   //zika_chainLength: positions per chain
+  double ProposalStd;         //zika_proposalStd: random walk std
+  unsigned int FilterLag;     //zika_filterLag: lag of the filtered chain
+  unsigned int Seed;          //zika_seed: base seed of the chains
+  double MaxTemp;             //zika_maxTemp: hottest temperature of the population
+  unsigned int ExchangeInterval; //zika_exchangeInterval: steps between exchanges
+  unsigned int EarlyStop;     //zika_earlyStop: in-process samplers stop rejected solves early
+  unsigned int SurrogateInterval; //zika_surrogateInterval: steps before the surrogate is re-expanded
+  unsigned int MapSeed;       //zika_mapSeed: start QUESO's chain from its MAP estimate
+  unsigned int BinaryOutput;  //zika_binaryOutput: .zbin chains and qois instead of .m
+  unsigned int QoiStats;      //zika_qoiStats: streaming percentiles of the SFP qois
+  unsigned int QoiNoise;      //zika_qoiNoise: convolve them with the observation noise
+  unsigned int DiagnosticsPeriod; //zika_diagnosticsPeriod: ip_mh_rawChain_displayPeriod by default
+  double TargetEss;           //zika_targetEss: stop the chains at this ESS, 0 for never
+  double TargetRhat;          //zika_targetRhat: ... and this split R-hat
+  unsigned int SmcParticles;  //zika_smcParticles: particles per process of the smc sampler
+  double SmcEssFraction;      //zika_smcEssFraction: resample below this share of ESS
+  unsigned int SmcMoves;      //zika_smcMoves: MH moves per particle after resampling
+  std::string SmcState;       //zika_smcState: prefix of the particle files, 'none' for none
+  unsigned int SmcForecast;   //zika_smcForecast: forecast the cases from the particles
+  std::string Data;           //zika_data: weekly new cases, see include/cases.h
+  std::string DataRegion;     //zika_dataRegion: its column of cases, by name or number
+  unsigned int NWeeks;        //zika_nWeeks: weeks of the model run, 0 for those of the data
+  double RepFactor;           //zika_repFactor: under-reporting factor of the data
+  double Var;                 //zika_var: variance of the data
+  std::vector<double> SweepRepFactors; //zika_sweepRepFactors: rep_factors of the sweep, comma separated
+  std::vector<double> SweepVars; //zika_sweepVars: ... and their variances, zika_var by default
+  double SweepEssFraction;    //zika_sweepEssFraction: sample again below this share of ESS
+  std::string SweepStore;     //zika_sweepStore: the samples reweighted by the sweep
+
+private:
+  void parse(const char* fileName);
+  void read(const char* key, unsigned int & value) const;
+  void read(const char* key, double & value) const;
+  void read(const char* key, std::string & value) const;
+  void read(const char* key, std::vector<double> & values) const;
+
+  std::map<std::string, std::string> m_entries;
+};
+
+// sets solver to the zika_solver named name (rkf45, rk8pd, msbdf, bsimp,
+// rk4imp); false, and solver unchanged, for any other name
+bool zikaParseSolver(const std::string& name, unsigned int& solver);
+
+#endif
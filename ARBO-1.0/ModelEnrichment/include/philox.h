@@ -0,0 +1,87 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Counter-based random numbers (Philox4x32-10, Salmon et al., SC'11,
+ * the generator of Random123), for Monte Carlo runs whose results do
+ * not depend on how the samples are spread over threads.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_PHILOX_H__
+#define __ZIKA_PHILOX_H__
+
+#include <stdint.h>
+#include <cmath>
+
+// ten rounds of Philox4x32 on counter ctr with key key
+inline void zikaPhilox4x32(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4])
+{
+  uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+  uint32_t k0 = key[0], k1 = key[1];
+  for (unsigned int r = 0; r < 10; r++){
+    const uint64_t p0 = (uint64_t) 0xD2511F53u * c0;
+    const uint64_t p1 = (uint64_t) 0xCD9E8D57u * c2;
+    const uint32_t n0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+    const uint32_t n2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+    c1 = (uint32_t) p1;
+    c3 = (uint32_t) p0;
+    c0 = n0;
+    c2 = n2;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+// The random numbers of one (sample, stream) pair: the key is the seed and
+// the counter is (draw, stream, sample), so every draw is a pure function
+// of the seed, the sample, the stream and its rank in the stream - not of
+// the thread, nor of the samples drawn before. Each random input of a
+// sample uses its own stream, so adding one does not change the others.
+struct zika_philox { zika_philox(uint64_t seed, uint64_t sample, uint32_t stream)
+: m_used(4)
+{
+  m_key[0] = (uint32_t) seed;
+  m_key[1] = (uint32_t) (seed >> 32);
+  m_ctr[0] = 0;
+  m_ctr[1] = stream;
+  m_ctr[2] = (uint32_t) sample;
+  m_ctr[3] = (uint32_t) (sample >> 32);
+}
+
+  uint32_t next()
+  {
+    if (m_used == 4) {
+      zikaPhilox4x32(m_ctr, m_key, m_out);
+      m_ctr[0]++;
+      m_used = 0;
+    }
+    return m_out[m_used++];
+  }
+
+  // uniform in (0, 1), 53 random bits, never 0 nor 1
+  double uniform()
+  {
+    const uint64_t bits = ((uint64_t) next() << 21) ^ (next() >> 11);
+    return (bits + 0.5) * (1. / 9007199254740992.);
+  }
+
+  // standard normal, Box-Muller (the second value is not kept, every
+  // normal costs two uniforms and the sequence does not depend on parity)
+  double normal()
+  {
+    const double u = uniform(), v = uniform();
+    return std::sqrt(-2. * std::log(u)) * std::cos(2. * M_PI * v);
+  }
+
+private:
+  uint32_t m_key[2];
+  uint32_t m_ctr[4];
+  uint32_t m_out[4];
+  unsigned int m_used;
+};
+
+#endif
@@ -12,6 +12,7 @@
 #define __ZIKA_QOI_H__
 
 #include "dynamics_info.h"
+#include "quantiles.h"
 #include <queso/GslMatrix.h>
 #include <queso/DistArray.h>
 
@@ -28,6 +29,16 @@ struct qoiRoutine_Data
   const std::vector<double> & m_times;
   std::vector<double> & m_ics;
   dynamics_info       * m_dynMain;
+
+  //scratch for the model output, sized once here
+  std::vector<double>   m_returnValues;
+
+  //scratch for qoiRoutineBatch
+  std::vector<int>      m_batchStatus;
+
+  //when not NULL, every qoi row solved is added to these sketches (failed
+  //solves are left out); set by the caller
+  zika_qoi_stats      * m_stats;
 };
 
 void qoiRoutine(
@@ -39,4 +50,13 @@ void qoiRoutine(
         QUESO::DistArray<QUESO::GslMatrix* >* hessianMatrices,
         QUESO::DistArray<QUESO::GslVector* >* hessianEffects);
 
+// qoi of n_samples parameter vectors at once (one row of n_params values
+// each in paramValues), solved together by the ensemble integrator.
+// qoiValues gets one row of n_times * dim values per sample.
+void qoiRoutineBatch(
+  const std::vector<double>& paramValues,
+  unsigned int               n_samples,
+  const void*                functionDataPtr,
+  std::vector<double>&       qoiValues);
+
 #endif
@@ -0,0 +1,81 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/quantiles.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_QUANTILES_H__
+#define __ZIKA_QUANTILES_H__
+
+#include <vector>
+
+// Streaming quantile sketch (merging t-digest, Dunning & Ertl): the values
+// seen are summarized by at most ~Compression weighted centroids, small
+// near the tails and larger around the median, so the quantiles far out
+// stay accurate. Two sketches merge by adding the centroids of one to the
+// other, which is how the sketches of the MPI processes are combined.
+struct zika_tdigest { zika_tdigest(double compression = 100.);
+ ~zika_tdigest();
+
+  void add(double x, double weight = 1.);
+
+  // adds every centroid of other, as a weighted value
+  void merge(const zika_tdigest& other);
+
+  // quantile q of the values added; with sigma > 0, of those values plus
+  // N(0, sigma^2) noise, i.e. of the mixture of gaussians centered on the
+  // centroids, whose CDF is inverted by bisection
+  double quantile(double q, double sigma = 0.);
+
+  double weight() const { return m_weight + m_bufferWeight; }
+
+  // centroids after merging the buffer in
+  const std::vector<double>& means() { compress(); return m_means; }
+  const std::vector<double>& weights() { compress(); return m_weights; }
+
+private:
+  void compress();
+
+  double              m_compression;
+  std::vector<double> m_means;
+  std::vector<double> m_weights;
+  double              m_weight;
+  std::vector<double> m_bufferMeans;
+  std::vector<double> m_bufferWeights;
+  double              m_bufferWeight;
+  double              m_min;
+  double              m_max;
+};
+
+// one zika_tdigest per qoi, fed with the qoi rows as the SFP solves them
+struct zika_qoi_stats { zika_qoi_stats(unsigned int n_qoi, double compression = 200.);
+ ~zika_qoi_stats();
+
+  // adds one row of n_qoi values
+  void add(const double* qois);
+
+  // centroids of every sketch one after the other, as (mean, weight)
+  // pairs, and the number of centroids of each, for sending to process 0
+  void pack(std::vector<double>& buffer, std::vector<int>& counts);
+
+  // merges centroids packed by another process
+  void unpack(const double* buffer, const int* counts);
+
+  // writes one line per qoi with its median and 2.5, 17.5, 82.5, 97.5
+  // percentiles, floored at zero, the layout of qoi-stats written by
+  // postprocessing/compute-percents.py. sigma is the std of the
+  // observation noise to convolve with (0 for none).
+  void write(const char* fileName, double sigma);
+
+  unsigned int size() const { return m_digests.size(); }
+  zika_tdigest& operator[](unsigned int i) { return m_digests[i]; }
+
+private:
+  std::vector<zika_tdigest> m_digests;
+};
+
+#endif
@@ -0,0 +1,127 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * Templated right-hand side of the SEIR-SEI system plus inadequacy
+ * terms, shared by the scalar kernels in src/model.cpp and the ensemble
+ * integrator in src/ensemble.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_RHS_H__
+#define __ZIKA_RHS_H__
+
+#include "dynamics_info.h"
+#include <cmath>
+
+//number of discrepancy parameters per state variable for each inadequacy
+//formulation, must agree with params_factor in computeParams
+template <unsigned int INAD, unsigned int NS>
+struct inad_traits
+{
+  static const unsigned int pf =
+    (INAD == 0) ? 1 : (INAD == 1) ? 2 : (INAD == 2) ? 6 : 2 * NS;
+};
+
+//negative states are clamped to zero before entering the right-hand side
+inline double clampPositive(double x)
+{
+  return (x <= 0) ? 0. : x;
+}
+
+//smooth alternative (dynamics_info::PositivityWidth): 0 below 0, x above
+//w, and the cubic 2x^2/w - x^3/w^2 in between, which joins both with a
+//continuous derivative, so the stepper sees no kink
+inline double smoothPositive(double x, double w)
+{
+  if (x <= 0) return 0.;
+  if (x >= w) return x;
+  const double s = x / w;
+  return x * s * (2. - s);
+}
+
+//the SEIR-SEI model itself, on states already made positive. R is the
+//type of the rates {beta_h, alpha_h, gamma, beta_v, alpha_v, delta}:
+//double, or dual<> when the sensitivities to them are wanted (see
+//src/calibration.cpp)
+template <typename T, typename R>
+inline void zikaSeirSei( const T pops[],
+                         T dYdt[],
+                         const R & bh,
+                         const R & ah,
+                         const R & g,
+                         const R & bv,
+                         const R & av,
+                         const R & d,
+                         double nv,
+                         double nh)
+{
+  dYdt[0] = -bh * pops[0] * pops[6] / nv;
+  dYdt[1] = bh * pops[0] * pops[6] / nv - ah * pops[1];
+  dYdt[2] = ah * pops[1]  - g * pops[2];
+  dYdt[3] = g * pops[2];
+  dYdt[4] = d * nv - bv * pops[4] * pops[2] / nh - d * pops[4];
+  dYdt[5] = bv * pops[4] * pops[2] / nh - (av + d) * pops[5];
+  dYdt[6] = av * pops[5] - d * pops[6];
+  dYdt[7] = ah * pops[1];
+}
+
+//same right-hand side as zikaFunction, but specialized at compile time on
+//the inadequacy formulation and the number of species: there is no branch
+//on inad_type and every loop has a fixed trip count, so the compiler can
+//unroll and vectorize it.
+//T is the state type: double for the solve, dual<> when the jacobian is
+//taken by forward-mode differentiation, lanes<> when a block of samples is
+//integrated together. P is the type of the deltas (double, or lanes<> with
+//one parameter set per lane).
+template <unsigned int INAD, unsigned int NS, typename T, typename P>
+inline void zikaRhs( const T Y[],
+                     T dYdt[],
+                     const P delta[],
+                     const dynamics_info & dyn)
+{
+  using std::abs;
+  const unsigned int pf = inad_traits<INAD,NS>::pf;
+
+  T pops[NS + 1];
+  if (dyn.PositivityWidth > 0.) {
+    for (unsigned int i = 0; i < NS + 1; i++){
+      pops[i] = smoothPositive(Y[i], dyn.PositivityWidth * dyn.Scale(i));
+    }
+  }
+  else {
+    for (unsigned int i = 0; i < NS + 1; i++){
+      pops[i] = clampPositive(Y[i]);
+    }
+  }
+
+  //SEIR-SEI model
+  zikaSeirSei(pops, dYdt, dyn.Bh, dyn.Ah, dyn.G, dyn.Bv, dyn.Av, dyn.D, dyn.Nv, dyn.Nh);
+
+  //inadequacy formulation, INAD is a constant so only one branch survives
+  if (INAD == 1) {
+    for (unsigned int i = 0; i < NS; i++){
+      dYdt[i] += delta[pf*i+0]*pops[i] + delta[pf*i+1]*abs(dYdt[i]);
+    }
+  }
+  else if (INAD == 2) {
+    for (unsigned int i = 0; i < NS; i++){
+      dYdt[i] += delta[pf*i+0]*pops[i] + delta[pf*i+1]*abs(dYdt[i]) +
+          delta[pf*i+2]*(pops[i]*pops[i]) + delta[pf*i+3]*(dYdt[i]*dYdt[i]);
+    }
+  }
+  else if (INAD == 3) {
+    //dYdt is updated in place, so row i sees the already corrected rows
+    //j < i, exactly as in zikaFunction
+    for (unsigned int i = 0; i < NS; i++){
+      for (unsigned int j = 0; j < NS; j++){
+        dYdt[i] += delta[pf*i + 2*j +0]*pops[j] + delta[pf*i + 2*j + 1]*abs(dYdt[j]);
+        dYdt[i] += delta[pf*i + 2*j +2]*(pops[j]*pops[j]) + delta[pf*i + 2*j + 3]*(dYdt[j]*dYdt[j]);
+      }
+    }
+  }
+}
+
+#endif
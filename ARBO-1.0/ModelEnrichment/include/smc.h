@@ -0,0 +1,80 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/smc.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_SMC_H__
+#define __ZIKA_SMC_H__
+
+#include "likelihood.h"
+#include <queso/Environment.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// settings of the sequential Monte Carlo assimilation, filled from
+// zika_options
+struct smc_settings
+{
+  smc_settings();
+ ~smc_settings();
+
+  unsigned int Particles;     //particles of every MPI process
+  double EssFraction;         //resample once the ESS falls below this share of them
+  unsigned int Moves;         //MH moves of every particle after a resampling
+  uint64_t Seed;              //draws are Philox streams of the seed and the particle
+  std::string State;          //prefix of the particle files kept between runs, '' for none
+  unsigned int Forecast;      //write the forecast of the cases from the particles
+  double RepFactor;           //under-reporting factor, recorded in the .zbin headers
+};
+
+// Sequential Monte Carlo (resample-move particle filter) over the weekly
+// cumulative cases of data, as an incremental alternative to running the
+// chains again on the whole data set every week.
+//
+// Every process keeps settings.Particles weighted particles, each a vector
+// of deltas, the state of the model at the last week assimilated and the
+// log-likelihood of the weeks so far. The population starts from the
+// uniform prior on [paramMin, paramMax] at week 0 (the initial condition);
+// a new week moves every particle's state over that one week only and
+// multiplies its weight by the likelihood of the new count. When the
+// effective sample size drops below settings.EssFraction times the
+// particles, they are resampled (systematic) and rejuvenated with
+// settings.Moves random-walk MH moves each, scaled by the spread of the
+// population and solved from week 0 with the early stop of
+// zikaLogLikelihoodBounded. The particles are spread over the OpenMP
+// threads, and all draws are Philox streams, so the result does not
+// depend on the number of threads.
+//
+// With settings.State, the particles of process r are read from
+// <State>-<r>.zbin when it matches this run (same deltas, model and number
+// of particles, no more weeks than the data, and the same counts for the
+// weeks it assimilated, variance and seed, kept as a hash in the name of
+// its last column), only the weeks of the data
+// past it are assimilated, and the file is rewritten at the end: running
+// again after one more week of data costs one week of integration per
+// particle, plus the moves if the ESS drops.
+//
+// The weeks assimilated are the observed ones of data (data.m_nObserved),
+// as in the other samplers' likelihoods. Process 0 writes the particles of
+// all processes, equally weighted, to outputData/sip_smc_particles.zbin,
+// the ESS, resampling and acceptance of every week to
+// outputData/sip_smc_status.txt, and with settings.Forecast the cumulative
+// cases of every particle from the last week assimilated to week N_times-1
+// to outputData/sip_smc_forecast.zbin. On return filteredChain holds this
+// process' particles resampled to equal weights, one row of n_params
+// values each, for the SFP.
+void zikaSolveSmc(
+  const QUESO::FullEnvironment& env,
+  const likelihoodRoutine_Data& data,
+  const std::vector<double>&    paramMin,
+  const std::vector<double>&    paramMax,
+  const smc_settings&           settings,
+  std::vector<double>&          filteredChain);
+
+#endif
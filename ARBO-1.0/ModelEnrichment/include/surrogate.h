@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * This is the header file for src/surrogate.cpp. 
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_SURROGATE_H__
+#define __ZIKA_SURROGATE_H__
+
+#include <vector>
+
+// Quadratic surrogate of the log-likelihood over the deltas: its second
+// order expansion around an anchor point, with the gradient and the
+// Gauss-Newton hessian from zikaLogLikelihoodGradient. Evaluating it costs
+// O(n_params^2), against a full solve of the model.
+struct quadratic_surrogate
+{
+  quadratic_surrogate(unsigned int n_params);
+ ~quadratic_surrogate();
+
+  // expands around anchor, where the log-likelihood is value; hessian is
+  // n_params x n_params, row major
+  void expand(const double* anchor, double value, const double* gradient,
+              const double* hessian);
+
+  // surrogate log-likelihood at x, only meaningful once ready()
+  double predict(const double* x) const;
+
+  bool ready() const { return m_ready; }
+
+private:
+  unsigned int m_params;
+  bool m_ready;
+  std::vector<double> m_anchor;
+  double m_value;
+  std::vector<double> m_gradient;
+  std::vector<double> m_hessian;
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This is the header file for src/sweep.cpp.
+ *-----------------------------------------------------------------*/
+
+#ifndef __ZIKA_SWEEP_H__
+#define __ZIKA_SWEEP_H__
+
+#include "likelihood.h"
+#include <queso/Environment.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// posterior samples of a sweep over the under-reporting factor and the
+// variance of the data: the deltas of every sample with its
+// log-likelihood and cumulative cases at every week, as solved for one
+// rep_factor
+struct sweep_samples
+{
+  sweep_samples();
+ ~sweep_samples();
+
+  unsigned int N;                     //samples
+  double RepFactor;                   //of the initial conditions the cases were solved with
+  std::vector<double> Deltas;         //N rows of n_params
+  std::vector<double> LogLikelihood;  //N, m_failureLogLikelihood for a failed solve
+  std::vector<double> Cases;          //N rows of N_times, NAN for a failed solve
+};
+
+// gathers this process' filteredChain (rows of n_params deltas) with
+// those of all other processes into samples.Deltas, on every process
+void zikaSweepGather(
+  const QUESO::FullEnvironment& env,
+  const std::vector<double>&    filteredChain,
+  unsigned int                  n_params,
+  sweep_samples&                samples);
+
+// solves every row of samples.Deltas with the initial conditions, data and
+// variance of data: samples.Cases over all N_times weeks and
+// samples.LogLikelihood over the observed ones, on every process. The rows are shared out over the processes and their OpenMP
+// threads
+void zikaSweepSolve(
+  const QUESO::FullEnvironment& env,
+  const likelihoodRoutine_Data& data,
+  unsigned int                  n_params,
+  double                        rep_factor,
+  sweep_samples&                samples);
+
+// log-likelihood of every sample against the observed weeks of data.m_csc
+// (data.m_nObserved) and data.m_var from its stored cases, without
+// solving: for an alternative with the same rep_factor as the samples.
+// logLikelihood gets N values
+void zikaSweepLogLikelihood(
+  const likelihoodRoutine_Data& data,
+  const sweep_samples&          samples,
+  std::vector<double>&          logLikelihood);
+
+// the samples and their cases as a .zbin file (columns delta_<p>,
+// log_likelihood, C_w<j>), written by process 0, and read back; read
+// returns false when there is no such file or it does not match n_params
+// and n_weeks
+void zikaSweepWrite(
+  const QUESO::FullEnvironment& env,
+  const char*                   fileName,
+  const sweep_samples&          samples,
+  unsigned int                  n_params,
+  unsigned int                  n_weeks,
+  unsigned int                  dim);
+
+bool zikaSweepRead(
+  const char*                   fileName,
+  unsigned int                  n_params,
+  unsigned int                  n_weeks,
+  sweep_samples&                samples);
+
+// self-normalized importance weights from log-weights (zero for samples
+// whose cases are not finite); returns their effective sample size
+// (sum w)^2 / sum w^2
+double zikaSweepWeights(
+  const std::vector<double>&    logWeights,
+  const sweep_samples&          samples,
+  std::vector<double>&          weights);
+
+// from process 0: a line of summary (rep_factor, var, ESS, samples,
+// resampled, weighted mean and sd of every delta), and the file casesName
+// with, for every week, the data of the alternative (nan for the weeks
+// after the observed ones), the weighted mean of the cumulative cases and
+// the median, 2.5, 17.5, 82.5 and 97.5 percentiles of the cases plus the
+// N(0, var) observation noise
+void zikaSweepReport(
+  FILE*                         summary,
+  const char*                   casesName,
+  const likelihoodRoutine_Data& data,
+  double                        rep_factor,
+  double                        ess,
+  bool                          resampled,
+  const sweep_samples&          samples,
+  const std::vector<double>&    weights,
+  unsigned int                  n_params);
+
+#endif
@@ -0,0 +1,61 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ *
+ * Monte Carlo propagation of the parameter and initial condition
+ * uncertainty of the SEIR-SEI model (src/montecarlo.cpp), in place of
+ * UncertaintyQuantification/main_SEIR_SEI_MC_example*.m. Writes the
+ * weekly new and cumulative cases of every sample to a .zbin file, read
+ * by postprocessing/zikabin.py, and the maximum entropy densities of
+ * those cases (src/maxent.cpp).
+ *
+ *   make mc
+ *   OMP_NUM_THREADS=8 ./bin/zika_mc [inputs/mc.inp]
+ *-----------------------------------------------------------------*/
+
+#include <cstdio>
+#include <sys/stat.h>
+#include "montecarlo.h"
+
+int main(int argc, char* argv[])
+{
+  const char * fileName = (argc > 1) ? argv[1] : "./inputs/mc.inp";
+  mc_problem problem(fileName);
+  if (!problem.Ok) {
+    printf("WARNING: some lines of %s were ignored\n", fileName);
+  }
+
+  printf("Monte Carlo of the SEIR-SEI model: %u samples, seed %llu\n",
+      problem.Samples, (unsigned long long) problem.Seed);
+  for (unsigned int i = 0; i < ZIKA_MC_INPUTS; i++){
+    const zika_random_input & input = problem.Inputs[i];
+    if (input.Type != ZIKA_DIST_FIXED) printf("  %s is random\n", zikaMcInputName(i));
+  }
+
+  mkdir("outputData", 0755);
+  const mc_summary summary = zikaRunMonteCarlo(problem);
+
+  printf("%u samples in %.3f s (%.1f samples/s), %u failed\n",
+      summary.Samples, summary.Seconds, summary.Samples / summary.Seconds, summary.Failed);
+  printf("mean cumulative cases at week %u: %.6e\n", problem.NWeeks - 1,
+      summary.MeanFinalCases);
+  if (problem.Tolerance > 0.) {
+    printf("largest relative error %.3e, %s\n", summary.RelativeError,
+        summary.Converged ? "converged" : "not converged");
+  }
+  printf("ensemble written to %s\n", problem.Output.c_str());
+
+  if (problem.MaxEntMoments > 0) {
+    const int failed = zikaMcMaxEnt(problem);
+    if (failed >= 0) {
+      printf("maximum entropy densities written to %s.txt and %s.zbin", problem.MaxEntOutput.c_str(),
+          problem.MaxEntOutput.c_str());
+      if (failed > 0) printf(", %d did not converge", failed);
+      printf("\n");
+    }
+  }
+  return 0;
+}
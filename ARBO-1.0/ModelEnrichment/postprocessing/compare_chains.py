@@ -0,0 +1,78 @@
+# Compares the marginals of two chain files of the in-process samplers,
+# e.g. plain Metropolis-Hastings against delayed acceptance run with the
+# same seed and length (see bench/compare_delayed.sh). For every delta it
+# prints both means and the difference in standard errors (batch means,
+# so the autocorrelation of the chains is accounted for), both standard
+# deviations, and the two-sample Kolmogorov-Smirnov distance against its
+# 1% critical value for the effective sample sizes. Exits with 1 when a
+# delta differs by either measure.
+#
+# usage: python3 compare_chains.py chain_a chain_b [n_chains] [burn_in]
+#   chain_a, chain_b  .zbin files, or the base name of the .dat made by
+#                     queso_m_to_dat; the last column (log-target or
+#                     log-likelihood) is left out
+#   n_chains          chains merged one after the other in each file (1)
+#   burn_in           fraction of every chain dropped at its start (0.2)
+import sys
+import numpy as np
+import zikabin
+
+def load(name, n_chains, burn_in):
+    if name.endswith('.zbin'):
+        rows = np.asarray(zikabin.load_chains(name))
+    else:
+        rows = zikabin.load_either(name)
+    rows = rows[:, :-1]
+    length = rows.shape[0] // n_chains
+    start = int(burn_in * length)
+    return np.concatenate([rows[c * length + start:(c + 1) * length] for c in range(n_chains)])
+
+# variance of the mean and effective sample size from sqrt(n) batch means
+def batch_means(x):
+    n = len(x)
+    size = max(int(np.sqrt(n)), 1)
+    n_batches = n // size
+    means = x[:n_batches * size].reshape(n_batches, size).mean(axis=1)
+    var_mean = means.var(ddof=1) / n_batches if n_batches > 1 else np.inf
+    var = x.var(ddof=1)
+    ess = var / var_mean if var_mean > 0 else float(n)
+    return var_mean, min(ess, float(n))
+
+def ks_distance(a, b):
+    a = np.sort(a)
+    b = np.sort(b)
+    points = np.concatenate([a, b])
+    cdf_a = np.searchsorted(a, points, side='right') / len(a)
+    cdf_b = np.searchsorted(b, points, side='right') / len(b)
+    return np.abs(cdf_a - cdf_b).max()
+
+def main(argv):
+    if len(argv) < 3:
+        print('usage: compare_chains.py chain_a chain_b [n_chains] [burn_in]')
+        return 2
+    n_chains = int(argv[3]) if len(argv) > 3 else 1
+    burn_in = float(argv[4]) if len(argv) > 4 else 0.2
+    a = load(argv[1], n_chains, burn_in)
+    b = load(argv[2], n_chains, burn_in)
+    if a.shape[1] != b.shape[1]:
+        print('the chains have %d and %d deltas' % (a.shape[1], b.shape[1]))
+        return 2
+
+    print('# delta    mean_a     mean_b      z   std_a     std_b    ess_a  ess_b   ks_d  ks_1%')
+    n_differ = 0
+    for i in range(a.shape[1]):
+        var_a, ess_a = batch_means(a[:, i])
+        var_b, ess_b = batch_means(b[:, i])
+        z = (a[:, i].mean() - b[:, i].mean()) / np.sqrt(var_a + var_b)
+        d = ks_distance(a[:, i], b[:, i])
+        critical = 1.628 * np.sqrt((ess_a + ess_b) / (ess_a * ess_b))
+        differ = abs(z) > 2.576 or d > critical
+        n_differ += differ
+        print('%7d %10.3e %10.3e %6.2f %9.3e %9.3e %6.0f %6.0f %6.3f %6.3f%s' %
+              (i, a[:, i].mean(), b[:, i].mean(), z, a[:, i].std(), b[:, i].std(),
+               ess_a, ess_b, d, critical, '  *' if differ else ''))
+    print('%d of %d deltas differ at the 1%% level' % (n_differ, a.shape[1]))
+    return 1 if n_differ else 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -1,6 +1,7 @@
 import matplotlib
 import numpy as np
 from numpy import loadtxt
+import zikabin
 
 burnin = 100;
 n_s = 7
@@ -9,8 +10,8 @@ n_weeks = 52
 dim = n_s + 1
 
 # dataFile = "../inputs/datafile.txt"
-dataFile = "sfp_qoi_seq.dat"
-q = loadtxt(dataFile,comments="%")
+dataFile = "sfp_qoi_seq"
+q = zikabin.load_either(dataFile)
 q = q[burnin:]
 # q = q.flatten()
 
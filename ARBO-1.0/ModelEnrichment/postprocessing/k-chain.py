@@ -4,6 +4,7 @@ import matplotlib.pyplot as plt
 import numpy as np
 from numpy import loadtxt
 from scipy.stats import gaussian_kde
+import zikabin
 
 rc('text',usetex=True)
 font={'family' : 'normal',
@@ -23,9 +24,9 @@ elif inad_type == 2:
 elif inad_type == 3:
     pf = 2*n_s
 
-dataFile = "sip_filtered_chain.dat"
-# dataFile = "sip_raw_chain.dat"
-c = loadtxt(dataFile,comments="%")
+dataFile = "sip_filtered_chain"
+# dataFile = "sip_raw_chain"
+c = zikabin.load_either(dataFile)
 print(c.shape)
 # c = -np.exp(c)
 points = range(0,pf*n_s)
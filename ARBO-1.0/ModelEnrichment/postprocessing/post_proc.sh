@@ -1,16 +1,21 @@
 #!/bin/bash
-rm *.dat *.m
-cp ../outputData/sip_filtered_chain.m .
-cp ../outputData/sip_raw_chain.m .
-cp ../outputData/sip_filtered_chain_loglikelihood.m .
-cp ../outputData/sip_raw_chain_logtarget.m .
+rm -f *.dat *.m *.zbin
+# binary outputs (zika_binaryOutput) are read in place by zikabin.py
+cp ../outputData/*.zbin . 2>/dev/null
+cp ../outputData/sip_filtered_chain.m . 2>/dev/null
+cp ../outputData/sip_raw_chain.m . 2>/dev/null
+cp ../outputData/sip_filtered_chain_loglikelihood.m . 2>/dev/null
+cp ../outputData/sip_raw_chain_logtarget.m . 2>/dev/null
 #cp ../src/output50k/sip_filtered_chain.m .
 #cp ../src/output200k/sip_filtered_chain.m .
 #cp ../src/output500k/sip_filtered_chain.m .
 #cp ../src/output1m/sip_filtered_chain.m .
 #cp /workspace/repos/software/hydrogen/ip-catchall/src/outputData/sip_raw_chain.m .
 
-cp ../outputData/sfp_qoi_seq.m .
+cp ../outputData/sfp_qoi_seq.m . 2>/dev/null
+# percentiles computed during the run (zika_qoiStats); compute-percents.py
+# writes the same file from the qois
+cp ../outputData/qoi-stats . 2>/dev/null
 #cp ../src/output50k/sfp_qoi_seq.m .
 #cp ../src/output200k/sfp_qoi_seq.m .
 #cp ../src/output500k/sfp_qoi_seq.m .
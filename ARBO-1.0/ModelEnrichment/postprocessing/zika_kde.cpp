@@ -0,0 +1,74 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * Kernel density estimates (src/kde.cpp) of every column of a .zbin
+ * file, in place of UncertaintyQuantification/randvar_ksd.m: the qois
+ * of the SFP (outputData/sfp_qoi_seq.zbin) or the cases of a Monte
+ * Carlo run (outputData/mc_seir_sei.zbin, from its first case column).
+ * The file is mapped, not read, and the columns are spread over the
+ * OpenMP threads. Writes <prefix>.zbin, the densities (Points rows, the
+ * columns of the input), and <prefix>-support.zbin, the points they are
+ * at, as randvar_ksd's data_ksd and data_supp.
+ *
+ *   make kde
+ *   OMP_NUM_THREADS=8 ./bin/zika_kde <file.zbin> <prefix> [points [first column]]
+ *-----------------------------------------------------------------*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "binfile.h"
+#include "kde.h"
+
+int main(int argc, char* argv[])
+{
+  if (argc < 3) {
+    printf("usage: %s <file.zbin> <prefix> [points [first column]]\n", argv[0]);
+    return 1;
+  }
+  zika_bin_reader reader(argv[1]);
+  if (!reader.ok()) {
+    printf("WARNING: could not read %s\n", argv[1]);
+    return 1;
+  }
+  kde_settings settings;
+  if (argc > 3) settings.Points = std::strtoul(argv[3], NULL, 10);
+  const unsigned int first = (argc > 4) ? std::strtoul(argv[4], NULL, 10) : 0;
+  if (settings.Points < 2 || first >= reader.cols()) {
+    printf("WARNING: nothing to do for %u points from column %u of %u\n",
+        settings.Points, first, reader.cols());
+    return 1;
+  }
+  const unsigned int n_vars = reader.cols() - first;
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<double> density, support, bandwidth;
+  zikaKernelDensities(reader.column(first), reader.rows(), n_vars, 1,
+      reader.header().Capacity, settings, density, support, bandwidth);
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::vector<std::string> names(n_vars);
+  for (unsigned int v = 0; v < n_vars; v++) names[v] = reader.name(first + v);
+  const zika_bin_header & header = reader.header();
+  const std::string prefix = argv[2];
+  const std::string fileNames[2] = { prefix + ".zbin", prefix + "-support.zbin" };
+  const std::vector<double> * values[2] = { &density, &support };
+  for (unsigned int f = 0; f < 2; f++){
+    zika_bin_writer writer(fileNames[f].c_str(), names, settings.Points, header.NWeeks,
+        header.Dim, header.RepFactor);
+    if (!writer.ok() || !writer.append(&(*values[f])[0], settings.Points)) {
+      printf("WARNING: could not write %s\n", fileNames[f].c_str());
+      return 1;
+    }
+  }
+
+  printf("%u densities of %llu samples at %u points in %.3f s, written to %s and %s\n",
+      n_vars, (unsigned long long) reader.rows(), settings.Points, seconds,
+      fileNames[0].c_str(), fileNames[1].c_str());
+  return 0;
+}
@@ -0,0 +1,44 @@
+# Reader of the binary .zbin chain and qoi files written by the zika run
+# (see include/binfile.h for the layout). The data is memory mapped, not
+# read: load() returns a (rows, cols) view of the file.
+import os
+import numpy as np
+
+_header = np.dtype([('magic', 'S8'), ('version', '<u4'), ('ncols', '<u4'),
+                    ('capacity', '<u8'), ('nrows', '<u8'), ('nweeks', '<u4'),
+                    ('dim', '<u4'), ('rep_factor', '<f8'), ('data_offset', '<u8')])
+_name_length = 32
+
+def header(fileName):
+    h = np.fromfile(fileName, dtype=_header, count=1)[0]
+    if h['magic'] != b'ZIKABIN' or h['version'] != 1:
+        raise ValueError(fileName + ' is not a zika binary file')
+    names = np.fromfile(fileName, dtype='S%d' % _name_length, count=h['ncols'],
+                        offset=_header.itemsize)
+    return {'ncols': int(h['ncols']), 'nrows': int(h['nrows']),
+            'capacity': int(h['capacity']), 'n_weeks': int(h['nweeks']),
+            'dim': int(h['dim']), 'rep_factor': float(h['rep_factor']),
+            'data_offset': int(h['data_offset']),
+            'names': [n.decode() for n in names]}
+
+def load(fileName):
+    h = header(fileName)
+    columns = np.memmap(fileName, dtype='<f8', mode='r', offset=h['data_offset'],
+                        shape=(h['ncols'], h['capacity']))
+    return columns[:, :h['nrows']].T
+
+# the chain files of the in-process samplers are appended segment by
+# segment, each row ending with the index of its chain: their rows are
+# returned one chain after the other, as in the .m files, without that
+# column; other files as load() does
+def load_chains(fileName):
+    rows = load(fileName)
+    if header(fileName)['names'][-1] != 'chain':
+        return rows
+    return np.asarray(rows)[np.argsort(rows[:, -1], kind='stable'), :-1]
+
+# the .zbin file if the run wrote one, else the .dat made by queso_m_to_dat
+def load_either(baseName):
+    if os.path.exists(baseName + '.zbin'):
+        return load_chains(baseName + '.zbin')
+    return np.loadtxt(baseName + '.dat', comments='%')
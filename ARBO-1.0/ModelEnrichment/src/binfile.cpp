@@ -0,0 +1,173 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the writer and the memory-mapped reader of the
+ * binary chain and qoi files.
+ *-----------------------------------------------------------------*/
+
+#include "binfile.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char zikaBinMagic[8] = { 'Z', 'I', 'K', 'A', 'B', 'I', 'N', 0 };
+static const uint64_t zikaBinPage = 4096;
+
+//Constructor
+zika_bin_writer::zika_bin_writer(
+    const char*                     fileName,
+    const std::vector<std::string>& names,
+    uint64_t                        capacity,
+    unsigned int                    n_weeks,
+    unsigned int                    dim,
+    double                          rep_factor)
+: m_fd(-1)
+{
+  std::memset(&m_header, 0, sizeof(m_header));
+  std::memcpy(m_header.Magic, zikaBinMagic, sizeof(zikaBinMagic));
+  m_header.Version = 1;
+  m_header.NCols = names.size();
+  m_header.Capacity = capacity;
+  m_header.NRows = 0;
+  m_header.NWeeks = n_weeks;
+  m_header.Dim = dim;
+  m_header.RepFactor = rep_factor;
+  const uint64_t headerSize = sizeof(m_header) + names.size() * __ZIKA_BIN_NAME;
+  m_header.DataOffset = (headerSize + zikaBinPage - 1) / zikaBinPage * zikaBinPage;
+
+  m_fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (m_fd < 0) {
+    printf("WARNING: could not open %s\n", fileName);
+    return;
+  }
+  //the columns are allocated up front (sparse until written), so that each
+  //one is contiguous however the rows arrive
+  std::vector<char> head(m_header.DataOffset, 0);
+  std::memcpy(&head[0], &m_header, sizeof(m_header));
+  for (unsigned int c = 0; c < names.size(); c++){
+    std::strncpy(&head[sizeof(m_header) + c * __ZIKA_BIN_NAME], names[c].c_str(),
+        __ZIKA_BIN_NAME - 1);
+  }
+  if (ftruncate(m_fd, m_header.DataOffset + names.size() * capacity * sizeof(double)) != 0 ||
+      pwrite(m_fd, &head[0], head.size(), 0) != (ssize_t) head.size()) {
+    printf("WARNING: could not write %s\n", fileName);
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+//Destructor
+zika_bin_writer::~zika_bin_writer()
+{
+  if (m_fd >= 0) close(m_fd);
+}
+
+bool zika_bin_writer::append(const double* rows, uint64_t n_rows)
+{
+  if (m_fd < 0) return false;
+  if (n_rows > m_header.Capacity - m_header.NRows) {
+    n_rows = m_header.Capacity - m_header.NRows;
+  }
+  if (n_rows == 0) return true;
+  const unsigned int n_cols = m_header.NCols;
+  m_column.resize(n_rows);
+  for (unsigned int c = 0; c < n_cols; c++){
+    for (uint64_t r = 0; r < n_rows; r++){
+      m_column[r] = rows[r * n_cols + c];
+    }
+    const off_t offset = m_header.DataOffset
+      + (c * m_header.Capacity + m_header.NRows) * sizeof(double);
+    const ssize_t bytes = n_rows * sizeof(double);
+    if (pwrite(m_fd, &m_column[0], bytes, offset) != bytes) return false;
+  }
+  //the rows count last, a reader never sees rows that are not there yet
+  m_header.NRows += n_rows;
+  return pwrite(m_fd, &m_header, sizeof(m_header), 0) == (ssize_t) sizeof(m_header);
+}
+
+//Constructor
+zika_bin_reader::zika_bin_reader(const char* fileName)
+: m_data(NULL),
+  m_size(0),
+  m_header(NULL)
+{
+  const int fd = open(fileName, O_RDONLY);
+  if (fd < 0) {
+    printf("WARNING: could not open %s\n", fileName);
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && (size_t) st.st_size >= sizeof(zika_bin_header)) {
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data != MAP_FAILED) {
+      const zika_bin_header * header = (const zika_bin_header *) data;
+      const uint64_t needed = header->DataOffset
+        + (uint64_t) header->NCols * header->Capacity * sizeof(double);
+      if (std::memcmp(header->Magic, zikaBinMagic, sizeof(zikaBinMagic)) == 0 &&
+          header->Version == 1 && needed <= (uint64_t) st.st_size) {
+        m_data = data;
+        m_size = st.st_size;
+        m_header = header;
+      }
+      else {
+        munmap(data, st.st_size);
+      }
+    }
+  }
+  close(fd);
+  if (m_data == NULL) {
+    printf("WARNING: %s is not a zika binary file\n", fileName);
+  }
+}
+
+//Destructor
+zika_bin_reader::~zika_bin_reader()
+{
+  if (m_data) munmap(m_data, m_size);
+}
+
+std::string zika_bin_reader::name(unsigned int col) const
+{
+  if (col >= m_header->NCols) return std::string();
+  const char * name = (const char *) m_data + sizeof(zika_bin_header) + col * __ZIKA_BIN_NAME;
+  return std::string(name, strnlen(name, __ZIKA_BIN_NAME));
+}
+
+const double* zika_bin_reader::column(unsigned int col) const
+{
+  if (col >= m_header->NCols) return NULL;
+  return (const double *) ((const char *) m_data + m_header->DataOffset)
+    + col * m_header->Capacity;
+}
+
+std::vector<std::string> zikaParamNames(unsigned int n_params, const char* extra)
+{
+  std::vector<std::string> names;
+  char name[__ZIKA_BIN_NAME];
+  for (unsigned int p = 0; p < n_params; p++){
+    snprintf(name, sizeof(name), "delta_%u", p);
+    names.push_back(name);
+  }
+  if (extra && extra[0]) names.push_back(extra);
+  return names;
+}
+
+std::vector<std::string> zikaQoiNames(unsigned int n_weeks, unsigned int dim)
+{
+  std::vector<std::string> names;
+  char name[__ZIKA_BIN_NAME];
+  for (unsigned int j = 0; j < n_weeks; j++){
+    for (unsigned int i = 0; i < dim; i++){
+      snprintf(name, sizeof(name), "Y%u_w%u", i, j);
+      names.push_back(name);
+    }
+  }
+  return names;
+}
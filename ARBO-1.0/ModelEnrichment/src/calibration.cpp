@@ -0,0 +1,445 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the multistart least-squares calibration of the
+ * SEIR-SEI model, the C++ counterpart of
+ * CalibrationProblem/main_SEIR_SEI_TRR_example*.m.
+ *-----------------------------------------------------------------*/
+
+#include "calibration.h"
+#include "cases.h"
+#include "rhs.h"
+#include "dual.h"
+#include "philox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_odeiv2.h>
+#include "eigen3/Eigen/Dense"
+
+static const char * zikaFitUnknownNames[ZIKA_FIT_UNKNOWNS] = {
+  "betaH", "alphaH", "gamma", "betaV", "alphaV", "delta",
+  "SH0", "EH0", "IH0", "SV0", "EV0", "IV0"
+};
+
+const char* zikaFitUnknownName(unsigned int i)
+{
+  return i < ZIKA_FIT_UNKNOWNS ? zikaFitUnknownNames[i] : "";
+}
+
+//state of the model: S_h, E_h, I_h, R_h, S_v, E_v, I_v, C
+#define __ZIKA_FIT_DIM 8
+
+//where the initial condition unknowns go in the state
+static const unsigned int zikaFitState[ZIKA_FIT_UNKNOWNS] = {
+  0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 5, 6
+};
+
+//Constructor
+fit_problem::fit_problem(const char* fileName)
+:
+  N(206.e6),
+  RH0(29639.),
+  Data("./inputs/data.txt"),
+  Starts(64),
+  Seed(30081984),
+  MaxIterations(200),
+  Tolerance(1.e-10),
+  Output("outputData/fit"),
+  Ok(true)
+{
+  //bounds and initial guess of main_SEIR_SEI_TRR_example2.m
+  const double lower[ZIKA_FIT_UNKNOWNS] = {
+    1. / 16.3, 1. / 12., 1. / 8.8, 1. / 11.6, 1. / 10., 1. / 21.,
+    0.9 * N, 0., 0., 0.99, 0., 0.
+  };
+  const double upper[ZIKA_FIT_UNKNOWNS] = {
+    1. / 8., 1. / 3., 1. / 3., 1. / 6.2, 1. / 5., 1. / 11.,
+    N, 1.e4, 1.e4, 0.999, 1., 1.
+  };
+  const double guess[ZIKA_FIT_UNKNOWNS] = {
+    1. / 11.3, 1. / 5.9, 1. / 7.9, 1. / 8.6, 1. / 9.1, 1. / 11.,
+    N - 2. * 8201. - RH0, 8201., 8201., 1. - 4.4e-4, 2.2e-4, 2.2e-4
+  };
+  for (unsigned int i = 0; i < ZIKA_FIT_UNKNOWNS; i++){
+    Lower[i] = lower[i];
+    Upper[i] = upper[i];
+    Guess[i] = guess[i];
+  }
+
+  std::ifstream file(fileName);
+  if (!file) {
+    std::cout << "WARNING: could not open " << fileName << ", using the defaults" << std::endl;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    //strip comments, then split on the first '='; the value is the whole
+    //rest of the line, bounds take several words
+    std::string::size_type pos = line.find('#');
+    if (pos != std::string::npos) line.erase(pos);
+    pos = line.find('=');
+    if (pos == std::string::npos) continue;
+    std::string key, value = line.substr(pos + 1);
+    std::istringstream(line.substr(0, pos)) >> key;
+    const std::string::size_type first = value.find_first_not_of(" \t");
+    const std::string::size_type last = value.find_last_not_of(" \t\r");
+    if (key.empty() || first == std::string::npos) continue;
+    value = value.substr(first, last - first + 1);
+
+    bool known = true;
+    if      (key == "fit_N")             { N = std::strtod(value.c_str(), NULL); }
+    else if (key == "fit_RH0")           { RH0 = std::strtod(value.c_str(), NULL); }
+    else if (key == "fit_data")          { Data = value; }
+    else if (key == "fit_dataRegion")    { DataRegion = value; }
+    else if (key == "fit_starts")        { Starts = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "fit_seed")          { Seed = std::strtoull(value.c_str(), NULL, 10); }
+    else if (key == "fit_maxIterations") { MaxIterations = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "fit_tolerance")     { Tolerance = std::strtod(value.c_str(), NULL); }
+    else if (key == "fit_output")        { Output = value; }
+    else {
+      known = false;
+      for (unsigned int i = 0; i < ZIKA_FIT_UNKNOWNS; i++){
+        if (key == std::string("fit_") + zikaFitUnknownNames[i]) {
+          std::istringstream words(value);
+          double lo, hi, x0;
+          if (words >> lo >> hi && lo <= hi) {
+            Lower[i] = lo;
+            Upper[i] = hi;
+            Guess[i] = (words >> x0) ? x0 : 0.5 * (lo + hi);
+            known = true;
+          }
+          break;
+        }
+      }
+    }
+    if (!known) {
+      std::cout << "WARNING: could not use '" << key << " = " << value << "'" << std::endl;
+      Ok = false;
+    }
+  }
+  if (Starts == 0) Starts = 1;
+  for (unsigned int i = 0; i < ZIKA_FIT_UNKNOWNS; i++){
+    Guess[i] = std::min(std::max(Guess[i], Lower[i]), Upper[i]);
+  }
+
+  //weekly new cases, in any layout of include/cases.h
+  zika_case_series series(Data.c_str());
+  const int region = series.region(DataRegion);
+  if (!series.ok() || region < 0) {
+    if (series.ok()) std::cout << "WARNING: " << Data << " has no region " << DataRegion << std::endl;
+    Ok = false;
+    return;
+  }
+  NewCases.assign(series.cases(region), series.cases(region) + series.weeks());
+  if (NewCases.size() < 2) {
+    std::cout << "WARNING: " << Data << " holds less than two weeks" << std::endl;
+    Ok = false;
+  }
+}
+
+//Destructor
+fit_problem::~fit_problem()
+{
+}
+
+double zikaFitR0(const double x[])
+{
+  return (x[ZIKA_FIT_BETAH] * x[ZIKA_FIT_BETAV] * x[ZIKA_FIT_ALPHAV]) /
+      (x[ZIKA_FIT_GAMMA] * (x[ZIKA_FIT_ALPHAV] + x[ZIKA_FIT_DELTA]) * x[ZIKA_FIT_DELTA]);
+}
+
+//what the right-hand sides below receive as 'params'
+struct fit_system
+{
+  const double * X;
+  double         N;
+};
+
+//the SEIR-SEI model at the rates of x (N_v = 1: the vectors are
+//proportions, as in the MATLAB code)
+static int zikaFitRhs(double t, const double Y[], double dYdt[], void* params)
+{
+  const fit_system & sys = *(const fit_system *) params;
+  const double * x = sys.X;
+  double pops[__ZIKA_FIT_DIM];
+  for (unsigned int i = 0; i < __ZIKA_FIT_DIM; i++) pops[i] = clampPositive(Y[i]);
+  zikaSeirSei(pops, dYdt, x[ZIKA_FIT_BETAH], x[ZIKA_FIT_ALPHAH], x[ZIKA_FIT_GAMMA],
+      x[ZIKA_FIT_BETAV], x[ZIKA_FIT_ALPHAV], x[ZIKA_FIT_DELTA], 1., sys.N);
+  return GSL_SUCCESS;
+}
+
+//state and sensitivities to every unknown, Z = [Y, S(0,0..11), ...,
+//S(7,0..11)]: the rates are duals seeded with the identity, so the
+//derivative part of the right-hand side is dS/dt = df/dY S + df/d(rates);
+//the initial conditions only enter through S(t0)
+static int zikaFitSensRhs(double t, const double Z[], double dZdt[], void* params)
+{
+  const unsigned int dim = __ZIKA_FIT_DIM, np = ZIKA_FIT_UNKNOWNS;
+  const fit_system & sys = *(const fit_system *) params;
+  dual<np> pops[dim], f[dim], rates[ZIKA_FIT_SH0];
+  for (unsigned int i = 0; i < dim; i++){
+    dual<np> y;
+    y.v = Z[i];
+    for (unsigned int p = 0; p < np; p++) y.d[p] = Z[dim + np * i + p];
+    pops[i] = clampPositive(y);
+  }
+  for (unsigned int r = 0; r < ZIKA_FIT_SH0; r++){
+    rates[r].v = sys.X[r];
+    rates[r].d[r] = 1.;
+  }
+  zikaSeirSei(pops, f, rates[ZIKA_FIT_BETAH], rates[ZIKA_FIT_ALPHAH], rates[ZIKA_FIT_GAMMA],
+      rates[ZIKA_FIT_BETAV], rates[ZIKA_FIT_ALPHAV], rates[ZIKA_FIT_DELTA], 1., sys.N);
+  for (unsigned int i = 0; i < dim; i++){
+    dZdt[i] = f[i].v;
+    for (unsigned int p = 0; p < np; p++) dZdt[dim + np * i + p] = f[i].d[p];
+  }
+  return GSL_SUCCESS;
+}
+
+bool zikaFitResiduals(const fit_problem& problem, const double x[],
+    std::vector<double>& residuals, std::vector<double>* jacobian)
+{
+  const unsigned int dim = __ZIKA_FIT_DIM, np = ZIKA_FIT_UNKNOWNS;
+  const unsigned int n_weeks = problem.NewCases.size();
+  const unsigned int n_res = n_weeks + 1;
+  const unsigned int dimZ = jacobian ? dim * (1 + np) : dim;
+  residuals.assign(n_res, 0.);
+  if (jacobian) jacobian->assign(n_res * np, 0.);
+
+  fit_system params = { x, problem.N };
+  gsl_odeiv2_system sys = { jacobian ? zikaFitSensRhs : zikaFitRhs, NULL, dimZ, &params };
+  //the tolerances of ode45 in ObjFunIC_SEIR_SEI.m
+  gsl_odeiv2_driver * d = gsl_odeiv2_driver_alloc_y_new(&sys, gsl_odeiv2_step_rkf45,
+      1.e-3, 1.e-9, 1.e-6);
+  gsl_odeiv2_driver_set_nmax(d, 1000000);
+
+  std::vector<double> Z(dimZ, 0.);
+  Z[0] = x[ZIKA_FIT_SH0];
+  Z[1] = x[ZIKA_FIT_EH0];
+  Z[2] = x[ZIKA_FIT_IH0];
+  Z[3] = problem.RH0;
+  Z[4] = x[ZIKA_FIT_SV0];
+  Z[5] = x[ZIKA_FIT_EV0];
+  Z[6] = x[ZIKA_FIT_IV0];
+  Z[7] = problem.NewCases[0];
+  if (jacobian) {
+    for (unsigned int p = ZIKA_FIT_SH0; p < np; p++) Z[dim + np * zikaFitState[p] + p] = 1.;
+  }
+
+  //new cases of week j: C(7 (j + 1)) - C(7 j), from t0 = 7 as the MATLAB
+  //code and zikaComputeModel
+  double t = 7.;
+  double lastC = Z[7];
+  std::vector<double> lastS(np, 0.);
+  bool ok = true;
+  for (unsigned int j = 1; j < n_weeks && ok; j++){
+    const int status = gsl_odeiv2_driver_apply(d, &t, 7. * (j + 1), &Z[0]);
+    if (status != GSL_SUCCESS || !std::isfinite(Z[7])) {
+      ok = false;
+      break;
+    }
+    residuals[j - 1] = (Z[7] - lastC) - problem.NewCases[j];
+    lastC = Z[7];
+    if (jacobian) {
+      const double * S = &Z[dim + np * 7];
+      for (unsigned int p = 0; p < np; p++){
+        (*jacobian)[(j - 1) * np + p] = S[p] - lastS[p];
+        lastS[p] = S[p];
+      }
+    }
+  }
+  gsl_odeiv2_driver_free(d);
+  if (!ok) return false;
+
+  //conservation of the initial totals, the last rows of ObjFunIC_SEIR_SEI
+  const unsigned int rh = n_weeks - 1, rv = n_weeks;
+  residuals[rh] = x[ZIKA_FIT_SH0] + x[ZIKA_FIT_EH0] + x[ZIKA_FIT_IH0] - (problem.N - problem.RH0);
+  residuals[rv] = problem.N * (x[ZIKA_FIT_SV0] + x[ZIKA_FIT_EV0] + x[ZIKA_FIT_IV0] - 1.);
+  if (jacobian) {
+    for (unsigned int p = ZIKA_FIT_SH0; p <= ZIKA_FIT_IH0; p++) (*jacobian)[rh * np + p] = 1.;
+    for (unsigned int p = ZIKA_FIT_SV0; p <= ZIKA_FIT_IV0; p++) (*jacobian)[rv * np + p] = problem.N;
+  }
+  return true;
+}
+
+static double zikaFitCost(const std::vector<double>& residuals)
+{
+  double cost = 0.;
+  for (unsigned int k = 0; k < residuals.size(); k++) cost += residuals[k] * residuals[k];
+  return 0.5 * cost;
+}
+
+fit_result zikaFitLocal(const fit_problem& problem, const double x0[])
+{
+  const unsigned int np = ZIKA_FIT_UNKNOWNS;
+  fit_result result;
+  std::copy(x0, x0 + np, result.X);
+  result.Cost = std::numeric_limits<double>::infinity();
+  result.R0 = zikaFitR0(x0);
+  result.Iterations = 0;
+  result.Solves = 0;
+  result.Converged = false;
+
+  //the free unknowns, scaled to [0, 1]
+  std::vector<unsigned int> free;
+  for (unsigned int i = 0; i < np; i++){
+    if (problem.Upper[i] > problem.Lower[i]) free.push_back(i);
+  }
+  const unsigned int n = free.size();
+  std::vector<double> u(n), width(n);
+  for (unsigned int k = 0; k < n; k++){
+    const unsigned int i = free[k];
+    width[k] = problem.Upper[i] - problem.Lower[i];
+    u[k] = (x0[i] - problem.Lower[i]) / width[k];
+  }
+
+  std::vector<double> residuals, trialResiduals, jacobian;
+  result.Solves++;
+  if (!zikaFitResiduals(problem, result.X, residuals, &jacobian)) return result;
+  result.Cost = zikaFitCost(residuals);
+  if (n == 0) {
+    result.Converged = true;
+    return result;
+  }
+
+  const unsigned int n_res = residuals.size();
+  Eigen::MatrixXd A(n, n);
+  Eigen::VectorXd g(n);
+  double mu = 1.e-3, nu = 2.;   //damping, relative to the diagonal of A
+  bool newJacobian = true;
+  double trial[ZIKA_FIT_UNKNOWNS];
+  while (result.Iterations < problem.MaxIterations) {
+    result.Iterations++;
+    if (newJacobian) {
+      //normal equations of the scaled unknowns
+      for (unsigned int a = 0; a < n; a++){
+        double ga = 0.;
+        for (unsigned int r = 0; r < n_res; r++) ga += jacobian[r * np + free[a]] * residuals[r];
+        g(a) = ga * width[a];
+        for (unsigned int b = 0; b <= a; b++){
+          double s = 0.;
+          for (unsigned int r = 0; r < n_res; r++){
+            s += jacobian[r * np + free[a]] * jacobian[r * np + free[b]];
+          }
+          A(a, b) = A(b, a) = s * width[a] * width[b];
+        }
+      }
+      newJacobian = false;
+    }
+
+    //unknowns held on their bound: those the gradient pushes out of the box
+    std::vector<unsigned int> moving;
+    for (unsigned int k = 0; k < n; k++){
+      if ((u[k] <= 0. && g(k) > 0.) || (u[k] >= 1. && g(k) < 0.)) continue;
+      moving.push_back(k);
+    }
+    if (moving.empty()) {
+      result.Converged = true;   //a corner of the box is a minimum
+      break;
+    }
+    const unsigned int m = moving.size();
+    Eigen::MatrixXd M(m, m);
+    Eigen::VectorXd b(m);
+    for (unsigned int a = 0; a < m; a++){
+      b(a) = -g(moving[a]);
+      for (unsigned int c = 0; c < m; c++) M(a, c) = A(moving[a], moving[c]);
+      M(a, a) += mu * std::max(A(moving[a], moving[a]), 1.e-12 * A.diagonal().maxCoeff());
+    }
+    const Eigen::VectorXd step = M.ldlt().solve(b);
+
+    //projected step, and the reduction of the cost the linear model expects
+    Eigen::VectorXd s = Eigen::VectorXd::Zero(n);
+    std::vector<double> uTrial(u);
+    for (unsigned int a = 0; a < m; a++){
+      const unsigned int k = moving[a];
+      uTrial[k] = std::min(std::max(u[k] + step(a), 0.), 1.);
+      s(k) = uTrial[k] - u[k];
+    }
+    const double predicted = -(g.dot(s) + 0.5 * s.dot(A * s));
+    if (s.lpNorm<Eigen::Infinity>() < 1.e-14) {
+      result.Converged = true;   //no step left to take
+      break;
+    }
+
+    //a long step the box cut may not even go down the model: shorter then
+    bool solved = false;
+    double cost = HUGE_VAL, rho = 0.;
+    if (predicted > 0.) {
+      std::copy(result.X, result.X + np, trial);
+      for (unsigned int k = 0; k < n; k++){
+        trial[free[k]] = problem.Lower[free[k]] + uTrial[k] * width[k];
+      }
+      result.Solves++;
+      solved = zikaFitResiduals(problem, trial, trialResiduals, NULL);
+      if (solved) cost = zikaFitCost(trialResiduals);
+      rho = (result.Cost - cost) / predicted;
+    }
+    if (solved && rho > 1.e-4) {
+      const double decrease = (result.Cost - cost) / result.Cost;
+      u = uTrial;
+      std::copy(trial, trial + np, result.X);
+      result.Solves++;
+      if (!zikaFitResiduals(problem, result.X, residuals, &jacobian)) break;
+      result.Cost = zikaFitCost(residuals);
+      newJacobian = true;
+      mu *= std::max(1. / 3., 1. - std::pow(2. * rho - 1., 3));
+      nu = 2.;
+      if (decrease < problem.Tolerance) {
+        result.Converged = true;
+        break;
+      }
+    }
+    else {
+      mu *= nu;
+      nu *= 2.;
+      if (mu > 1.e20) {
+        result.Converged = true;   //no decrease however short the step
+        break;
+      }
+    }
+  }
+  result.R0 = zikaFitR0(result.X);
+  return result;
+}
+
+std::vector<fit_result> zikaFitMultistart(const fit_problem& problem)
+{
+  const unsigned int np = ZIKA_FIT_UNKNOWNS;
+  const unsigned int n_starts = problem.Starts;
+
+  //Latin hypercube: unknown i of start s falls in stratum perm_i(s) of the
+  //n_starts - 1 strata of its range; start 0 is the guess
+  std::vector<double> starts(n_starts * np);
+  std::copy(problem.Guess, problem.Guess + np, starts.begin());
+  const unsigned int n_strata = n_starts - 1;
+  std::vector<unsigned int> perm(n_strata);
+  for (unsigned int i = 0; i < np; i++){
+    for (unsigned int k = 0; k < n_strata; k++) perm[k] = k;
+    zika_philox shuffle(problem.Seed, i, 0);
+    for (unsigned int k = n_strata; k > 1; k--){
+      std::swap(perm[k - 1], perm[(unsigned int) (shuffle.uniform() * k)]);
+    }
+    for (unsigned int s = 1; s < n_starts; s++){
+      zika_philox rng(problem.Seed, s, 1 + i);
+      const double u = (perm[s - 1] + rng.uniform()) / n_strata;
+      starts[s * np + i] = problem.Lower[i] + u * (problem.Upper[i] - problem.Lower[i]);
+    }
+  }
+
+  std::vector<fit_result> results(n_starts);
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (int s = 0; s < (int) n_starts; s++){
+    results[s] = zikaFitLocal(problem, &starts[s * np]);
+  }
+  return results;
+}
@@ -0,0 +1,277 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the reading of the weekly case data: the text
+ * layouts of inputs/ and Datasets/ parsed and checked once, then kept
+ * as a memory-mapped .zbin file.
+ *-----------------------------------------------------------------*/
+
+#include "cases.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//splits line on commas, semicolons and tabs if it has any, on blanks
+//otherwise; the blanks and quotes around every field are dropped
+static void zikaCaseFields(const std::string& line, std::vector<std::string>& fields)
+{
+  fields.clear();
+  const bool separated = line.find_first_of(",;\t") != std::string::npos;
+  const char * separators = separated ? ",;\t" : " \r\n";
+  std::string::size_type begin = 0;
+  while (begin <= line.size()) {
+    std::string::size_type end = line.find_first_of(separators, begin);
+    if (end == std::string::npos) end = line.size();
+    std::string field = line.substr(begin, end - begin);
+    const std::string::size_type first = field.find_first_not_of(" \r\n\"'");
+    const std::string::size_type last = field.find_last_not_of(" \r\n\"'");
+    field = (first == std::string::npos) ? std::string() : field.substr(first, last - first + 1);
+    //blanks repeat between fields, an empty field between commas is a
+    //missing value
+    if (separated || !field.empty()) fields.push_back(field);
+    begin = end + 1;
+  }
+  //a trailing separator does not open another field
+  if (separated && !fields.empty() && fields.back().empty()) fields.pop_back();
+  if (fields.size() == 1 && fields[0].empty()) fields.clear();
+}
+
+//true if the whole of field is a number
+static bool zikaCaseNumber(const std::string& field, double& value)
+{
+  if (field.empty()) return false;
+  char * end = NULL;
+  value = std::strtod(field.c_str(), &end);
+  return *end == '\0';
+}
+
+//week of a label: YYYYWW labels are split in year and week, plain week
+//numbers have year 0
+static void zikaCaseWeek(double label, double& year, double& week)
+{
+  year = (label >= 100000.) ? std::floor(label / 100.) : 0.;
+  week = label - 100. * year;
+}
+
+//weeks from label a to label b, 0 if b does not come after a. A week
+//number lower than the one before starts a new year
+static double zikaCaseStep(double a, double b)
+{
+  double ya, wa, yb, wb;
+  zikaCaseWeek(a, ya, wa);
+  zikaCaseWeek(b, yb, wb);
+  if (ya == yb && wb > wa) return wb - wa;
+  if (yb > ya || (yb == 0. && ya == 0. && wb < wa)) {
+    //epidemiological years have 52 weeks, or 53
+    return std::max(wa, 52.) - wa + wb + 52. * std::max(yb - ya - 1., 0.);
+  }
+  return 0.;
+}
+
+//Constructor
+zika_case_series::zika_case_series(const char* fileName)
+: m_reader(NULL),
+  m_weeks(0)
+{
+  const std::string cacheName = std::string(fileName) + ".zbin";
+  if (map(cacheName.c_str(), fileName)) return;
+  if (!parse(fileName)) {
+    m_columns.clear();
+    m_names.clear();
+    m_weeks = 0;
+    return;
+  }
+  cache(cacheName.c_str());
+}
+
+//Destructor
+zika_case_series::~zika_case_series()
+{
+  delete m_reader;
+}
+
+int zika_case_series::region(const std::string& key) const
+{
+  if (key.empty()) return regions() ? 0 : -1;
+  for (unsigned int r = 0; r < regions(); r++){
+    if (m_names[r] == key) return r;
+  }
+  if (key.find_first_not_of("0123456789") != std::string::npos) return -1;
+  const unsigned long r = std::strtoul(key.c_str(), NULL, 10);
+  return (r < regions()) ? (int) r : -1;
+}
+
+const double* zika_case_series::column(unsigned int col) const
+{
+  if (m_reader) return m_reader->column(col);
+  return &m_columns[col * m_weeks];
+}
+
+bool zika_case_series::map(const char* cacheName, const char* fileName)
+{
+  //a cache written in the same second as the file may predate its last
+  //change: it is parsed again
+  struct stat source, cached;
+  if (stat(cacheName, &cached) != 0 || stat(fileName, &source) != 0 ||
+      cached.st_mtime <= source.st_mtime) return false;
+  zika_bin_reader * reader = new zika_bin_reader(cacheName);
+  if (!reader->ok() || reader->rows() == 0 || reader->rows() != reader->header().NWeeks ||
+      reader->cols() != reader->header().Dim + 1 || reader->name(0) != "week") {
+    printf("WARNING: %s is not a case series, reading %s again\n", cacheName, fileName);
+    delete reader;
+    return false;
+  }
+  m_reader = reader;
+  m_weeks = reader->rows();
+  for (unsigned int c = 1; c < reader->cols(); c++) m_names.push_back(reader->name(c));
+  return true;
+}
+
+bool zika_case_series::parse(const char* fileName)
+{
+  const std::string path(fileName);
+  if (path.size() > 5 && path.compare(path.size() - 5, 5, ".xlsx") == 0) {
+    printf("WARNING: %s is a spreadsheet, save it as CSV\n", fileName);
+    return false;
+  }
+  std::ifstream file(fileName);
+  if (!file) {
+    printf("WARNING: could not open %s\n", fileName);
+    return false;
+  }
+  std::vector<std::vector<std::string> > rows;
+  std::vector<unsigned int> lines;
+  std::vector<std::string> fields;
+  std::string line;
+  for (unsigned int n = 1; std::getline(file, line); n++){
+    const std::string::size_type pos = line.find('#');
+    if (pos != std::string::npos) line.erase(pos);
+    zikaCaseFields(line, fields);
+    if (fields.empty()) continue;
+    rows.push_back(fields);
+    lines.push_back(n);
+  }
+  if (rows.empty()) {
+    printf("WARNING: %s holds no weeks\n", fileName);
+    return false;
+  }
+
+  //rows longer than there are rows: a row of weeks and a row per region,
+  //each maybe led by its name. Otherwise a line per week, maybe after a
+  //line of names
+  double value;
+  bool wide = rows.size() >= 2 && rows[0].size() > rows.size();
+  for (unsigned int f = 1; wide && f < rows[0].size(); f++){
+    wide = zikaCaseNumber(rows[0][f], value);
+  }
+  std::vector<double> labels;
+  std::vector<std::vector<double> > cases;
+  std::vector<std::string> names;
+  unsigned int first = 0;
+  if (!wide) {
+    for (unsigned int f = 0; f < rows[0].size(); f++){
+      if (!zikaCaseNumber(rows[0][f], value)) first = 1;
+    }
+    if (first && rows[0].size() > 1) names.assign(rows[0].begin() + 1, rows[0].end());
+    if (rows.size() <= first || rows[first].size() < 2) {
+      printf("WARNING: %s holds no 'week cases' lines\n", fileName);
+      return false;
+    }
+  }
+  const unsigned int n_regions = wide ? rows.size() - 1 : rows[first].size() - 1;
+  const unsigned int n_weeks = wide ? rows[0].size() - !zikaCaseNumber(rows[0][0], value)
+                                    : rows.size() - first;
+  cases.assign(n_regions, std::vector<double>(n_weeks));
+  labels.resize(n_weeks);
+  for (unsigned int r = first; r < rows.size(); r++){
+    const bool named = wide && !zikaCaseNumber(rows[r][0], value);
+    if (wide && r > 0) names.push_back(named ? rows[r][0] : std::string());
+    const unsigned int width = wide ? n_weeks + named : n_regions + 1;
+    if (rows[r].size() != width) {
+      printf("WARNING: %s:%u has %u fields instead of %u\n", fileName, lines[r],
+          (unsigned int) rows[r].size(), width);
+      return false;
+    }
+    for (unsigned int f = named; f < width; f++){
+      if (!zikaCaseNumber(rows[r][f], value) || !std::isfinite(value)) {
+        printf("WARNING: %s:%u: '%s' is not a number\n", fileName, lines[r], rows[r][f].c_str());
+        return false;
+      }
+      //the week of this value, and its region (-1 for the week itself)
+      const unsigned int j = wide ? f - named : r - first;
+      const int k = wide ? (int) r - 1 : (int) f - 1;
+      if (k < 0) labels[j] = value;
+      else if (value < 0.) {
+        printf("WARNING: %s:%u: %g cases\n", fileName, lines[r], value);
+        return false;
+      }
+      else cases[k][j] = value;
+    }
+  }
+
+  //one name per region, 'cases' for a single unnamed one
+  names.resize(n_regions);
+  for (unsigned int k = 0; k < n_regions; k++){
+    if (!names[k].empty()) continue;
+    std::ostringstream name;
+    if (n_regions == 1) name << "cases";
+    else name << "cases_" << k;
+    names[k] = name.str();
+  }
+
+  //consecutive week numbers, the first as in the file
+  m_weeks = n_weeks;
+  m_names = names;
+  m_columns.resize((n_regions + 1) * n_weeks);
+  double year;
+  zikaCaseWeek(labels[0], year, m_columns[0]);
+  for (unsigned int j = 1; j < n_weeks; j++){
+    const double step = zikaCaseStep(labels[j - 1], labels[j]);
+    if (step < 1.) {
+      printf("WARNING: %s: week %g does not follow week %g\n", fileName, labels[j], labels[j - 1]);
+      return false;
+    }
+    if (step > 1.) {
+      printf("WARNING: %s: %g weeks missing between weeks %g and %g\n", fileName,
+          step - 1., labels[j - 1], labels[j]);
+    }
+    m_columns[j] = m_columns[j - 1] + step;
+  }
+  for (unsigned int k = 0; k < n_regions; k++){
+    std::copy(cases[k].begin(), cases[k].end(), &m_columns[(k + 1) * n_weeks]);
+  }
+  return true;
+}
+
+void zika_case_series::cache(const char* cacheName) const
+{
+  std::vector<std::string> names(1, "week");
+  names.insert(names.end(), m_names.begin(), m_names.end());
+  const unsigned int n_cols = names.size();
+  std::vector<double> rows(m_weeks * n_cols);
+  for (unsigned int j = 0; j < m_weeks; j++){
+    for (unsigned int c = 0; c < n_cols; c++) rows[j * n_cols + c] = m_columns[c * m_weeks + j];
+  }
+  //written aside and renamed, so that the processes of a run reading the
+  //file at once never map half a cache
+  std::ostringstream partName;
+  partName << cacheName << "." << getpid();
+  bool written;
+  {
+    zika_bin_writer writer(partName.str().c_str(), names, m_weeks, m_weeks, n_cols - 1, 1.);
+    written = writer.ok() && writer.append(&rows[0], m_weeks);
+  }
+  if (!written || std::rename(partName.str().c_str(), cacheName) != 0) {
+    printf("WARNING: could not write %s, the cases stay in memory\n", cacheName);
+    unlink(partName.str().c_str());
+  }
+}
@@ -13,7 +13,18 @@
 #include "compute.h"
 #include "likelihood.h"
 #include "qoi.h"
+#include "model.h"
+#include "options.h"
+#include "mcmc.h"
+#include "smc.h"
+#include "mlmc.h"
+#include "sweep.h"
 #include "dynamics_info.h"
+#include "binfile.h"
+#include "cases.h"
+#include "quantiles.h"
+#include "convergence.h"
+#include "philox.h"
 //queso
 #include <queso/GslVector.h>
 #include <queso/GslMatrix.h>
@@ -25,10 +36,443 @@
 #include <queso/UniformVectorRV.h>
 #include <queso/StatisticalInverseProblem.h>
 #include <queso/StatisticalForwardProblem.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <vector>
 
+//------------------------------------------------------
+// steps of the ODE solves made by all processes since the last call,
+// printed by process 0 (see zika_scaledTolerance and zika_positivityWidth),
+// with the number of solves given up (zika_maxRhsCalls and others)
+//------------------------------------------------------
+static void printSolverStats(
+  const QUESO::FullEnvironment& env,
+  const char* stage)
+{
+  const zika_solver_stats stats = zikaSolverStats();
+  zikaResetSolverStats();
+  double counts[4] = { (double) stats.Solves, (double) stats.Steps,
+                        (double) stats.Rejected, (double) stats.Failed };
+  double countsAll[4] = { 0., 0., 0., 0. };
+  MPI_Reduce(counts, countsAll, 4, MPI_DOUBLE, MPI_SUM, 0, env.fullComm().Comm());
+  if (env.fullRank() == 0 && countsAll[0] > 0.) {
+    std::cout << stage << ": " << countsAll[0] << " ODE solves, "
+              << countsAll[1] / countsAll[0] << " steps and "
+              << countsAll[2] / countsAll[0] << " rejected steps per solve, "
+              << countsAll[3] << " given up"
+              << std::endl << std::endl;
+  }
+}
+
+//------------------------------------------------------
+// SFP with the ensemble integrator: every process integrates its share of
+// the posterior samples (n_local rows of 'samples') in blocks with
+// qoiRoutineBatch, and process 0 gathers the qois and writes them in the
+// layout of QUESO's sfp_qoi_seq.m (so postprocessing/ is unchanged), or,
+// with binary, appends every gathered block to a .zbin file (binfile.h)
+// as soon as it is solved. With a convergence tolerance, the blocks stop
+// as soon as the running estimates in 'convergence' are accurate enough
+//------------------------------------------------------
+static void solveSfpBatch(
+  const QUESO::FullEnvironment& env,
+  const std::vector<double>& samples,
+  unsigned int n_params,
+  const qoiRoutine_Data& qoiData,
+  unsigned int n_samples,
+  unsigned int n_qoi,
+  const char* fileName,
+  bool binary,
+  double rep_factor,
+  mc_convergence& convergence)
+{
+  const unsigned int blockSize = 1024;
+  const int n_procs = env.fullComm().NumProc();
+  const unsigned int n_local = (n_samples + n_procs - 1) / n_procs;
+  const dynamics_info & dyn = *qoiData.m_dynMain;
+  const unsigned int dim = dyn.N_s + 1;
+
+  FILE * convFile = NULL;
+  if (convergence.Tolerance > 0. && env.fullRank() == 0) {
+    convFile = fopen("outputData/sfp_mc_conv.txt", "w");
+  }
+
+  zika_bin_writer * writer = NULL;
+  std::vector<double> allBlock;
+  if (binary && env.fullRank() == 0) {
+    writer = new zika_bin_writer(fileName, zikaQoiNames(dyn.N_times, dyn.N_s + 1),
+        n_samples, dyn.N_times, dyn.N_s + 1, rep_factor);
+    allBlock.resize(n_procs * blockSize * n_qoi);
+  }
+
+  std::vector<double> params(blockSize * n_params, 0.);
+  std::vector<double> block;
+  std::vector<double> localQoi(binary ? 0 : n_local * n_qoi, 0.);
+  std::vector<double> states(n_procs * __ZIKA_CONV_FIELDS);
+  unsigned int n_done = 0;
+  unsigned int n_written = 0;
+  for (unsigned int first = 0; first < n_local; first += blockSize){
+    const unsigned int n_block = std::min(blockSize, n_local - first);
+    std::copy(samples.begin() + first * n_params,
+              samples.begin() + (first + n_block) * n_params, params.begin());
+    qoiRoutineBatch(params, n_block, &qoiData, block);
+    n_done = first + n_block;
+    if (binary) {
+      //every process has the same n_local, so the same blocks
+      MPI_Gather(&block[0], n_block * n_qoi, MPI_DOUBLE,
+                 env.fullRank() == 0 ? &allBlock[0] : NULL, n_block * n_qoi, MPI_DOUBLE,
+                 0, env.fullComm().Comm());
+      if (writer && writer->ok()) {
+        //n_procs * n_local exceeds n_samples by up to n_procs - 1 rows:
+        //the file holds n_samples rows, as the .m file does
+        const unsigned int n_rows = std::min(n_procs * n_block, n_samples - n_written);
+        if (!writer->append(&allBlock[0], n_rows)) {
+          printf("WARNING: could not write %s\n", fileName);
+          delete writer;
+          writer = NULL;
+        }
+        n_written += n_rows;
+      }
+    }
+    else {
+      std::copy(block.begin(), block.begin() + n_block * n_qoi, localQoi.begin() + first * n_qoi);
+    }
+
+    if (convergence.Tolerance > 0.) {
+      //the block's estimates of every process, merged in rank order by all
+      //of them, so that they agree on when to stop
+      mc_convergence local(convergence.Tolerance, convergence.MinSamples);
+      double quantities[ZIKA_CONV_QUANTITIES];
+      for (unsigned int s = 0; s < n_block; s++){
+        if (qoiData.m_batchStatus[s] != 0) continue;
+        zikaConvQuantities(&block[s * n_qoi + dim - 1], dim, dyn.N_times, quantities);
+        local.add(quantities);
+      }
+      MPI_Allgather(const_cast<double*>(local.data()), __ZIKA_CONV_FIELDS, MPI_DOUBLE,
+                    &states[0], __ZIKA_CONV_FIELDS, MPI_DOUBLE, env.fullComm().Comm());
+      for (int p = 0; p < n_procs; p++) convergence.merge(&states[p * __ZIKA_CONV_FIELDS]);
+      if (convFile) convergence.write(convFile, first == 0);
+      if (convergence.converged()) break;
+    }
+  }
+  if (convFile) fclose(convFile);
+  if (env.fullRank() == 0 && convergence.Tolerance > 0.) {
+    std::cout << "SFP: " << convergence.samples() << " samples solved, largest relative error "
+              << convergence.worstError() << (convergence.converged() ? "" : " (not converged)")
+              << std::endl << std::endl;
+  }
+  if (binary) {
+    delete writer;
+    return;
+  }
+
+  std::vector<double> allQoi;
+  if (env.fullRank() == 0) allQoi.resize(n_procs * n_done * n_qoi);
+  MPI_Gather(&localQoi[0], n_done * n_qoi, MPI_DOUBLE,
+             env.fullRank() == 0 ? &allQoi[0] : NULL, n_done * n_qoi, MPI_DOUBLE,
+             0, env.fullComm().Comm());
+
+  if (env.fullRank() == 0) {
+    //fewer than n_samples when the run converged early
+    const unsigned int n_written = std::min(n_samples, n_procs * n_done);
+    FILE *qoiFile = fopen(fileName,"w");
+    if (!qoiFile) {
+      printf("WARNING: could not open %s\n", fileName);
+      return;
+    }
+    fprintf(qoiFile,"sfp_qoi_seq_unified = zeros(%u,%u);\n", n_written, n_qoi);
+    fprintf(qoiFile,"sfp_qoi_seq_unified = [");
+    for (unsigned int s = 0; s < n_written; s++){
+      for (unsigned int j = 0; j < n_qoi; j++){
+        fprintf(qoiFile,"%.16e ", allQoi[s * n_qoi + j]);
+      }
+      fprintf(qoiFile,"\n");
+    }
+    fprintf(qoiFile,"];\n");
+    fclose(qoiFile);
+  }
+}
+
+//------------------------------------------------------
+// Merges the qoi sketches of all processes into process 0's and writes
+// the percentiles from there; the centroids are sent, not the qois
+//------------------------------------------------------
+static void writeQoiStats(
+  const QUESO::FullEnvironment& env,
+  zika_qoi_stats& stats,
+  double sigma,
+  const char* fileName)
+{
+  const int n_procs = env.fullComm().NumProc();
+  const unsigned int n_qoi = stats.size();
+  std::vector<double> buffer;
+  std::vector<int> counts;
+  stats.pack(buffer, counts);
+  int length = buffer.size();
+
+  std::vector<int> allCounts, lengths, offsets;
+  if (env.fullRank() == 0) {
+    allCounts.resize(n_procs * n_qoi);
+    lengths.resize(n_procs);
+    offsets.resize(n_procs, 0);
+  }
+  MPI_Gather(&counts[0], n_qoi, MPI_INT,
+             env.fullRank() == 0 ? &allCounts[0] : NULL, n_qoi, MPI_INT,
+             0, env.fullComm().Comm());
+  MPI_Gather(&length, 1, MPI_INT,
+             env.fullRank() == 0 ? &lengths[0] : NULL, 1, MPI_INT,
+             0, env.fullComm().Comm());
+  std::vector<double> allBuffers;
+  if (env.fullRank() == 0) {
+    for (int p = 1; p < n_procs; p++) offsets[p] = offsets[p - 1] + lengths[p - 1];
+    allBuffers.resize(offsets[n_procs - 1] + lengths[n_procs - 1] + 1);
+  }
+  buffer.push_back(0.);   //never empty, for &buffer[0]
+  MPI_Gatherv(&buffer[0], length, MPI_DOUBLE,
+              env.fullRank() == 0 ? &allBuffers[0] : NULL,
+              env.fullRank() == 0 ? &lengths[0] : NULL,
+              env.fullRank() == 0 ? &offsets[0] : NULL, MPI_DOUBLE,
+              0, env.fullComm().Comm());
+
+  if (env.fullRank() == 0) {
+    for (int p = 1; p < n_procs; p++){
+      stats.unpack(&allBuffers[offsets[p]], &allCounts[p * n_qoi]);
+    }
+    stats.write(fileName, sigma);
+    std::cout << "QoI percentiles written to " << fileName << " ("
+              << (n_qoi ? stats[0].weight() : 0.) << " samples)" << std::endl;
+  }
+}
+
+//------------------------------------------------------
+// Initial values of the season: S_h, E_h, I_h, R_h, S_v, E_v, I_v, C.
+// The infected humans and the cases start from ci, the cases of the
+// first week of data with the under-reporting factor
+//------------------------------------------------------
+static void setInitialValues(
+  double ci,
+  std::vector<double>& initialValues)
+{
+  double nh = 206 * pow(10,6);
+  double nv = 1;
+  double ehi = ci;
+  double ihi = ci;
+  double rhi = 29639.0;
+  double shi = nh - ehi - ihi - rhi;
+  double ivi = 0.00022;
+  double evi = ivi;
+  double svi = nv - evi - ivi;
+  //set initial values
+  initialValues[0] = shi;
+  initialValues[1] = ehi;
+  initialValues[2] = ihi;
+  initialValues[3] = rhi;
+  initialValues[4] = svi;
+  initialValues[5] = evi;
+  initialValues[6] = ivi;
+  initialValues[7] = ci;
+}
+
+//------------------------------------------------------
+// SIP with the in-process sampler of options.Sampler (smc, threads,
+// population, mala or delayed): this process' share of the posterior
+// samples goes to filteredChain, rows of n_params deltas. smcState is the
+// prefix of the particle files of the smc sampler, '' for none
+//------------------------------------------------------
+static void solveSipInProcess(
+  const QUESO::FullEnvironment& env,
+  const zika_options& options,
+  const likelihoodRoutine_Data& data,
+  const std::vector<double>& minValues,
+  const std::vector<double>& maxValues,
+  double rep_factor,
+  const std::string& smcState,
+  std::vector<double>& filteredChain)
+{
+  const unsigned int n_params = minValues.size();
+  if (options.Sampler == ZIKA_SAMPLER_SMC) {
+    std::cout << "Solving the SIP with " << options.SmcParticles
+              << " SMC particles per process over " << data.m_nObserved << " weeks of data"
+              << std::endl << std::endl;
+    smc_settings settings;
+    settings.Particles = options.SmcParticles;
+    settings.EssFraction = options.SmcEssFraction;
+    settings.Moves = options.SmcMoves;
+    settings.Seed = options.Seed;
+    settings.State = smcState;
+    settings.Forecast = options.SmcForecast;
+    settings.RepFactor = rep_factor;
+    zikaSolveSmc(env, data, minValues, maxValues, settings, filteredChain);
+    return;
+  }
+  std::cout << "Solving the SIP with " << options.NChains
+            << (options.Sampler == ZIKA_SAMPLER_POPULATION ?
+                " tempered DE-MC chains per process" :
+                options.Sampler == ZIKA_SAMPLER_MALA ?
+                " threaded MALA chains per process" :
+                options.Sampler == ZIKA_SAMPLER_DELAYED ?
+                " threaded delayed-acceptance chains per process" :
+                " threaded Metropolis Hastings chains per process")
+            << std::endl << std::endl;
+  mcmc_settings settings;
+  settings.NChains = options.NChains;
+  settings.ChainLength = options.ChainLength;
+  settings.ProposalStd = options.ProposalStd;
+  settings.FilterLag = options.FilterLag;
+  settings.Seed = options.Seed;
+  settings.MaxTemp = options.MaxTemp;
+  settings.ExchangeInterval = options.ExchangeInterval;
+  settings.Langevin = (options.Sampler == ZIKA_SAMPLER_MALA);
+  settings.EarlyStop = options.EarlyStop;
+  settings.DelayedAcceptance = (options.Sampler == ZIKA_SAMPLER_DELAYED);
+  settings.SurrogateInterval = options.SurrogateInterval;
+  settings.BinaryOutput = options.BinaryOutput;
+  settings.DiagnosticsPeriod = options.DiagnosticsPeriod;
+  settings.TargetEss = options.TargetEss;
+  settings.TargetRhat = options.TargetRhat;
+  settings.RepFactor = rep_factor;
+  std::vector<double> initials(n_params, 0.);
+  if (options.Sampler != ZIKA_SAMPLER_POPULATION) {
+    zikaSolveThreadedMH(env, data, minValues, maxValues,
+        initials, settings, filteredChain);
+  }
+  else {
+    zikaSolvePopulation(env, data, minValues, maxValues,
+        initials, settings, filteredChain);
+  }
+}
+
+//------------------------------------------------------
+// Sweep over the under-reporting factor and the variance of the data
+// (zika_sweepRepFactors, zika_sweepVars) in place of the SIP and SFP.
+// The posterior samples of the run's own rep_factor and var are kept in
+// zika_sweepStore with their log-likelihood and cumulative cases; they
+// come from the in-process sampler the first time only. Every alternative
+// reweights them by its likelihood over theirs (the prior is the same):
+// the data scale with rep_factor, and so do the initial conditions, so a
+// different rep_factor solves every sample once more, a different var
+// only does sums. An alternative whose ESS falls below
+// zika_sweepEssFraction of the samples is sampled again instead.
+//------------------------------------------------------
+static void solveSweep(
+  const QUESO::FullEnvironment& env,
+  const zika_options& options,
+  const likelihoodRoutine_Data& data,
+  const std::vector<double>& minValues,
+  const std::vector<double>& maxValues,
+  double rep_factor)
+{
+  const unsigned int n_params = minValues.size();
+  const unsigned int n_weeks = data.m_dynMain->N_times;
+  const unsigned int dim = data.m_dynMain->N_s + 1;
+
+  //a list of one value goes with every value of the other
+  std::vector<double> reps = options.SweepRepFactors, vars = options.SweepVars;
+  if (reps.empty()) reps.assign(1, rep_factor);
+  if (vars.empty()) vars.assign(1, data.m_var);
+  unsigned int n_alt = std::max(reps.size(), vars.size());
+  if (reps.size() != vars.size() && reps.size() != 1 && vars.size() != 1) {
+    n_alt = std::min(reps.size(), vars.size());
+    if (env.fullRank() == 0) {
+      printf("WARNING: zika_sweepRepFactors and zika_sweepVars differ in length, "
+             "sweeping the first %u of each\n", n_alt);
+    }
+  }
+
+  //QUESO's chain is not at hand: the sweep samples on threads then
+  zika_options sampling(options);
+  if (sampling.Sampler == ZIKA_SAMPLER_QUESO) {
+    if (env.fullRank() == 0) {
+      printf("WARNING: the sweep samples with zika_sampler = threads\n");
+    }
+    sampling.Sampler = ZIKA_SAMPLER_THREADS;
+  }
+
+  mkdir("outputData", 0755);
+  sweep_samples stored;
+  if (zikaSweepRead(options.SweepStore.c_str(), n_params, n_weeks, stored)) {
+    if (env.fullRank() == 0) {
+      std::cout << "Sweep: " << stored.N << " samples of rep_factor " << stored.RepFactor
+                << " read from " << options.SweepStore << std::endl << std::endl;
+    }
+  }
+  else {
+    std::vector<double> filteredChain;
+    solveSipInProcess(env, sampling, data, minValues, maxValues,
+        rep_factor, options.SmcState, filteredChain);
+    zikaSweepGather(env, filteredChain, n_params, stored);
+    zikaSweepSolve(env, data, n_params, rep_factor, stored);
+    zikaSweepWrite(env, options.SweepStore.c_str(), stored, n_params, n_weeks, dim);
+  }
+
+  FILE * summary = NULL;
+  if (env.fullRank() == 0) {
+    summary = fopen("outputData/sip_sweep.txt", "w");
+    if (!summary) printf("WARNING: could not open outputData/sip_sweep.txt\n");
+    else {
+      fprintf(summary, "# rep_factor var ess samples sampled_again");
+      for (unsigned int p = 0; p < n_params; p++) fprintf(summary, " mean_%u sd_%u", p, p);
+      fprintf(summary, "\n");
+    }
+  }
+  for (unsigned int k = 0; k < n_alt; k++){
+    double rep = reps[std::min(k, (unsigned int) reps.size() - 1)];
+    double var = vars[std::min(k, (unsigned int) vars.size() - 1)];
+    std::vector<double> ics(dim, 0.), csc(n_weeks);
+    for (unsigned int j = 0; j < n_weeks; j++) csc[j] = data.m_csc[j] * (rep / rep_factor);
+    setInitialValues(csc[0], ics);
+    likelihoodRoutine_Data alternative(env, data.m_times, ics, csc, var, data.m_dynMain);
+    alternative.m_failureLogLikelihood = data.m_failureLogLikelihood;
+    alternative.setObservedWeeks(data.m_nObserved);
+
+    //log-likelihood of the samples under the alternative
+    sweep_samples solved;
+    const sweep_samples * samples = &stored;
+    std::vector<double> logWeights;
+    if (rep == stored.RepFactor) {
+      zikaSweepLogLikelihood(alternative, stored, logWeights);
+    }
+    else {
+      solved.N = stored.N;
+      solved.Deltas = stored.Deltas;
+      zikaSweepSolve(env, alternative, n_params, rep, solved);
+      logWeights = solved.LogLikelihood;
+      samples = &solved;
+    }
+    for (unsigned int s = 0; s < stored.N; s++) logWeights[s] -= stored.LogLikelihood[s];
+    std::vector<double> weights;
+    double ess = zikaSweepWeights(logWeights, *samples, weights);
+
+    const bool resampled = (ess < options.SweepEssFraction * stored.N);
+    if (resampled) {
+      if (env.fullRank() == 0) {
+        std::cout << "Sweep: ESS " << ess << " of " << stored.N << " for rep_factor "
+                  << rep << ", var " << var << ", sampling again" << std::endl;
+      }
+      std::vector<double> filteredChain;
+      solveSipInProcess(env, sampling, alternative, minValues, maxValues,
+          rep, "", filteredChain);
+      solved = sweep_samples();
+      zikaSweepGather(env, filteredChain, n_params, solved);
+      zikaSweepSolve(env, alternative, n_params, rep, solved);
+      samples = &solved;
+      ess = zikaSweepWeights(std::vector<double>(solved.N, 0.), solved, weights);
+    }
+    char casesName[64];
+    snprintf(casesName, sizeof(casesName), "outputData/sip_sweep_%u.txt", k);
+    zikaSweepReport(summary, casesName, alternative, rep, ess, resampled, *samples,
+        weights, n_params);
+    if (env.fullRank() == 0) {
+      std::cout << "Sweep: rep_factor " << rep << ", var " << var << ", ESS " << ess
+                << " of " << samples->N << (resampled ? ", sampled again" : ", reweighted")
+                << ", written to " << casesName << std::endl;
+    }
+  }
+  if (summary) fclose(summary);
+}
+
 void computeParams(const QUESO::FullEnvironment& env) {
   struct timeval timevalNow;
   
@@ -64,10 +508,12 @@ void computeParams(const QUESO::FullEnvironment& env) {
   }
 
   //------------------------------------------------------
-  // SIP Step 0 of 6: Read in the data
+  // SIP Step 0 of 6: Read in the options and the data
   //------------------------------------------------------
+  zika_options options("./inputs/zika.inp", env.optionsInputFileName().c_str());
+
   unsigned int n_s;  //number of species in model
-  double var = 25000000;            //variance in the data
+  double var = options.Var;         //variance in the data, zika_var
   //type of inadequacy model: right now only one type, might include more later
   unsigned int inad_type = 1;
 
@@ -91,29 +537,34 @@ void computeParams(const QUESO::FullEnvironment& env) {
   if( inad_type == 3 ) { params_factor = 2 * n_s;}
   unsigned int n_delta = params_factor*n_s;         //the model discrepancy terms
   unsigned int n_params = n_delta;                  //no other parameters to calibrate
-  unsigned int n_weeks = 52;
-
-  //read in data points
-  double tmpPhis; //number of initial conditions (right now only one)
-  double tmpWeeks;
-  double tmpx;
-  int numLines = 0;
 
-  FILE *dataFile;
-  dataFile = fopen("./inputs/data.txt","r");
+  //read in data points, from the binary cache after the first run
+  zika_case_series series(options.Data.c_str());
+  const int region = series.region(options.DataRegion);
+  if (!series.ok() || region < 0) {
+    if (series.ok()) {
+      printf("WARNING: %s has no region %s\n", options.Data.c_str(), options.DataRegion.c_str());
+    }
+    printf("WARNING: no data, nothing to solve\n");
+    return;
+  }
+  //a season of 52 weeks unless the data or zika_nWeeks say otherwise
+  unsigned int n_weeks = options.NWeeks ? options.NWeeks : std::max(series.weeks(), 52u);
+  int numLines = std::min(series.weeks(), n_weeks);
 
   std::vector<double> weeks(n_weeks, 0.);
   std::vector<double> new_cases(n_weeks, 0.);
   std::vector<double> initialValues(dim, 0.);
-  // MUST SET BY HAND HERE, should change to input
-  double rep_factor = 1.;    // no under-reporting
-  //double rep_factor = 10./9; // 10% under-reporting
-  //double rep_factor = 2.0;     // 50% under-reporting
-  while (fscanf(dataFile,"%lf %lf ", &tmpWeeks, &tmpx) != EOF) {
-    weeks[numLines]    = tmpWeeks;
-    //add 10% for under-reporting
-    new_cases[numLines]     = rep_factor * tmpx;
-    numLines++;
+  // zika_repFactor: 1 for no under-reporting, 10./9 for 10%, 2 for 50%
+  double rep_factor = options.RepFactor;
+  for (int i = 0; i < numLines; i++){
+    weeks[i]     = series.week()[i];
+    new_cases[i] = rep_factor * series.cases(region)[i];
+  }
+  //a season still under way (the smc sampler assimilates the weeks there
+  //are): the weeks to come are still forecast
+  for (unsigned int i = std::max(numLines, 1); i < n_weeks; i++){
+    weeks[i] = weeks[i-1] + 1;
   }
   //count cumulative sum of new cases
   std::vector<double> cum_sum_cases(n_weeks, 0.);
@@ -127,30 +578,10 @@ void computeParams(const QUESO::FullEnvironment& env) {
     times[i] = weeks[i] * 7;
   }
 
-  //Set initial values
-  //S_h, E_h, I_h, R_h, S_v E_v, I_v, C
-  double nh = 206 * pow(10,6);
-  double nv = 1;
-  double ci = rep_factor * 8201.0;
-  double ehi = ci;
-  double ihi = ci;
-  double rhi = 29639.0;
-  double shi = nh - ehi - ihi - rhi;
-  double ivi = 0.00022;
-  double evi = ivi;
-  double svi = nv - evi - ivi;
-  //set initial values
-  initialValues[0] = shi;
-  initialValues[1] = ehi;
-  initialValues[2] = ihi;
-  initialValues[3] = rhi;
-  initialValues[4] = svi;
-  initialValues[5] = evi;
-  initialValues[6] = ivi;
-  initialValues[7] = ci;
+  setInitialValues(new_cases[0], initialValues);
 
-  fclose(dataFile);
-  std::cout << "The number of data points is " << n_weeks << "\n\n";
+  std::cout << "The number of data points is " << numLines << ", the model runs over "
+            << n_weeks << " weeks\n\n";
 
   //create dummy vector to be filled with params inside likelihood
   std::vector<double> queso_params(n_params, 0.0); 
@@ -186,12 +617,26 @@ void computeParams(const QUESO::FullEnvironment& env) {
 
   // collect information about dynamical system
   dynamics_info dynMain(n_s, n_weeks, inad_type, params_factor, queso_params);
+  // pick the right-hand side kernel for this inadequacy type once, here
+  zikaSelectKernel(&dynMain);
+  dynMain.Solver = options.Solver;
+  dynMain.WarmStart = options.WarmStart;
+  dynMain.WarmStartRadius = options.WarmStartRadius;
+  dynMain.DenseOutput = options.DenseOutput;
+  dynMain.ScaledTolerance = options.ScaledTolerance;
+  dynMain.PositivityWidth = options.PositivityWidth;
+  dynMain.MaxRhsCalls = options.MaxRhsCalls;
+  dynMain.MinStep = options.MinStep;
+  dynMain.MaxSeconds = options.MaxSeconds;
 
   //------------------------------------------------------
   // SIP Step 3 of 6: Instantiate the likelihood function 
   // object to be used by QUESO.
   //------------------------------------------------------
   likelihoodRoutine_Data likelihoodRoutine_Data1(env, times, initialValues, cum_sum_cases, var, &dynMain);
+  likelihoodRoutine_Data1.m_failureLogLikelihood = options.FailureLogLikelihood;
+  //the weeks after the data are forecast by the SFP, not fitted
+  likelihoodRoutine_Data1.setObservedWeeks(numLines);
 
   QUESO::GenericScalarFunction<>
     likelihoodFunctionObj(
@@ -235,29 +680,61 @@ void computeParams(const QUESO::FullEnvironment& env) {
   //------------------------------------------------------
   // SIP Step 6 of 6: Solve the inverse problem, that is,
   // set the 'pdf' and the 'realizer' of the posterior RV //------------------------------------------------------
-  std::cout << "Solving the SIP with Multi-Level Metropolis Hastings" 
-	    << std::endl << std::endl;  
-
-  //The following is set if use ip.solveWithBayesMetropolisHastings
-  QUESO::GslVector paramInitials(paramSpace.zeroVector());
-  for (unsigned int i = 0; i < n_params; i++) {paramInitials[i] = 0;}
-   //
-//priorRv.realizer().realization(paramInitials);
-
-  /* QUESO::GslVector diagVec(paramSpace.zeroVector()); */
-  QUESO::GslMatrix proposalCovMatrix(diagVec);
-  for (unsigned int i = 0; i < n_params; i++) proposalCovMatrix(i,i) = 1.e-4;
-  //proposalCovMatrix(0,0) = 1e-6;
-  //proposalCovMatrix(1,1) = 1e-6;
-  //proposalCovMatrix(2,2) = 1e-6;
-  //proposalCovMatrix(3,3) = 1e-6;
+  // a sweep over rep_factor and var replaces the SIP and the SFP
+  if (!options.SweepRepFactors.empty() || !options.SweepVars.empty()) {
+    std::vector<double> minValues(n_params), maxValues(n_params);
+    for (unsigned int i = 0; i < n_params; i++){
+      minValues[i] = paramMinValues[i];
+      maxValues[i] = paramMaxValues[i];
+    }
+    solveSweep(env, options, likelihoodRoutine_Data1, minValues, maxValues, rep_factor);
+    printSolverStats(env, "Sweep");
+    return;
+  }
 
-  ip.solveWithBayesMetropolisHastings(NULL, paramInitials, &proposalCovMatrix);
+  if (options.Sampler == ZIKA_SAMPLER_QUESO) {
+    std::cout << "Solving the SIP with Multi-Level Metropolis Hastings" 
+  	    << std::endl << std::endl;  
+
+    //The following is set if use ip.solveWithBayesMetropolisHastings
+    QUESO::GslVector paramInitials(paramSpace.zeroVector());
+    for (unsigned int i = 0; i < n_params; i++) {paramInitials[i] = 0;}
+     //
+  //priorRv.realizer().realization(paramInitials);
+
+    /* QUESO::GslVector diagVec(paramSpace.zeroVector()); */
+    QUESO::GslMatrix proposalCovMatrix(diagVec);
+    for (unsigned int i = 0; i < n_params; i++) proposalCovMatrix(i,i) = 1.e-4;
+    //proposalCovMatrix(0,0) = 1e-6;
+    //proposalCovMatrix(1,1) = 1e-6;
+    //proposalCovMatrix(2,2) = 1e-6;
+    //proposalCovMatrix(3,3) = 1e-6;
+
+    // start the chain from the MAP estimate, found by QUESO's optimizer with
+    // the gradients of likelihoodRoutine
+    if (options.MapSeed) ip.seedWithMAPEstimator();
+    ip.solveWithBayesMetropolisHastings(NULL, paramInitials, &proposalCovMatrix);
+
+    /* ip.seedWithMAPEstimator(); */
+    /* ip.solveWithBayesMetropolisHastings(); */
+
+    /* ip.solveWithBayesMLSampling(); */
+  }
 
-  /* ip.seedWithMAPEstimator(); */
-  /* ip.solveWithBayesMetropolisHastings(); */
+  // in-process chains on threads: postTotal gets no realizer, the SFP draws
+  // from the filtered chain instead
+  std::vector<double> filteredChain;
+  if (options.Sampler != ZIKA_SAMPLER_QUESO) {
+    std::vector<double> minValues(n_params), maxValues(n_params);
+    for (unsigned int i = 0; i < n_params; i++){
+      minValues[i] = paramMinValues[i];
+      maxValues[i] = paramMaxValues[i];
+    }
+    solveSipInProcess(env, options, likelihoodRoutine_Data1, minValues, maxValues,
+        rep_factor, options.SmcState, filteredChain);
+  }
 
-  /* ip.solveWithBayesMLSampling(); */
+  printSolverStats(env, "SIP");
 
   //================================================================
   // Statistical forward problem (SFP)
@@ -286,6 +763,8 @@ void computeParams(const QUESO::FullEnvironment& env) {
   // to be used by QUESO.
   //------------------------------------------------------
   qoiRoutine_Data qoiRoutine_Data(env, times, initialValues, &dynMain);
+  zika_qoi_stats qoiStats(options.QoiStats ? n_weeks * dim : 0);
+  if (options.QoiStats) qoiRoutine_Data.m_stats = &qoiStats;
   
   QUESO::GenericVectorFunction<QUESO::GslVector,QUESO::GslMatrix,QUESO::GslVector,QUESO::GslMatrix>
     qoiFunctionObj("qoi_",
@@ -316,9 +795,73 @@ void computeParams(const QUESO::FullEnvironment& env) {
   //------------------------------------------------------
   // SFP Step 6 of 6: Solve the forward problem
   //------------------------------------------------------
-  std::cout << "Solving the SFP with Monte Carlo" 
-            << std::endl << std::endl;  
-  fp.solveWithMonteCarlo(NULL);
+  if (options.SfpMlmc || options.SfpBatch || options.Sampler != ZIKA_SAMPLER_QUESO) {
+    if (!options.SfpMlmc) {
+      std::cout << "Solving the SFP with the batched ensemble integrator" 
+                << std::endl << std::endl;  
+    }
+    const int n_procs = env.fullComm().NumProc();
+    const unsigned int n_local = (options.SfpSamples + n_procs - 1) / n_procs;
+    std::vector<double> samples(n_local * n_params, 0.);
+    if (options.Sampler != ZIKA_SAMPLER_QUESO) {
+      //resample the filtered chains of all processes, so that a process
+      //whose own chain came out empty still has samples
+      sweep_samples gathered;
+      zikaSweepGather(env, filteredChain, n_params, gathered);
+      if (gathered.N == 0) {
+        if (env.fullRank() == 0) {
+          printf("WARNING: the filtered chains are empty, the SFP is skipped\n");
+        }
+        return;
+      }
+      zika_philox rng(options.Seed, env.fullRank(), __ZIKA_SFP_RESAMPLE_STREAM);
+      for (unsigned int k = 0; k < n_local; k++){
+        const unsigned int r = (unsigned int) (rng.uniform() * gathered.N);
+        std::copy(&gathered.Deltas[r * n_params], &gathered.Deltas[r * n_params] + n_params,
+                  &samples[k * n_params]);
+      }
+    }
+    else {
+      QUESO::GslVector sample(paramSpace.zeroVector());
+      for (unsigned int k = 0; k < n_local; k++){
+        postTotal.realizer().realization(sample);
+        for (unsigned int i = 0; i < n_params; i++) samples[k * n_params + i] = sample[i];
+      }
+    }
+    mkdir("outputData", 0755);
+    if (options.SfpMlmc) {
+      //the samples are the pool the levels draw from; no qoi sequence is
+      //written, the percentiles come from the estimated distributions
+      mlmc_settings settings;
+      settings.Levels = options.MlmcLevels;
+      settings.CoarseSteps = options.MlmcCoarseSteps;
+      settings.Tolerance = options.MlmcTolerance;
+      settings.InitialSamples = options.MlmcInitialSamples;
+      settings.MaxSamples = options.MlmcMaxSamples;
+      settings.GridPoints = options.MlmcGrid;
+      settings.Seed = options.Seed;
+      settings.Sigma = options.QoiNoise ? std::sqrt(var) : 0.;
+      zikaSolveSfpMlmc(env, initialValues, times, &dynMain, samples, n_params,
+          settings, "outputData/qoi-stats");
+    }
+    else {
+      mc_convergence convergence(options.SfpTolerance, options.SfpMinSamples);
+      solveSfpBatch(env, samples, n_params, qoiRoutine_Data,
+          options.SfpSamples, n_weeks * dim,
+          options.BinaryOutput ? "outputData/sfp_qoi_seq.zbin" : "outputData/sfp_qoi_seq.m",
+          options.BinaryOutput, rep_factor, convergence);
+    }
+  }
+  else {
+    std::cout << "Solving the SFP with Monte Carlo" 
+              << std::endl << std::endl;  
+    fp.solveWithMonteCarlo(NULL);
+  }
+  printSolverStats(env, "SFP");
+  if (options.QoiStats && !options.SfpMlmc) {
+    mkdir("outputData", 0755);
+    writeQoiStats(env, qoiStats, options.QoiNoise ? std::sqrt(var) : 0., "outputData/qoi-stats");
+  }
 
   //------------------------------------------------------
   gettimeofday(&timevalNow, NULL);
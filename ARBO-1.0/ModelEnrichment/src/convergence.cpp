@@ -0,0 +1,142 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the running convergence metrics of the forward
+ * Monte Carlo runs, the C++ counterpart of
+ * UncertaintyQuantification/randvar_mc_conv.m.
+ *-----------------------------------------------------------------*/
+
+#include "convergence.h"
+#include <algorithm>
+#include <cmath>
+
+static const char * zikaConvQuantityNames[ZIKA_CONV_QUANTITIES] = {
+  "norm", "final_cases", "peak_cases", "peak_week"
+};
+
+const char* zikaConvQuantityName(unsigned int q)
+{
+  return q < ZIKA_CONV_QUANTITIES ? zikaConvQuantityNames[q] : "";
+}
+
+void zikaConvQuantities(const double* cumCases, size_t stride, unsigned int n_weeks,
+    double quantities[])
+{
+  double norm = 0., peak = 0., peakWeek = 0.;
+  for (unsigned int j = 0; j < n_weeks; j++){
+    const double c = cumCases[j * stride];
+    norm += 7. * c * c;
+    if (j > 0) {
+      const double newCases = c - cumCases[(j - 1) * stride];
+      if (j == 1 || newCases > peak) {
+        peak = newCases;
+        peakWeek = j;
+      }
+    }
+  }
+  quantities[ZIKA_CONV_NORM] = norm;
+  quantities[ZIKA_CONV_FINAL] = cumCases[(n_weeks - 1) * stride];
+  quantities[ZIKA_CONV_PEAK] = peak;
+  quantities[ZIKA_CONV_PEAK_WEEK] = peakWeek;
+}
+
+//Constructor
+mc_convergence::mc_convergence(double tolerance, unsigned long minSamples)
+: Tolerance(tolerance),
+  MinSamples(minSamples),
+  m_state(__ZIKA_CONV_FIELDS, 0.)
+{
+}
+
+//Destructor
+mc_convergence::~mc_convergence()
+{
+}
+
+void mc_convergence::add(const double quantities[])
+{
+  for (unsigned int q = 0; q < ZIKA_CONV_QUANTITIES; q++){
+    if (!std::isfinite(quantities[q]) || !std::isfinite(quantities[q] * quantities[q])) return;
+  }
+  const double n = m_state[0] + 1.;
+  m_state[0] = n;
+  for (unsigned int q = 0; q < ZIKA_CONV_QUANTITIES; q++){
+    const double x[2] = { quantities[q], quantities[q] * quantities[q] };
+    for (unsigned int m = 0; m < 2; m++){
+      double & mean = m_state[1 + 4 * q + 2 * m];
+      double & M2 = m_state[2 + 4 * q + 2 * m];
+      const double d = x[m] - mean;
+      mean += d / n;
+      M2 += d * (x[m] - mean);
+    }
+  }
+}
+
+void mc_convergence::merge(const double* other)
+{
+  const double na = m_state[0], nb = other[0], n = na + nb;
+  if (nb == 0.) return;
+  for (unsigned int k = 1; k < __ZIKA_CONV_FIELDS; k += 2){
+    const double d = other[k] - m_state[k];
+    m_state[k + 1] += other[k + 1] + d * d * na * nb / n;
+    m_state[k] += d * nb / n;
+  }
+  m_state[0] = n;
+}
+
+double mc_convergence::relativeError(unsigned int q, unsigned int moment) const
+{
+  const double n = m_state[0];
+  if (n < 2.) return HUGE_VAL;
+  const unsigned int k = 1 + 4 * q + 2 * (moment - 1);
+  const double variance = m_state[k + 1] / (n - 1.);
+  const double error = std::sqrt(variance / n);
+  const double scale = std::fabs(m_state[k]);
+  if (scale > 0.) return error / scale;
+  return error > 0. ? HUGE_VAL : 0.;   //exactly zero, as a peak week of 0
+}
+
+double mc_convergence::worstError() const
+{
+  double worst = 0.;
+  for (unsigned int q = 0; q < ZIKA_CONV_QUANTITIES; q++){
+    worst = std::max(worst, std::max(relativeError(q, 1), relativeError(q, 2)));
+  }
+  return worst;
+}
+
+double mc_convergence::metric() const
+{
+  return std::sqrt(std::max(m_state[1 + 4 * ZIKA_CONV_NORM], 0.));
+}
+
+double mc_convergence::mean(unsigned int q) const
+{
+  return m_state[1 + 4 * q];
+}
+
+bool mc_convergence::converged() const
+{
+  return Tolerance > 0. && m_state[0] >= MinSamples && worstError() < Tolerance;
+}
+
+void mc_convergence::write(FILE* file, bool header) const
+{
+  if (header) {
+    fprintf(file, "# samples MC_conv");
+    for (unsigned int q = 0; q < ZIKA_CONV_QUANTITIES; q++){
+      fprintf(file, " mean_%s relerr_%s", zikaConvQuantityNames[q], zikaConvQuantityNames[q]);
+    }
+    fprintf(file, "\n");
+  }
+  fprintf(file, "%.0f %.9e", m_state[0], metric());
+  for (unsigned int q = 0; q < ZIKA_CONV_QUANTITIES; q++){
+    fprintf(file, " %.9e %.3e", mean(q), std::max(relativeError(q, 1), relativeError(q, 2)));
+  }
+  fprintf(file, "\n");
+  fflush(file);
+}
@@ -0,0 +1,258 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the streaming convergence diagnostics of the
+ * in-process MCMC samplers: batch-means ESS, split R-hat and
+ * autocorrelation.
+ *-----------------------------------------------------------------*/
+
+#include "diagnostics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+//Constructor
+chain_diagnostics::chain_diagnostics(unsigned int n_chains, unsigned int n_params,
+    unsigned int max_lag, unsigned int n_batches)
+: m_chains(n_chains),
+  m_params(n_params),
+  m_maxLag(max_lag > 0 ? max_lag : 1),
+  m_batches(n_batches > 1 ? n_batches : 2),
+  m_n(n_chains, 0),
+  m_half(n_chains, 0),
+  m_batchSize(n_chains, 1),
+  m_batchFill(n_chains, 0),
+  m_shift(n_chains * n_params, 0.),
+  m_sum(n_chains * n_params, 0.),
+  m_sumSq(n_chains * n_params, 0.),
+  m_halfSum(n_chains * n_params, 0.),
+  m_halfSumSq(n_chains * n_params, 0.),
+  m_ring(n_chains * m_maxLag * n_params, 0.),
+  m_lagged(n_chains * m_maxLag * n_params, 0.),
+  m_open(n_chains * n_params, 0.),
+  m_batchSums(n_chains)
+{
+}
+
+//Destructor
+chain_diagnostics::~chain_diagnostics()
+{
+}
+
+void chain_diagnostics::update(unsigned int c, const double* chain, unsigned int n)
+{
+  const unsigned int P = m_params;
+  const unsigned int L = m_maxLag;
+  double * shift = &m_shift[c * P];
+  double * sum = &m_sum[c * P];
+  double * sumSq = &m_sumSq[c * P];
+  double * ring = &m_ring[c * L * P];
+  double * lagged = &m_lagged[c * L * P];
+  double * open = &m_open[c * P];
+  std::vector<double> & batchSums = m_batchSums[c];
+
+  if (m_n[c] == 0 && n > 0) std::copy(chain, chain + P, shift);
+  for (unsigned int t = m_n[c]; t < n; t++){
+    const double * x = chain + t * P;
+    const unsigned int lags = std::min(L, t);
+    for (unsigned int i = 0; i < P; i++){
+      const double y = x[i] - shift[i];
+      sum[i] += y;
+      sumSq[i] += y * y;
+      for (unsigned int l = 1; l <= lags; l++){
+        lagged[(l - 1) * P + i] += y * ring[((t - l) % L) * P + i];
+      }
+      ring[(t % L) * P + i] = y;
+      open[i] += y;
+    }
+    //close the open batch, and halve the batches once there are too many
+    if (++m_batchFill[c] == m_batchSize[c]) {
+      batchSums.insert(batchSums.end(), open, open + P);
+      std::fill(open, open + P, 0.);
+      m_batchFill[c] = 0;
+      if (batchSums.size() == 2 * m_batches * P) {
+        for (unsigned int j = 0; j < m_batches; j++){
+          for (unsigned int i = 0; i < P; i++){
+            batchSums[j * P + i] = batchSums[2 * j * P + i] + batchSums[(2 * j + 1) * P + i];
+          }
+        }
+        batchSums.resize(m_batches * P);
+        m_batchSize[c] *= 2;
+      }
+    }
+  }
+  if (n > m_n[c]) m_n[c] = n;
+
+  //the first half of the chain follows its middle
+  for (; m_half[c] < m_n[c] / 2; m_half[c]++){
+    const double * x = chain + m_half[c] * P;
+    for (unsigned int i = 0; i < P; i++){
+      const double y = x[i] - shift[i];
+      m_halfSum[c * P + i] += y;
+      m_halfSumSq[c * P + i] += y * y;
+    }
+  }
+}
+
+//sample variance of n values from their sum and sum of squares
+static double sampleVariance(double sum, double sumSq, unsigned int n)
+{
+  if (n < 2) return 0.;
+  return std::max(sumSq - sum * sum / n, 0.) / (n - 1);
+}
+
+//Fields per chain and delta:
+//  0 positions, 1 mean, 2 variance, 3 and 4 mean and variance of the first
+//  half, 5 and 6 those of the second half, 7 batch-means ESS,
+//  8 integrated autocorrelation time, 9 lag 1 autocorrelation
+void chain_diagnostics::pack(std::vector<double>& buffer) const
+{
+  const unsigned int P = m_params;
+  const unsigned int L = m_maxLag;
+  buffer.assign(m_chains * P * __ZIKA_DIAG_FIELDS, 0.);
+  for (unsigned int c = 0; c < m_chains; c++){
+    const unsigned int n = m_n[c];
+    const unsigned int h = m_half[c];
+    const unsigned int a = m_batchSums[c].size() / P;
+    const unsigned int b = m_batchSize[c];
+    for (unsigned int i = 0; i < P; i++){
+      const unsigned int k = c * P + i;
+      double * f = &buffer[k * __ZIKA_DIAG_FIELDS];
+      const double mean = n ? m_sum[k] / n : 0.;
+      const double var = sampleVariance(m_sum[k], m_sumSq[k], n);
+      f[0] = n;
+      f[1] = mean + m_shift[k];
+      f[2] = var;
+      f[3] = (h ? m_halfSum[k] / h : 0.) + m_shift[k];
+      f[4] = sampleVariance(m_halfSum[k], m_halfSumSq[k], h);
+      f[5] = (n > h ? (m_sum[k] - m_halfSum[k]) / (n - h) : 0.) + m_shift[k];
+      f[6] = sampleVariance(m_sum[k] - m_halfSum[k], m_sumSq[k] - m_halfSumSq[k], n - h);
+
+      //batch means: sigma^2 = b var(batch means), ESS = n var / sigma^2
+      double ess = 0.;
+      if (a >= 2 && var > 0.) {
+        double batchMean = 0., batchVar = 0.;
+        for (unsigned int j = 0; j < a; j++) batchMean += m_batchSums[c][j * P + i] / b;
+        batchMean /= a;
+        for (unsigned int j = 0; j < a; j++){
+          const double d = m_batchSums[c][j * P + i] / b - batchMean;
+          batchVar += d * d;
+        }
+        const double sigma2 = b * batchVar / (a - 1);
+        ess = (sigma2 > 0.) ? std::min((double) n, n * var / sigma2) : n;
+      }
+      f[7] = ess;
+
+      //autocorrelations from the lagged sums, then Geyer's initial positive
+      //sequence: tau = -1 + 2 sum_m (rho_2m + rho_2m+1) while positive
+      const double varPop = n ? std::max(m_sumSq[k] / n - mean * mean, 0.) : 0.;
+      double tau = n, acf1 = 1.;
+      if (varPop > 0. && n > 2) {
+        const unsigned int lags = std::min(L, n - 1);
+        std::vector<double> rho(lags + 1, 0.);
+        rho[0] = 1.;
+        for (unsigned int l = 1; l <= lags; l++){
+          rho[l] = (m_lagged[(c * L + l - 1) * P + i] / (n - l) - mean * mean) / varPop;
+        }
+        acf1 = rho[1];
+        tau = -1.;
+        for (unsigned int m = 0; 2 * m + 1 <= lags; m++){
+          const double pair = rho[2 * m] + rho[2 * m + 1];
+          if (pair <= 0.) break;
+          tau += 2. * pair;
+        }
+        if (n > 10) tau = std::max(tau, 1. / std::log10((double) n));
+        tau = std::max(tau, 1. / n);
+      }
+      f[8] = tau;
+      f[9] = acf1;
+    }
+  }
+}
+
+void zikaCombineDiagnostics(
+  const std::vector<double>&      packed,
+  unsigned int                    n_chains,
+  unsigned int                    n_params,
+  chain_report&                   report)
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  report.Positions = 0;
+  report.Shortest = n_chains ? (unsigned int) packed[0] : 0;
+  report.Ess.assign(n_params, 0.);
+  report.EssAcf.assign(n_params, 0.);
+  report.Rhat.assign(n_params, inf);
+  report.Acf1.assign(n_params, 0.);
+  report.Tau.assign(n_params, 0.);
+  for (unsigned int c = 0; c < n_chains; c++){
+    const unsigned int n = packed[c * n_params * __ZIKA_DIAG_FIELDS];
+    report.Positions += n;
+    report.Shortest = std::min(report.Shortest, n);
+  }
+
+  for (unsigned int i = 0; i < n_params; i++){
+    //split R-hat over the 2 n_chains half chains
+    double W = 0., meanOfMeans = 0., B = 0.;
+    for (unsigned int c = 0; c < n_chains; c++){
+      const double * f = &packed[(c * n_params + i) * __ZIKA_DIAG_FIELDS];
+      report.Ess[i] += f[7];
+      report.EssAcf[i] += f[0] / f[8];
+      report.Acf1[i] += f[9] / n_chains;
+      report.Tau[i] += f[8] / n_chains;
+      W += f[4] + f[6];
+      meanOfMeans += f[3] + f[5];
+    }
+    const unsigned int halves = 2 * n_chains;
+    W /= halves;
+    meanOfMeans /= halves;
+    for (unsigned int c = 0; c < n_chains; c++){
+      const double * f = &packed[(c * n_params + i) * __ZIKA_DIAG_FIELDS];
+      B += (f[3] - meanOfMeans) * (f[3] - meanOfMeans)
+         + (f[5] - meanOfMeans) * (f[5] - meanOfMeans);
+    }
+    B /= (halves - 1);   //B/h in Gelman's notation
+    const double h = report.Shortest / 2;
+    if (h >= 2 && W > 0.) report.Rhat[i] = std::sqrt(((h - 1.) / h * W + B) / W);
+  }
+
+  report.MinEss = n_params ? *std::min_element(report.Ess.begin(), report.Ess.end()) : 0.;
+  report.MaxRhat = n_params ? *std::max_element(report.Rhat.begin(), report.Rhat.end()) : inf;
+}
+
+void zikaWriteDiagnostics(
+  const char*                     fileName,
+  const chain_report&             report,
+  unsigned int                    n_chains,
+  unsigned int                    step,
+  unsigned int                    length,
+  double                          targetEss,
+  double                          targetRhat)
+{
+  const std::string temporary = std::string(fileName) + ".tmp";
+  FILE *file = fopen(temporary.c_str(),"w");
+  if (!file) {
+    printf("WARNING: could not open %s\n", temporary.c_str());
+    return;
+  }
+  fprintf(file,"# %u of %u positions per chain, %u chains, %u positions\n",
+      step, length, n_chains, report.Positions);
+  fprintf(file,"# min ESS %.1f", report.MinEss);
+  if (targetEss > 0.) fprintf(file," (target %.1f)", targetEss);
+  fprintf(file,", max split R-hat %.4f", report.MaxRhat);
+  if (targetEss > 0.) fprintf(file," (target %.4f)", targetRhat);
+  fprintf(file,"\n# delta ess_batch ess_acf rhat acf1 tau\n");
+  for (unsigned int i = 0; i < report.Ess.size(); i++){
+    fprintf(file,"delta_%u %.1f %.1f %.4f %.4f %.2f\n", i, report.Ess[i], report.EssAcf[i],
+        report.Rhat[i], report.Acf1[i], report.Tau[i]);
+  }
+  fclose(file);
+  if (std::rename(temporary.c_str(), fileName) != 0) {
+    printf("WARNING: could not write %s\n", fileName);
+  }
+}
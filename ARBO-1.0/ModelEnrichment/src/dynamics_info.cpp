@@ -1,4 +1,5 @@
 #include "dynamics_info.h"
+#include <cstddef>
 
 //Constructor
 dynamics_info::dynamics_info(
@@ -12,7 +13,27 @@ dynamics_info::dynamics_info(
   N_times(n_times),
   Inad_type(inad_type),
   Params_factor(params_factor),
-  Deltas(deltas)
+  Deltas(deltas),
+  Bh(1/11.3),
+  Ah(1/5.9),
+  G(1/7.9),
+  D(1/11.),
+  Bv(1/8.6),
+  Av(1/9.1),
+  Nv(1.),
+  Nh(206.e6),
+  Rhs(NULL),
+  Jac(NULL),
+  SensRhs(NULL),
+  Solver(ZIKA_SOLVER_RKF45),
+  WarmStart(0),
+  WarmStartRadius(0.),
+  DenseOutput(0),
+  ScaledTolerance(0),
+  PositivityWidth(0.),
+  MaxRhsCalls(0),
+  MinStep(0.),
+  MaxSeconds(0.)
 {
 }
 
@@ -0,0 +1,276 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ * 
+ * This file contains the batched ensemble integrator: __ZIKA_LANES
+ * parameter sets are advanced in lockstep, in structure-of-arrays
+ * layout (one lanes<> pack per state variable), with the same
+ * Runge-Kutta-Fehlberg (4,5) pair and error control as the GSL driver
+ * of zikaComputeModel. Every lane has its own step size and accepts or
+ * rejects its own steps; a lane whose sample is finished (or failed)
+ * is refilled with the next sample, so the packs stay full until the
+ * end of the block.
+ *-----------------------------------------------------------------*/
+
+#include "ensemble.h"
+#include "model.h"
+#include "rhs.h"
+#include "lanes.h"
+#include <algorithm>
+#include <cmath>
+#include <gsl/gsl_errno.h>
+
+//Runge-Kutta-Fehlberg (4,5) tableau, as in gsl_odeiv2_step_rkf45
+static const double ah[] = { 1.0/4.0, 3.0/8.0, 12.0/13.0, 1.0, 1.0/2.0 };
+static const double b3[] = { 3.0/32.0, 9.0/32.0 };
+static const double b4[] = { 1932.0/2197.0, -7200.0/2197.0, 7296.0/2197.0 };
+static const double b5[] = { 8341.0/4104.0, -32832.0/4104.0, 29440.0/4104.0, -845.0/4104.0 };
+static const double b6[] = { -6080.0/20520.0, 41040.0/20520.0, -28352.0/20520.0, 9295.0/20520.0, -5643.0/20520.0 };
+static const double c1 = 902880.0/7618050.0;
+static const double c3 = 3953664.0/7618050.0;
+static const double c4 = 3855735.0/7618050.0;
+static const double c5 = -1371249.0/7618050.0;
+static const double c6 = 277020.0/7618050.0;
+static const double ec[] = { 0.0, 1.0/360.0, 0.0, -128.0/4275.0, -2197.0/75240.0, 1.0/50.0, 2.0/55.0 };
+
+//same initial step and tolerances as zikaComputeModel
+static const double ensHStart = 1e-10;
+static const double ensEpsAbs = 1e-8;
+static const double ensEpsRel = 1e-4;
+//a lane gives up on its sample past these
+static const double ensHMin = 1e-12;
+static const unsigned long ensMaxSteps = 1000000;
+
+template <unsigned int INAD, unsigned int NS>
+static void zikaEnsembleSolve(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info&        dyn,
+  const std::vector<double>&  deltas,
+  unsigned int                n_samples,
+  std::vector<double>&        returnValues,
+  std::vector<int>&           status)
+{
+  typedef lanes<__ZIKA_LANES> pack;
+  const unsigned int L = __ZIKA_LANES;
+  const unsigned int dim = NS + 1;
+  const unsigned int n_params = inad_traits<INAD,NS>::pf * NS;
+  const unsigned int n_times = timePoints.size();
+  const unsigned int rowSize = n_times * dim;
+
+  pack y[dim], yt[dim], yn[dim], yerr[dim];
+  pack k1[dim], k2[dim], k3[dim], k4[dim], k5[dim], k6[dim];
+  //inad_type 3 reads two entries past the last row of deltas, keep them zero
+  pack delta[n_params + 2];
+  pack hv;
+
+  double t[L], h[L];
+  unsigned int sample[L], next[L];
+  unsigned long steps[L];
+  bool active[L], final[L];
+
+  //absolute tolerance of every state variable, see zikaAllocDriver
+  double epsAbs[dim];
+  for (unsigned int i = 0; i < dim; i++){
+    epsAbs[i] = dyn.ScaledTolerance ? ensEpsAbs * dyn.Scale(i) : ensEpsAbs;
+  }
+  unsigned long n_solves = 0, n_accepted = 0, n_rejected = 0, n_failed = 0;
+  //budget of every lane, tightened by that of dyn (six right-hand side
+  //calls per step attempt; no wall clock, the lanes share one)
+  const double hMin = std::max(ensHMin, dyn.MinStep);
+  const unsigned long maxSteps = (dyn.MaxRhsCalls > 0) ?
+    std::min(ensMaxSteps, dyn.MaxRhsCalls / 6) : ensMaxSteps;
+
+  for (unsigned int p = 0; p < n_params + 2; p++) delta[p] = pack(0.);
+  for (unsigned int i = 0; i < dim; i++) y[i] = pack(0.);
+  for (unsigned int l = 0; l < L; l++) active[l] = false;
+
+  //no step to take: every row is the initial state (or empty)
+  if (n_times <= 1) {
+    for (unsigned int s = 0; s < n_samples; s++){
+      std::copy(initialValues.begin(), initialValues.begin() + rowSize,
+                returnValues.begin() + s * rowSize);
+      status[s] = GSL_SUCCESS;
+    }
+    return;
+  }
+
+  unsigned int nextSample = 0;
+  while (true) {
+    //load the next samples into idle lanes
+    unsigned int n_active = 0;
+    for (unsigned int l = 0; l < L; l++){
+      if (!active[l] && nextSample < n_samples) {
+        const unsigned int s = nextSample++;
+        sample[l] = s;
+        next[l] = 1;
+        steps[l] = 0;
+        t[l] = timePoints[0];
+        h[l] = ensHStart;
+        active[l] = true;
+        for (unsigned int i = 0; i < dim; i++){
+          y[i].v[l] = initialValues[i];
+          returnValues[s * rowSize + i] = initialValues[i];
+        }
+        for (unsigned int p = 0; p < n_params; p++){
+          delta[p].v[l] = deltas[s * n_params + p];
+        }
+      }
+      if (active[l]) n_active++;
+    }
+    if (n_active == 0) break;
+
+    //step size of every lane, landing exactly on its next output time;
+    //idle lanes take a zero step
+    for (unsigned int l = 0; l < L; l++){
+      hv.v[l] = 0.;
+      final[l] = false;
+      if (active[l]) {
+        const double remaining = timePoints[next[l]] - t[l];
+        final[l] = (h[l] >= remaining);
+        hv.v[l] = final[l] ? remaining : h[l];
+      }
+    }
+
+    //one Runge-Kutta-Fehlberg step of all lanes
+    zikaRhs<INAD,NS,pack,pack>(y, k1, delta, dyn);
+    for (unsigned int i = 0; i < dim; i++) yt[i] = y[i] + hv * (ah[0] * k1[i]);
+    zikaRhs<INAD,NS,pack,pack>(yt, k2, delta, dyn);
+    for (unsigned int i = 0; i < dim; i++) yt[i] = y[i] + hv * (b3[0] * k1[i] + b3[1] * k2[i]);
+    zikaRhs<INAD,NS,pack,pack>(yt, k3, delta, dyn);
+    for (unsigned int i = 0; i < dim; i++) yt[i] = y[i] + hv * (b4[0] * k1[i] + b4[1] * k2[i] + b4[2] * k3[i]);
+    zikaRhs<INAD,NS,pack,pack>(yt, k4, delta, dyn);
+    for (unsigned int i = 0; i < dim; i++) yt[i] = y[i] + hv * (b5[0] * k1[i] + b5[1] * k2[i] + b5[2] * k3[i] + b5[3] * k4[i]);
+    zikaRhs<INAD,NS,pack,pack>(yt, k5, delta, dyn);
+    for (unsigned int i = 0; i < dim; i++) yt[i] = y[i] + hv * (b6[0] * k1[i] + b6[1] * k2[i] + b6[2] * k3[i] + b6[3] * k4[i] + b6[4] * k5[i]);
+    zikaRhs<INAD,NS,pack,pack>(yt, k6, delta, dyn);
+    for (unsigned int i = 0; i < dim; i++){
+      yn[i] = y[i] + hv * (c1 * k1[i] + c3 * k3[i] + c4 * k4[i] + c5 * k5[i] + c6 * k6[i]);
+      yerr[i] = hv * (ec[1] * k1[i] + ec[3] * k3[i] + ec[4] * k4[i] + ec[5] * k5[i] + ec[6] * k6[i]);
+    }
+
+    //error norm of all lanes (GSL's standard control with a_y = 1)
+    pack rnorm(0.);
+    for (unsigned int i = 0; i < dim; i++){
+      const pack r = abs(yerr[i]) / (epsAbs[i] + ensEpsRel * abs(yn[i]));
+      for (unsigned int l = 0; l < L; l++){
+        rnorm.v[l] = (r.v[l] <= rnorm.v[l]) ? rnorm.v[l] : r.v[l];    //also picks up a NaN
+      }
+    }
+
+    //step control, lane by lane
+    for (unsigned int l = 0; l < L; l++){
+      if (!active[l]) continue;
+      const unsigned int s = sample[l];
+      const double rmax = rnorm.v[l];
+      bool failed = (++steps[l] > maxSteps);
+      if (!(rmax <= 1.1)) {
+        //reject, retry from the same time with a smaller step
+        const double r = std::isnan(rmax) ? 0.2 : std::max(0.9 * std::pow(rmax, -1.0 / 5.0), 0.2);
+        h[l] = r * hv.v[l];
+        failed = failed || (h[l] < hMin);
+        n_rejected++;
+      }
+      else {
+        n_accepted++;
+        for (unsigned int i = 0; i < dim; i++){
+          y[i].v[l] = yn[i].v[l];
+        }
+        if (final[l]) {
+          //the step size is not adjusted on a step cut short to hit t1
+          t[l] = timePoints[next[l]];
+          for (unsigned int i = 0; i < dim; i++){
+            returnValues[s * rowSize + dim * next[l] + i] = y[i].v[l];
+          }
+          if (++next[l] == n_times) {
+            status[s] = GSL_SUCCESS;
+            active[l] = false;
+            n_solves++;
+          }
+        }
+        else {
+          t[l] += hv.v[l];
+          if (rmax < 0.5) {
+            h[l] = hv.v[l] * std::min(std::max(0.9 * std::pow(rmax, -1.0 / 6.0), 1.0), 5.0);
+          }
+        }
+      }
+      if (failed && active[l]) {
+        status[s] = GSL_FAILURE;
+        for (unsigned int j = 0; j < rowSize; j++){
+          returnValues[s * rowSize + j] = 0.;
+        }
+        active[l] = false;
+        n_solves++;
+        n_failed++;
+      }
+    }
+  }
+  zikaCountSteps(n_solves, n_accepted, n_rejected, n_failed);
+}
+
+void zikaComputeEnsemble(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  dynamics_info*              dyn,
+  const std::vector<double>&  deltas,
+  unsigned int                n_samples,
+  std::vector<double>&        returnValues,
+  std::vector<int>&           status)
+{
+  const unsigned int dim = dyn->N_s + 1;
+  const unsigned int n_params = dyn->Params_factor * dyn->N_s;
+  const unsigned int rowSize = timePoints.size() * dim;
+  returnValues.resize(n_samples * rowSize);
+  status.assign(n_samples, GSL_SUCCESS);
+
+  if (dyn->N_s == 7 && initialValues.size() == dim) {
+    switch (dyn->Inad_type) {
+      case 0:
+        if (dyn->Params_factor == inad_traits<0,7>::pf) {
+          zikaEnsembleSolve<0,7>(initialValues, timePoints, *dyn, deltas, n_samples, returnValues, status);
+          return;
+        }
+        break;
+      case 1:
+        if (dyn->Params_factor == inad_traits<1,7>::pf) {
+          zikaEnsembleSolve<1,7>(initialValues, timePoints, *dyn, deltas, n_samples, returnValues, status);
+          return;
+        }
+        break;
+      case 2:
+        if (dyn->Params_factor == inad_traits<2,7>::pf) {
+          zikaEnsembleSolve<2,7>(initialValues, timePoints, *dyn, deltas, n_samples, returnValues, status);
+          return;
+        }
+        break;
+      case 3:
+        if (dyn->Params_factor == inad_traits<3,7>::pf) {
+          zikaEnsembleSolve<3,7>(initialValues, timePoints, *dyn, deltas, n_samples, returnValues, status);
+          return;
+        }
+        break;
+    }
+  }
+
+  //no specialized kernel: one scalar solve per sample, with the statuses
+  //and zero rows of failed solves as above
+  std::vector<double> sampleValues(rowSize, 0.);
+  //the inad_type 3 kernel reads two entries past the deltas
+  std::vector<double> sampleDeltas(n_params + 2, 0.);
+  for (unsigned int s = 0; s < n_samples; s++){
+    std::copy(&deltas[s * n_params], &deltas[s * n_params] + n_params, sampleDeltas.begin());
+    try
+      {
+        zikaComputeModel(initialValues, timePoints, dyn, &sampleDeltas[0], sampleValues);
+        std::copy(sampleValues.begin(), sampleValues.end(), returnValues.begin() + s * rowSize);
+      } catch( const zika_solve_failure & failure )
+      {
+        status[s] = GSL_FAILURE;
+        std::fill(returnValues.begin() + s * rowSize, returnValues.begin() + (s + 1) * rowSize, 0.);
+      }
+  }
+}
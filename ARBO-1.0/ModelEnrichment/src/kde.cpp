@@ -0,0 +1,139 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the binned, FFT based kernel density estimates,
+ * the C++ counterpart of UncertaintyQuantification/randvar_ksd.m.
+ *-----------------------------------------------------------------*/
+
+#include "kde.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <gsl/gsl_fft_real.h>
+#include <gsl/gsl_fft_halfcomplex.h>
+
+//Constructor
+kde_settings::kde_settings()
+:
+  Points(100),
+  GridSize(1024),
+  Bandwidth(0.)
+{
+}
+
+//Destructor
+kde_settings::~kde_settings()
+{
+}
+
+//bandwidth of ksdensity: the normal reference rule with a robust sigma
+//(the median absolute deviation) of the n values of x, with work as scratch
+static double zikaKdeBandwidth(const std::vector<double>& x, size_t n, double lo, double hi,
+    std::vector<double>& work)
+{
+  std::copy(x.begin(), x.begin() + n, work.begin());
+  std::nth_element(work.begin(), work.begin() + n / 2, work.begin() + n);
+  const double median = work[n / 2];
+  for (size_t s = 0; s < n; s++) work[s] = std::fabs(x[s] - median);
+  std::nth_element(work.begin(), work.begin() + n / 2, work.begin() + n);
+  double sigma = work[n / 2] / 0.6745;
+  if (!(sigma > 0.)) sigma = hi - lo;
+  return sigma > 0. ? sigma * std::pow(4. / (3. * n), 0.2) : 1.;
+}
+
+//density of one variable: x holds its n finite samples on [lo, hi], bins
+//is a scratch array of M (a power of two) values; writes Points values
+//of column v of density
+static void zikaKdeColumn(const std::vector<double>& x, size_t n, double lo, double hi, double h,
+    std::vector<double>& bins, const kde_settings& settings, unsigned int n_vars, unsigned int v,
+    std::vector<double>& density)
+{
+  const size_t M = bins.size();
+  //grid padded by 4h on both sides: the circular convolution of the FFT
+  //then wraps nothing but the far tails of the kernel around
+  const double a = lo - 4. * h, dx = (hi - lo + 8. * h) / M;
+  std::fill(bins.begin(), bins.end(), 0.);
+  for (size_t s = 0; s < n; s++){
+    const double pos = (x[s] - a) / dx;
+    const size_t k = std::min((size_t) pos, M - 2);
+    const double f = pos - k;
+    bins[k] += 1. - f;
+    bins[k + 1] += f;
+  }
+
+  //convolution with the Gaussian kernel: its transform is analytic,
+  //exp(-(h w)^2/2) at the angular frequency w = 2 pi k/(M dx)
+  gsl_fft_real_radix2_transform(&bins[0], 1, M);
+  const double c = 2. * M_PI * h / (M * dx);
+  for (size_t k = 1; k < M / 2; k++){
+    const double damping = std::exp(-0.5 * (c * k) * (c * k));
+    bins[k] *= damping;
+    bins[M - k] *= damping;
+  }
+  bins[M / 2] *= std::exp(-0.5 * (c * M / 2) * (c * M / 2));
+  gsl_fft_halfcomplex_radix2_inverse(&bins[0], 1, M);
+
+  //linear interpolation to the points of randvar_ksd
+  const unsigned int P = settings.Points;
+  const double scale = 1. / (n * dx);
+  for (unsigned int i = 0; i < P; i++){
+    const double xi = (P > 1) ? lo + i * (hi - lo) / (P - 1) : lo;
+    const double pos = (xi - a) / dx;
+    const size_t k = std::min((size_t) pos, M - 2);
+    const double f = pos - k;
+    const double value = ((1. - f) * bins[k] + f * bins[k + 1]) * scale;
+    density[i * n_vars + v] = std::max(value, 0.);   //round-off of the FFT
+  }
+}
+
+void zikaKernelDensities(
+  const double*                   samples,
+  size_t                          n_samples,
+  unsigned int                    n_vars,
+  size_t                          sampleStride,
+  size_t                          varStride,
+  const kde_settings&             settings,
+  std::vector<double>&            density,
+  std::vector<double>&            support,
+  std::vector<double>&            bandwidth)
+{
+  const unsigned int P = std::max(settings.Points, 1u);
+  size_t M = 64;
+  while (M < settings.GridSize) M *= 2;
+  kde_settings s = settings;
+  s.Points = P;
+  density.assign(P * n_vars, 0.);
+  support.assign(P * n_vars, 0.);
+  bandwidth.assign(n_vars, 0.);
+
+  #pragma omp parallel
+  {
+    std::vector<double> x(n_samples), work(n_samples), bins(M);
+    #pragma omp for schedule(dynamic)
+    for (int v = 0; v < (int) n_vars; v++){
+      const double * column = samples + v * varStride;
+      double lo = std::numeric_limits<double>::infinity(), hi = -lo;
+      size_t n = 0;
+      for (size_t r = 0; r < n_samples; r++){
+        const double value = column[r * sampleStride];
+        if (!std::isfinite(value)) continue;
+        x[n++] = value;
+        lo = std::min(lo, value);
+        hi = std::max(hi, value);
+      }
+      if (n == 0) lo = hi = std::numeric_limits<double>::quiet_NaN();
+      for (unsigned int i = 0; i < P; i++){
+        support[i * n_vars + v] = (P > 1) ? lo + i * (hi - lo) / (P - 1) : lo;
+      }
+      if (!(hi > lo)) continue;
+
+      const double h = (s.Bandwidth > 0.) ? s.Bandwidth : zikaKdeBandwidth(x, n, lo, hi, work);
+      bandwidth[v] = h;
+      zikaKdeColumn(x, n, lo, hi, h, bins, s, n_vars, v, density);
+    }
+  }
+}
@@ -10,6 +10,8 @@
 #include "likelihood.h"
 #include "dynamics_info.h"
 #include "model.h"
+#include "ensemble.h"
+#include <algorithm>
 #include <cmath>
 #include <stdio.h>
 #include <fstream>
@@ -27,7 +29,13 @@ likelihoodRoutine_Data::likelihoodRoutine_Data(
   m_ics(ics),
   m_csc(csc),
   m_var(var),
-  m_dynMain(dynInfo)
+  m_dynMain(dynInfo),
+  m_returnValues(dynInfo->N_times * (dynInfo->N_s + 1), 0.),
+  m_sensitivities(dynInfo->SensRhs ?
+      dynInfo->N_times * (dynInfo->N_s + 1) * dynInfo->Params_factor * dynInfo->N_s : 0, 0.),
+  m_failureLogLikelihood(-500000.),
+  m_nObserved(dynInfo->N_times),
+  m_observedTimes(times)
 {
 }
 
@@ -36,6 +44,14 @@ likelihoodRoutine_Data::~likelihoodRoutine_Data()
 {
 }
 
+// the weeks after the first n_observed are not data (a season still under
+// way, or zika_nWeeks beyond the data)
+void likelihoodRoutine_Data::setObservedWeeks(unsigned int n_observed)
+{
+  m_nObserved = std::min(std::max(n_observed, 1u), m_dynMain->N_times);
+  m_observedTimes.assign(m_times.begin(), m_times.begin() + m_nObserved);
+}
+
 //------------------------------------------------------
 // The user defined likelihood routine
 //------------------------------------------------------
@@ -59,20 +75,74 @@ double likelihoodRoutine(
   
   // Compute likelihood 
   // get data from likelihood data structure
-  const std::vector<double>&  times
-    = ((likelihoodRoutine_Data *) functionDataPtr)->m_times;
-  std::vector<double>& ics
-    = ((likelihoodRoutine_Data *) functionDataPtr)->m_ics;
-  const std::vector<double>& csc 
-    = ((likelihoodRoutine_Data *) functionDataPtr)->m_csc;
-  double & var
-    = ((likelihoodRoutine_Data *) functionDataPtr)->m_var;
-  dynamics_info *        dyn
+  const dynamics_info *  dyn
     = ((likelihoodRoutine_Data *) functionDataPtr)->m_dynMain;
 
+  const unsigned int n_params = dyn->Params_factor * dyn->N_s;      //the number of parameters to be calibrated
+
+  //return all times of C (cumulative cases), preallocated in the data struct
+  std::vector<double>& returnValues
+    = ((likelihoodRoutine_Data *) functionDataPtr)->m_returnValues;
+
+  //the deltas of this evaluation stay local, dyn is only read. The
+  //inad_type 3 kernel reads two entries past the deltas, keep them at zero
+  double deltas[n_params + 2];
+  deltas[n_params] = deltas[n_params + 1] = 0.;
+  /* for (unsigned int i = 0; i < n_params; i++){  deltas[i] = -std::exp(paramValues[i]); } */
+  for (unsigned int i = 0; i < n_params; i++){  
+      /* deltas[i] = -std::abs(paramValues[i]); */ 
+      deltas[i] = paramValues[i]; 
+      /* std::cout << "deltas[i] = " << deltas[i]<< "\n"; */
+  }
+  /* for (unsigned int i = 0; i < n_params; i++){  deltas[i] = 0.; } */
+
+  likelihoodRoutine_Data & data = *((likelihoodRoutine_Data *) functionDataPtr);
+
+  //QUESO asks for derivatives (MAP seed, gradient-based samplers): solve
+  //the forward sensitivities along with the state
+  if ((gradVector || hessianMatrix || hessianEffect) && dyn->SensRhs) {
+    double gradient[n_params];
+    std::vector<double> hessian((hessianMatrix || hessianEffect) ? n_params * n_params : 0);
+    const double logLikelihood = zikaLogLikelihoodGradient(deltas, data, returnValues,
+        data.m_sensitivities, gradient, hessian.empty() ? NULL : &hessian[0]);
+    if (gradVector) {
+      for (unsigned int p = 0; p < n_params; p++) (*gradVector)[p] = gradient[p];
+    }
+    if (hessianMatrix) {
+      for (unsigned int p = 0; p < n_params; p++){
+        for (unsigned int q = 0; q < n_params; q++) (*hessianMatrix)(p,q) = hessian[n_params * p + q];
+      }
+    }
+    if (hessianEffect && paramDirection) {
+      for (unsigned int p = 0; p < n_params; p++){
+        double effect = 0.;
+        for (unsigned int q = 0; q < n_params; q++) effect += hessian[n_params * p + q] * (*paramDirection)[q];
+        (*hessianEffect)[p] = effect;
+      }
+    }
+    return logLikelihood;
+  }
+
+  return zikaLogLikelihood(deltas, data, returnValues);
+}
+
+//------------------------------------------------------
+// Reentrant core of the likelihood routine
+//------------------------------------------------------
+
+double zikaLogLikelihood(
+  const double*                 deltas,
+  const likelihoodRoutine_Data& data,
+  std::vector<double>&          returnValues)
+{
+  const std::vector<double>&  times = data.m_observedTimes;
+  const std::vector<double>&  ics = data.m_ics;
+  const std::vector<double>&  csc = data.m_csc;
+  const double var = data.m_var;
+  const dynamics_info *       dyn = data.m_dynMain;
+
   const unsigned int n_s = dyn->N_s;          //the number of species included in the model
-  const unsigned int n_times = dyn->N_times;  //the number of time points in every time series of data
-  const unsigned int n_params = dyn->Params_factor * n_s;      //the number of parameters to be calibrated
+  const unsigned int n_times = data.m_nObserved;  //the number of weeks of data
 
   unsigned int dim = n_s + 1;
   //set up lambda vector for loop, right now just one
@@ -82,29 +152,12 @@ double likelihoodRoutine(
   /*   phiPoints[j] = phis[n_times * j]; */
   /* } */
 
-  std::vector<double> timePoints(n_times,0.);
-  for (unsigned int i = 0; i < n_times; i++){
-    timePoints[i] = times[i];
-    // std::cout << "timePoints[i] = " << timePoints[i];
-  }
-
-  //return all times of C (cumulative cases)
-  std::vector<double> returnValues(n_times * dim, 0.);
-
   double misfitValue = 0.;
   double diff = 0.;
 
-  /* for (unsigned int i = 0; i < n_params; i++){  dyn->Deltas[i] = -std::exp(paramValues[i]); } */
-  for (unsigned int i = 0; i < n_params; i++){  
-      /* dyn->Deltas[i] = -std::abs(paramValues[i]); */ 
-      dyn->Deltas[i] = paramValues[i]; 
-      /* std::cout << "dyn->Deltas[i] = " << dyn->Deltas[i]<< "\n"; */
-  }
-  /* for (unsigned int i = 0; i < n_params; i++){  dyn->Deltas[i] = 0.; } */
-
   try
      {
-      zikaComputeModel(ics,timePoints,dyn,returnValues);
+      zikaComputeModel(ics,times,dyn,deltas,returnValues);
 //      std::cout << "Finished compute model" << std::endl;
       for (unsigned int j = 0; j < n_times; j++){
           //only have data for Y[7]
@@ -115,12 +168,160 @@ double likelihoodRoutine(
           /* std::cout << "misfit = " << misfitValue << "\n"; */
           /* count += 1; */
         }
-     } catch( int exception )
+     } catch( const zika_solve_failure & failure )
      {
-      misfitValue = 1000000;
+      return data.m_failureLogLikelihood;
    }
 
   /* std::cout << "likelihood count = " << count << "\n"; */
   /* std::cout << " the misfit is " << misfitValue << std::endl; */
   return (-0.5 * misfitValue);
 }
+
+//------------------------------------------------------
+// Log-likelihood that gives up once it cannot reach a threshold
+//------------------------------------------------------
+
+//running misfit of one bounded evaluation, fed week by week by the solve
+struct misfit_monitor
+{
+  const double * Csc;
+  double Var;
+  double MaxMisfit;
+  double Misfit;
+};
+
+//the misfit only grows with time: stop the solve once it exceeds the bound
+static bool zikaMisfitObserver(unsigned int i, const double Y[], void* context)
+{
+  misfit_monitor & m = *(misfit_monitor *) context;
+  const double diff = (Y[7] - m.Csc[i]);
+  m.Misfit += diff * diff / m.Var;
+  return m.Misfit <= m.MaxMisfit;
+}
+
+double zikaLogLikelihoodBounded(
+  const double*                 deltas,
+  const likelihoodRoutine_Data& data,
+  std::vector<double>&          returnValues,
+  double                        minLogLikelihood,
+  unsigned int&                 n_weeks)
+{
+  //same sum, in the same order, as zikaLogLikelihood. Below the failure
+  //penalty a partial misfit proves nothing: the solve may still fail and
+  //pass with the penalty
+  const double maxMisfit = (minLogLikelihood < data.m_failureLogLikelihood) ?
+    HUGE_VAL : -2. * minLogLikelihood;
+  misfit_monitor monitor = { &data.m_csc[0], data.m_var, maxMisfit, 0. };
+
+  try
+     {
+      n_weeks = zikaComputeModel(data.m_ics, data.m_observedTimes, data.m_dynMain, deltas,
+          returnValues, zikaMisfitObserver, &monitor);
+     } catch( const zika_solve_failure & failure )
+     {
+      //the MH test compares the penalty with its threshold, as it would
+      //after a full evaluation
+      n_weeks = data.m_nObserved;
+      return data.m_failureLogLikelihood;
+   }
+
+  return (-0.5 * monitor.Misfit);
+}
+
+//------------------------------------------------------
+// Log-likelihood with its gradient and Gauss-Newton hessian
+//------------------------------------------------------
+
+double zikaLogLikelihoodGradient(
+  const double*                 deltas,
+  const likelihoodRoutine_Data& data,
+  std::vector<double>&          returnValues,
+  std::vector<double>&          sensitivities,
+  double*                       gradient,
+  double*                       hessian)
+{
+  const std::vector<double>&  csc = data.m_csc;
+  const double var = data.m_var;
+  const dynamics_info *       dyn = data.m_dynMain;
+
+  const unsigned int n_times = data.m_nObserved;
+  const unsigned int dim = dyn->N_s + 1;
+  const unsigned int n_params = dyn->Params_factor * dyn->N_s;
+
+  double misfitValue = 0.;
+  for (unsigned int p = 0; p < n_params; p++) gradient[p] = 0.;
+  if (hessian) {
+    for (unsigned int k = 0; k < n_params * n_params; k++) hessian[k] = 0.;
+  }
+
+  try
+     {
+      zikaComputeSensitivities(data.m_ics, data.m_observedTimes, dyn, deltas,
+          returnValues, sensitivities);
+      for (unsigned int j = 0; j < n_times; j++){
+        //only have data for Y[7]
+        const double diff = (returnValues[dim * j + 7] - csc[j]);
+        const double * dC = &sensitivities[(dim * j + 7) * n_params];
+        misfitValue += diff * diff / var;
+        for (unsigned int p = 0; p < n_params; p++){
+          gradient[p] -= diff * dC[p] / var;
+        }
+        if (hessian) {
+          for (unsigned int p = 0; p < n_params; p++){
+            for (unsigned int q = 0; q < n_params; q++){
+              hessian[n_params * p + q] -= dC[p] * dC[q] / var;
+            }
+          }
+        }
+      }
+     } catch( const zika_solve_failure & failure )
+     {
+      for (unsigned int p = 0; p < n_params; p++) gradient[p] = 0.;
+      if (hessian) {
+        for (unsigned int k = 0; k < n_params * n_params; k++) hessian[k] = 0.;
+      }
+      return data.m_failureLogLikelihood;
+   }
+
+  return (-0.5 * misfitValue);
+}
+
+//------------------------------------------------------
+// Batched version of the likelihood routine
+//------------------------------------------------------
+
+void likelihoodRoutineBatch(
+  const std::vector<double>& paramValues,
+  unsigned int               n_samples,
+  const void*                functionDataPtr,
+  std::vector<double>&       logLikelihoods)
+{
+  likelihoodRoutine_Data * data = (likelihoodRoutine_Data *) functionDataPtr;
+  const std::vector<double>& csc = data->m_csc;
+  const double var = data->m_var;
+  dynamics_info * dyn = data->m_dynMain;
+
+  const unsigned int n_times = data->m_nObserved;
+  const unsigned int dim = dyn->N_s + 1;
+
+  zikaComputeEnsemble(data->m_ics, data->m_observedTimes, dyn, paramValues, n_samples,
+      data->m_batchValues, data->m_batchStatus);
+
+  logLikelihoods.resize(n_samples);
+  for (unsigned int s = 0; s < n_samples; s++){
+    const double * returnValues = &data->m_batchValues[s * n_times * dim];
+    double misfitValue = 0.;
+    if (data->m_batchStatus[s] == 0) {
+      for (unsigned int j = 0; j < n_times; j++){
+        const double diff = (returnValues[dim * j + 7] - csc[j]);
+        misfitValue += diff * diff / var;
+      }
+      logLikelihoods[s] = -0.5 * misfitValue;
+    }
+    else {
+      //same penalty as a failed scalar evaluation
+      logLikelihoods[s] = data->m_failureLogLikelihood;
+    }
+  }
+}
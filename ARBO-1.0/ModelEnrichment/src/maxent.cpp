@@ -0,0 +1,373 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the batched maximum entropy density estimator,
+ * the C++ counterpart of UncertaintyQuantification/maxent_lagrange_mc.m.
+ *-----------------------------------------------------------------*/
+
+#include "maxent.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//Constructor
+maxent_settings::maxent_settings()
+:
+  Moments(4),
+  Points(201),
+  Tolerance(1.e-9),
+  MaxIterations(100),
+  Padding(0.)
+{
+}
+
+//Destructor
+maxent_settings::~maxent_settings()
+{
+}
+
+//the support grid in t, shared by every problem: powers t_j^n for the
+//density (n < N) and trapezoid weights times t_j^n for its moments
+//(n < 2N - 1, those of the Hankel matrix)
+struct maxent_grid { maxent_grid(unsigned int n_moments, unsigned int n_points);
+ ~maxent_grid();
+
+  unsigned int N, K, Nx;
+  std::vector<double> powers;     //Nx x N
+  std::vector<double> weighted;   //Nx x K
+};
+
+//Constructor
+maxent_grid::maxent_grid(unsigned int n_moments, unsigned int n_points)
+: N(n_moments),
+  K(2 * n_moments - 1),
+  Nx(n_points),
+  powers(n_points * n_moments),
+  weighted(n_points * (2 * n_moments - 1))
+{
+  const double dt = 2. / (Nx - 1);
+  for (unsigned int j = 0; j < Nx; j++){
+    const double t = -1. + j * dt;
+    const double w = (j == 0 || j == Nx - 1) ? 0.5 * dt : dt;
+    double p = 1.;
+    for (unsigned int n = 0; n < K; n++){
+      if (n < N) powers[j * N + n] = p;
+      weighted[j * K + n] = w * p;
+      p *= t;
+    }
+  }
+}
+
+//Destructor
+maxent_grid::~maxent_grid()
+{
+}
+
+#define L __ZIKA_MAXENT_BATCH
+
+//moments G_n, n < orders, of the L densities exp(-sum_n lambda_n t^n) of
+//a batch (lambda and G laid out order by order, lanes inside)
+static void zikaMaxEntMoments(const maxent_grid& grid, const double* lambda,
+    unsigned int orders, double* pdf, double* G)
+{
+  const unsigned int N = grid.N, K = grid.K;
+  for (unsigned int j = 0; j < grid.Nx; j++){
+    double e[L];
+    for (unsigned int v = 0; v < L; v++) e[v] = 0.;
+    for (unsigned int n = 0; n < N; n++){
+      const double p = grid.powers[j * N + n];
+      for (unsigned int v = 0; v < L; v++) e[v] += p * lambda[n * L + v];
+    }
+    for (unsigned int v = 0; v < L; v++) pdf[j * L + v] = std::exp(-e[v]);
+  }
+  for (unsigned int n = 0; n < orders * L; n++) G[n] = 0.;
+  for (unsigned int j = 0; j < grid.Nx; j++){
+    for (unsigned int n = 0; n < orders; n++){
+      const double w = grid.weighted[j * K + n];
+      for (unsigned int v = 0; v < L; v++) G[n * L + v] += w * pdf[j * L + v];
+    }
+  }
+}
+
+//solves H x = b in place for the N x N Hankel matrix H_ik = G_{i+k} of lane
+//v (symmetric positive definite, Cholesky); false if it is not numerically
+static bool zikaMaxEntNewton(const double* G, unsigned int v, unsigned int N, double* b, double* H)
+{
+  for (unsigned int i = 0; i < N; i++){
+    for (unsigned int k = 0; k < N; k++) H[i * N + k] = G[(i + k) * L + v];
+  }
+  for (unsigned int k = 0; k < N; k++){
+    double d = H[k * N + k];
+    for (unsigned int m = 0; m < k; m++) d -= H[k * N + m] * H[k * N + m];
+    if (!(d > 0.)) return false;
+    H[k * N + k] = std::sqrt(d);
+    for (unsigned int i = k + 1; i < N; i++){
+      double s = H[i * N + k];
+      for (unsigned int m = 0; m < k; m++) s -= H[i * N + m] * H[k * N + m];
+      H[i * N + k] = s / H[k * N + k];
+    }
+  }
+  for (unsigned int i = 0; i < N; i++){
+    for (unsigned int m = 0; m < i; m++) b[i] -= H[i * N + m] * b[m];
+    b[i] /= H[i * N + i];
+  }
+  for (int i = N - 1; i >= 0; i--){
+    for (unsigned int m = i + 1; m < N; m++) b[i] -= H[m * N + i] * b[m];
+    b[i] /= H[i * N + i];
+  }
+  return true;
+}
+
+//solves the L problems of a batch, of moments mu in t (order by order,
+//lanes inside; lanes past n_active are padding), and fills out[v]
+static void zikaMaxEntBatch(const maxent_grid& grid, const maxent_settings& settings,
+    const double* mu, unsigned int n_active, maxent_density** out)
+{
+  const unsigned int N = grid.N, K = grid.K;
+  std::vector<double> pdf(grid.Nx * L);
+  std::vector<double> lambda(N * L, 0.), trial(N * L), step(N * L, 0.), G(K * L), G0(L);
+  std::vector<double> b(N), H(N * N);
+  double dual[L], scale[L];
+  bool done[L], converged[L], accepted[L];
+  unsigned int iterations[L];
+  for (unsigned int v = 0; v < L; v++){
+    lambda[v] = std::log(2.);   //uniform on [-1, 1], as lambda0 in the MATLAB code
+    done[v] = (v >= n_active);
+    converged[v] = false;
+    iterations[v] = 0;
+  }
+
+  zikaMaxEntMoments(grid, &lambda[0], K, &pdf[0], &G[0]);
+  for (unsigned int v = 0; v < L; v++){
+    dual[v] = G[v];
+    for (unsigned int n = 0; n < N; n++) dual[v] += lambda[n * L + v] * mu[n * L + v];
+  }
+
+  for (unsigned int it = 0; it < settings.MaxIterations; it++){
+    //Newton directions, H step = G - mu, of the lanes still going
+    bool any = false;
+    for (unsigned int v = 0; v < L; v++){
+      if (done[v]) continue;
+      double worst = 0.;
+      for (unsigned int n = 0; n < N; n++){
+        b[n] = G[n * L + v] - mu[n * L + v];
+        worst = std::max(worst, std::fabs(b[n]));
+      }
+      if (worst < settings.Tolerance) {
+        done[v] = converged[v] = true;
+        continue;
+      }
+      if (!zikaMaxEntNewton(&G[0], v, N, &b[0], &H[0])) {
+        done[v] = true;
+        continue;
+      }
+      for (unsigned int n = 0; n < N; n++) step[n * L + v] = b[n];
+      scale[v] = 1.;
+      accepted[v] = false;
+      any = true;
+    }
+    if (!any) break;
+
+    //halve the steps of every lane whose dual objective does not decrease
+    for (unsigned int halving = 0; halving < 40; halving++){
+      for (unsigned int n = 0; n < N * L; n++){
+        const unsigned int v = n % L;
+        trial[n] = (done[v] || accepted[v]) ? lambda[n] : lambda[n] + scale[v] * step[n];
+      }
+      zikaMaxEntMoments(grid, &trial[0], 1, &pdf[0], &G0[0]);
+      bool pending = false;
+      for (unsigned int v = 0; v < L; v++){
+        if (done[v] || accepted[v]) continue;
+        double value = G0[v];
+        for (unsigned int n = 0; n < N; n++) value += trial[n * L + v] * mu[n * L + v];
+        if (std::isfinite(value) && value <= dual[v]) {
+          accepted[v] = true;
+          dual[v] = value;
+          for (unsigned int n = 0; n < N; n++) lambda[n * L + v] = trial[n * L + v];
+        }
+        else {
+          scale[v] *= 0.5;
+          pending = true;
+        }
+      }
+      if (!pending) break;
+    }
+
+    for (unsigned int v = 0; v < L; v++){
+      if (done[v]) continue;
+      iterations[v]++;
+      if (!accepted[v]) {
+        //no decrease along the Newton direction: as good as it gets
+        done[v] = true;
+        continue;
+      }
+      //relative step, the test of the MATLAB code
+      double worst = 0.;
+      for (unsigned int n = 0; n < N; n++){
+        const double l = std::fabs(lambda[n * L + v]);
+        if (l > 0.) worst = std::max(worst, std::fabs(scale[v] * step[n * L + v]) / l);
+      }
+      if (worst < settings.Tolerance) done[v] = converged[v] = true;
+    }
+    zikaMaxEntMoments(grid, &lambda[0], K, &pdf[0], &G[0]);
+  }
+
+  zikaMaxEntMoments(grid, &lambda[0], K, &pdf[0], &G[0]);
+  for (unsigned int v = 0; v < n_active; v++){
+    maxent_density & d = *out[v];
+    const double jacobian = 2. / (d.XMax - d.XMin);   //dt/dx
+    d.Lambda.resize(N);
+    d.Pdf.resize(grid.Nx);
+    double entropy = 0.;
+    for (unsigned int n = 0; n < N; n++){
+      d.Lambda[n] = lambda[n * L + v];
+      entropy += lambda[n * L + v] * G[n * L + v];
+    }
+    for (unsigned int j = 0; j < grid.Nx; j++) d.Pdf[j] = pdf[j * L + v] * jacobian;
+    d.Entropy = entropy - std::log(jacobian);
+    d.Iterations = iterations[v];
+    d.Converged = converged[v];
+    d.Degenerate = false;
+  }
+}
+
+//moments in t of the uniform density on [-1, 1], for the padding lanes
+static double zikaUniformMoment(unsigned int n)
+{
+  return (n % 2) ? 0. : 1. / (n + 1);
+}
+
+//a variable without spread: a point mass at x
+static void zikaMaxEntPointMass(maxent_density& d, double x, const maxent_settings& settings)
+{
+  d.XMin = d.XMax = x;
+  d.Lambda.assign(settings.Moments, 0.);
+  d.Pdf.assign(settings.Points, 0.);
+  d.Entropy = -std::numeric_limits<double>::infinity();
+  d.Iterations = 0;
+  d.Converged = false;
+  d.Degenerate = true;
+}
+
+//solves the problems whose t moments are tMoments (Moments per variable)
+//and supports are set in densities; point masses are skipped
+static void zikaMaxEntSolveAll(const std::vector<double>& tMoments,
+    const maxent_settings& settings, std::vector<maxent_density>& densities)
+{
+  const unsigned int n_vars = densities.size();
+  const unsigned int N = std::max(settings.Moments, 1u);
+  const maxent_grid grid(N, std::max(settings.Points, 2u));
+  //the variables to solve, point masses left out
+  std::vector<unsigned int> todo;
+  for (unsigned int v = 0; v < n_vars; v++){
+    if (!densities[v].Degenerate) todo.push_back(v);
+  }
+  const int n_batches = (todo.size() + L - 1) / L;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int b = 0; b < n_batches; b++){
+    const unsigned int first = b * L;
+    const unsigned int n_active = std::min((unsigned int) L, (unsigned int) todo.size() - first);
+    std::vector<double> mu(N * L);
+    maxent_density * out[L];
+    for (unsigned int v = 0; v < L; v++){
+      for (unsigned int n = 0; n < N; n++){
+        mu[n * L + v] = (v < n_active) ? tMoments[todo[first + v] * N + n] : zikaUniformMoment(n);
+      }
+      out[v] = (v < n_active) ? &densities[todo[first + v]] : NULL;
+    }
+    zikaMaxEntBatch(grid, settings, &mu[0], n_active, out);
+  }
+}
+
+void zikaMaxEntDensities(
+  const double*                   samples,
+  size_t                          n_samples,
+  unsigned int                    n_vars,
+  size_t                          sampleStride,
+  size_t                          varStride,
+  const maxent_settings&          settings,
+  std::vector<maxent_density>&    densities)
+{
+  const unsigned int N = std::max(settings.Moments, 1u);
+  densities.resize(n_vars);
+  std::vector<double> tMoments(n_vars * N, 0.);
+
+  //support and moments in t, one variable per thread at a time
+  #pragma omp parallel for schedule(dynamic)
+  for (int v = 0; v < (int) n_vars; v++){
+    const double * x = samples + v * varStride;
+    double lo = std::numeric_limits<double>::infinity(), hi = -lo;
+    size_t count = 0;
+    for (size_t s = 0; s < n_samples; s++){
+      const double value = x[s * sampleStride];
+      if (!std::isfinite(value)) continue;
+      lo = std::min(lo, value);
+      hi = std::max(hi, value);
+      count++;
+    }
+    maxent_density & d = densities[v];
+    if (count == 0 || !(hi > lo)) {
+      zikaMaxEntPointMass(d, count ? lo : std::numeric_limits<double>::quiet_NaN(), settings);
+      continue;
+    }
+    const double pad = settings.Padding * (hi - lo);
+    d.XMin = lo - pad;
+    d.XMax = hi + pad;
+    d.Degenerate = false;
+    const double a = 2. / (d.XMax - d.XMin), b = -(d.XMax + d.XMin) / (d.XMax - d.XMin);
+    double * mu = &tMoments[v * N];
+    for (size_t s = 0; s < n_samples; s++){
+      const double value = x[s * sampleStride];
+      if (!std::isfinite(value)) continue;
+      const double t = a * value + b;
+      double p = 1.;
+      for (unsigned int n = 0; n < N; n++){
+        mu[n] += p;
+        p *= t;
+      }
+    }
+    for (unsigned int n = 0; n < N; n++) mu[n] /= count;
+  }
+
+  zikaMaxEntSolveAll(tMoments, settings, densities);
+}
+
+void zikaMaxEntFromMoments(
+  const double*                   xMin,
+  const double*                   xMax,
+  const double*                   moments,
+  unsigned int                    n_vars,
+  const maxent_settings&          settings,
+  std::vector<maxent_density>&    densities)
+{
+  const unsigned int N = std::max(settings.Moments, 1u);
+  densities.resize(n_vars);
+  std::vector<double> tMoments(n_vars * N, 0.);
+  for (unsigned int v = 0; v < n_vars; v++){
+    maxent_density & d = densities[v];
+    if (!(xMax[v] > xMin[v])) {
+      zikaMaxEntPointMass(d, xMin[v], settings);
+      continue;
+    }
+    d.XMin = xMin[v];
+    d.XMax = xMax[v];
+    d.Degenerate = false;
+    //E[t^n] = sum_k C(n,k) a^k b^(n-k) E[x^k], t = a x + b
+    const double a = 2. / (d.XMax - d.XMin), b = -(d.XMax + d.XMin) / (d.XMax - d.XMin);
+    for (unsigned int n = 0; n < N; n++){
+      double binomial = 1., sum = 0.;
+      for (unsigned int k = 0; k <= n; k++){
+        sum += binomial * std::pow(a, (double) k) * std::pow(b, (double) (n - k)) * moments[v * N + k];
+        binomial = binomial * (n - k) / (k + 1);
+      }
+      tMoments[v * N + n] = sum;
+    }
+  }
+
+  zikaMaxEntSolveAll(tMoments, settings, densities);
+}
@@ -0,0 +1,724 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ * 
+ * This file contains the code for the in-process Metropolis-Hastings
+ * samplers: independent chains on threads, and a tempered DE-MC
+ * population spread over the MPI processes.
+ *-----------------------------------------------------------------*/
+
+#include "mcmc.h"
+#include "dynamics_info.h"
+#include "surrogate.h"
+#include "binfile.h"
+#include "diagnostics.h"
+#include "philox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sys/stat.h>
+
+//Constructor
+mcmc_settings::mcmc_settings()
+:
+  NChains(1),
+  ChainLength(10000),
+  ProposalStd(0.01),
+  FilterLag(20),
+  Seed(1),
+  MaxTemp(10.),
+  ExchangeInterval(10),
+  Langevin(0),
+  EarlyStop(1),
+  DelayedAcceptance(0),
+  SurrogateInterval(300),
+  BinaryOutput(0),
+  RepFactor(1.),
+  DiagnosticsPeriod(100),
+  TargetEss(0.),
+  TargetRhat(1.01)
+{
+}
+
+//Destructor
+mcmc_settings::~mcmc_settings()
+{
+}
+
+//Philox streams of the population sampler on process r (the sample of
+//zika_philox): the archive cloud and the swaps, and the proposals and MH
+//tests of the chain at temperature t
+#define __ZIKA_POP_SHARED_STREAM 0
+#define __ZIKA_POP_CHAIN_STREAM(t) (1 + (t))
+
+//bound on the log-ratio of the surrogate in the first stage of delayed
+//acceptance. Any bound keeps the exact posterior; without one, a
+//surrogate far too curved away from its anchor (the Gauss-Newton hessian
+//of a nonlinear model) screens out every move into the tails, and the
+//chains never reach them. With it the acceptance of a move is at least
+//exp(-1) of that of plain MH
+#define __ZIKA_MAX_SCREEN 1.
+
+//writes rows x cols values as 'name = zeros(rows,cols); name = [...];',
+//the layout of QUESO's .m outputs read by postprocessing/
+static void writeMatlabMatrix(const char* fileName, const char* name,
+    const std::vector<double>& values, unsigned int rows, unsigned int cols)
+{
+  FILE *file = fopen(fileName,"w");
+  if (!file) {
+    printf("WARNING: could not open %s\n", fileName);
+    return;
+  }
+  fprintf(file,"%s = zeros(%u,%u);\n", name, rows, cols);
+  fprintf(file,"%s = [", name);
+  for (unsigned int r = 0; r < rows; r++){
+    for (unsigned int c = 0; c < cols; c++){
+      fprintf(file,"%.16e ", values[r * cols + c]);
+    }
+    fprintf(file,"\n");
+  }
+  fprintf(file,"];\n");
+  fclose(file);
+}
+
+//with settings.BinaryOutput, the raw and filtered chains of every process
+//as they are sampled: each finished segment of positions is gathered on
+//process 0 and appended to outputData/sip_raw_chain.zbin and
+//sip_filtered_chain.zbin, so that a run that stops midway leaves the
+//positions up to its last finished segment on disk. The rows of a segment are the
+//chains of process 0, then of process 1, ..., each for the positions of
+//the segment; the last two columns are the log-target (log-likelihood in
+//the filtered file) and the index of the chain over all processes
+struct chain_output { chain_output(const QUESO::FullEnvironment& env, unsigned int n_chains,
+    unsigned int length, unsigned int n_params, unsigned int lag, const mcmc_settings& settings,
+    const dynamics_info& dyn)
+: m_comm(env.fullComm().Comm()), m_rank(env.fullRank()), m_procs(env.fullComm().NumProc()),
+  m_chains(n_chains), m_length(length), m_params(n_params), m_lag(lag),
+  m_written(0), m_raw(NULL), m_filtered(NULL)
+{
+  if (!settings.BinaryOutput || m_rank != 0) return;
+  mkdir("outputData", 0755);
+  std::vector<std::string> names = zikaParamNames(n_params, "log_target");
+  names.push_back("chain");
+  m_raw = new zika_bin_writer("outputData/sip_raw_chain.zbin", names,
+      m_procs * n_chains * length, dyn.N_times, dyn.N_s + 1, settings.RepFactor);
+  //uniform prior: the log-target is the log-likelihood up to a constant
+  names[n_params] = "log_likelihood";
+  m_filtered = new zika_bin_writer("outputData/sip_filtered_chain.zbin", names,
+      m_procs * n_chains * ((length + lag - 1) / lag), dyn.N_times, dyn.N_s + 1,
+      settings.RepFactor);
+}
+ ~chain_output() { delete m_raw; delete m_filtered; }
+
+  //appends positions [m_written, end) of the n_chains local chains, chain c
+  //from rawChain[c * length * n_params]; collective over the processes
+  //when the chains are written, a no-op otherwise
+  void append(const mcmc_settings& settings, const std::vector<double>& rawChain,
+      const std::vector<double>& rawLogTarget, unsigned int end)
+  {
+    if (!settings.BinaryOutput || end <= m_written) return;
+    append(m_raw, "outputData/sip_raw_chain.zbin", rawChain, rawLogTarget, m_written, end, 1);
+    append(m_filtered, "outputData/sip_filtered_chain.zbin", rawChain, rawLogTarget,
+        m_written, end, m_lag);
+    m_written = end;
+  }
+
+private:
+  //positions of [first, end) that are multiples of step
+  void append(zika_bin_writer* writer, const char* fileName,
+      const std::vector<double>& rawChain, const std::vector<double>& rawLogTarget,
+      unsigned int first, unsigned int end, unsigned int step)
+  {
+    const unsigned int width = m_params + 2;
+    std::vector<double> local;
+    for (unsigned int c = 0; c < m_chains; c++){
+      for (unsigned int k = (first + step - 1) / step * step; k < end; k += step){
+        const double * position = &rawChain[(c * m_length + k) * m_params];
+        local.insert(local.end(), position, position + m_params);
+        local.push_back(rawLogTarget[c * m_length + k]);
+        local.push_back(m_rank * m_chains + c);
+      }
+    }
+    //every process has as many chains and positions
+    if (local.empty()) return;
+    std::vector<double> all(m_rank == 0 ? m_procs * local.size() : 0);
+    MPI_Gather(&local[0], local.size(), MPI_DOUBLE, m_rank == 0 ? &all[0] : NULL,
+               local.size(), MPI_DOUBLE, 0, m_comm);
+    if (m_rank == 0 && writer->ok() && !writer->append(&all[0], all.size() / width)) {
+      printf("WARNING: could not write %s\n", fileName);
+    }
+  }
+
+  MPI_Comm        m_comm;
+  unsigned int    m_rank, m_procs;
+  unsigned int    m_chains, m_length, m_params, m_lag;
+  unsigned int    m_written;    //positions of every chain appended so far
+  zika_bin_writer * m_raw;
+  zika_bin_writer * m_filtered;
+};
+
+//keeps positions 0, lag, 2*lag, ... of the n_chains local chains in
+//filteredChain; unless they went to chain_output, gathers the chains of
+//every process on process 0 and writes them there as .m files, one chain
+//after the other
+static void mergeChains(
+  const QUESO::FullEnvironment& env,
+  const std::vector<double>&    rawChain,
+  const std::vector<double>&    rawLogTarget,
+  unsigned int                  n_chains,
+  unsigned int                  length,
+  unsigned int                  n_params,
+  unsigned int                  lag,
+  const mcmc_settings&          settings,
+  std::vector<double>&          filteredChain)
+{
+  const unsigned int n_filtered = (length + lag - 1) / lag;
+  const unsigned int rank = env.fullRank();
+  const unsigned int n_procs = env.fullComm().NumProc();
+
+  filteredChain.resize(n_chains * n_filtered * n_params);
+  std::vector<double> filteredLogTarget(n_chains * n_filtered, 0.);
+  for (unsigned int c = 0; c < n_chains; c++){
+    for (unsigned int f = 0; f < n_filtered; f++){
+      const unsigned int k = c * length + f * lag;
+      std::copy(&rawChain[k * n_params], &rawChain[k * n_params] + n_params,
+                &filteredChain[(c * n_filtered + f) * n_params]);
+      filteredLogTarget[c * n_filtered + f] = rawLogTarget[k];
+    }
+  }
+  if (settings.BinaryOutput) return;
+
+  std::vector<double> allRaw, allRawLogTarget, allFiltered, allFilteredLogTarget;
+  if (rank == 0) {
+    allRaw.resize(n_procs * rawChain.size());
+    allRawLogTarget.resize(n_procs * rawLogTarget.size());
+    allFiltered.resize(n_procs * filteredChain.size());
+    allFilteredLogTarget.resize(n_procs * filteredLogTarget.size());
+  }
+  MPI_Comm comm = env.fullComm().Comm();
+  MPI_Gather(const_cast<double*>(&rawChain[0]), rawChain.size(), MPI_DOUBLE,
+             rank == 0 ? &allRaw[0] : NULL, rawChain.size(), MPI_DOUBLE, 0, comm);
+  MPI_Gather(const_cast<double*>(&rawLogTarget[0]), rawLogTarget.size(), MPI_DOUBLE,
+             rank == 0 ? &allRawLogTarget[0] : NULL, rawLogTarget.size(), MPI_DOUBLE, 0, comm);
+  MPI_Gather(&filteredChain[0], filteredChain.size(), MPI_DOUBLE,
+             rank == 0 ? &allFiltered[0] : NULL, filteredChain.size(), MPI_DOUBLE, 0, comm);
+  MPI_Gather(&filteredLogTarget[0], filteredLogTarget.size(), MPI_DOUBLE,
+             rank == 0 ? &allFilteredLogTarget[0] : NULL, filteredLogTarget.size(), MPI_DOUBLE, 0, comm);
+
+  if (rank == 0) {
+    const unsigned int n_raw = n_procs * n_chains * length;
+    const unsigned int n_filt = n_procs * n_chains * n_filtered;
+    mkdir("outputData", 0755);
+    writeMatlabMatrix("outputData/sip_raw_chain.m", "ip_mh_rawChain_unified",
+        allRaw, n_raw, n_params);
+    writeMatlabMatrix("outputData/sip_raw_chain_logtarget.m", "ip_mh_rawLogTarget_unified",
+        allRawLogTarget, n_raw, 1);
+    writeMatlabMatrix("outputData/sip_filtered_chain.m", "ip_mh_filtChain_unified",
+        allFiltered, n_filt, n_params);
+    //uniform prior: the log-likelihood is the log-target up to a constant
+    writeMatlabMatrix("outputData/sip_filtered_chain_loglikelihood.m", "ip_mh_filtLogLikelihood_unified",
+        allFilteredLogTarget, n_filt, 1);
+  }
+}
+
+//state of one chain of zikaSolveThreadedMH, with its own RNG and scratch
+struct mh_chain { mh_chain(unsigned int seed, unsigned int rank, unsigned int c, double stepStd,
+    unsigned int n_params, unsigned int n_qoi, unsigned int n_sens, bool delayed,
+    unsigned int firstInterval)
+: rng(seed, rank, __ZIKA_MH_CHAIN_STREAM(c)), eps(stepStd),
+  returnValues(n_qoi, 0.), sensitivities(n_sens),
+  //two zero entries past the deltas, read by the inad_type 3 kernel
+  candidate(n_params + 2, 0.),
+  gradient(n_params, 0.), candidateGradient(n_params, 0.),
+  surrogate(n_params), hessian(delayed ? n_params * n_params : 0),
+  nextExpansion(0), interval(firstInterval), current(0.)
+{
+}
+
+  zika_philox rng;
+  double eps;         //std of the random walk
+  std::vector<double> returnValues;
+  std::vector<double> sensitivities;
+  std::vector<double> candidate;
+  std::vector<double> gradient, candidateGradient;
+  //delayed acceptance: surrogate of this chain, expanded around its
+  //position at step 0, SurrogateInterval, then at intervals that double
+  //(only at step 0 if SurrogateInterval is 0)
+  quadratic_surrogate surrogate;
+  std::vector<double> hessian;
+  unsigned int nextExpansion, interval;
+  double current;     //log-likelihood at the last position
+};
+
+//gathers the diagnostics of the chains of every process, writes them to
+//outputData/sip_mcmc_status.txt from process 0 and returns whether the
+//stopping rule is met, the same answer on every process
+static bool checkConvergence(
+  const QUESO::FullEnvironment& env,
+  const chain_diagnostics&      diagnostics,
+  unsigned int                  step,
+  unsigned int                  length,
+  const mcmc_settings&          settings)
+{
+  const unsigned int rank = env.fullRank();
+  const unsigned int n_procs = env.fullComm().NumProc();
+  const unsigned int n_chains = diagnostics.chains();
+  const unsigned int n_params = diagnostics.params();
+  std::vector<double> local, packed(n_procs * n_chains * n_params * __ZIKA_DIAG_FIELDS);
+  diagnostics.pack(local);
+  //every process holds as many chains, and works the combination out
+  MPI_Allgather(&local[0], local.size(), MPI_DOUBLE, &packed[0], local.size(), MPI_DOUBLE,
+      env.fullComm().Comm());
+  chain_report report;
+  zikaCombineDiagnostics(packed, n_procs * n_chains, n_params, report);
+
+  int stop = (settings.TargetEss > 0. && report.MinEss >= settings.TargetEss &&
+              report.MaxRhat <= settings.TargetRhat) ? 1 : 0;
+  if (rank == 0) {
+    mkdir("outputData", 0755);
+    zikaWriteDiagnostics("outputData/sip_mcmc_status.txt", report, n_procs * n_chains,
+        step, length, settings.TargetEss, settings.TargetRhat);
+    std::cout << "  " << step << " positions per chain: min ESS " << report.MinEss
+              << ", max split R-hat " << report.MaxRhat << std::endl;
+  }
+  //decided by process 0 alone, the others could round differently
+  MPI_Bcast(&stop, 1, MPI_INT, 0, env.fullComm().Comm());
+  return stop != 0;
+}
+
+void zikaSolveThreadedMH(
+  const QUESO::FullEnvironment& env,
+  const likelihoodRoutine_Data& data,
+  const std::vector<double>&    paramMin,
+  const std::vector<double>&    paramMax,
+  const std::vector<double>&    paramInitials,
+  const mcmc_settings&          settings,
+  std::vector<double>&          filteredChain)
+{
+  const dynamics_info * dyn = data.m_dynMain;
+  const unsigned int n_params = paramInitials.size();
+  const unsigned int n_chains = settings.NChains;
+  const unsigned int length = settings.ChainLength;
+  const unsigned int lag = settings.FilterLag > 0 ? settings.FilterLag : 1;
+  const unsigned int rank = env.fullRank();
+  const unsigned int n_procs = env.fullComm().NumProc();
+
+  //every chain writes its own slice, nothing is shared between threads
+  //but these outputs and the read-only likelihood data
+  std::vector<double> rawChain(n_chains * length * n_params, 0.);
+  std::vector<double> rawLogTarget(n_chains * length, 0.);
+  std::vector<unsigned int> accepted(n_chains, 0);
+  //weeks integrated and proposals evaluated, per chain
+  std::vector<double> weeks(n_chains, 0.), evaluations(n_chains, 0.);
+  //proposals inside the box, and those the surrogate screened out
+  std::vector<double> proposals(n_chains, 0.), screenedOut(n_chains, 0.);
+
+  const bool langevin = settings.Langevin && dyn->SensRhs;
+  if (settings.Langevin && !langevin && rank == 0) {
+    std::cout << "WARNING: no sensitivity kernel for this model, "
+              << "MALA falls back to a random walk" << std::endl;
+  }
+  //MALA drift 0.5 eps^2 grad, with eps the proposal std
+  const double eps = settings.ProposalStd;
+  const double drift = langevin ? 0.5 * eps * eps : 0.;
+  const bool delayed = settings.DelayedAcceptance && dyn->SensRhs && !langevin;
+  if (settings.DelayedAcceptance && !delayed && rank == 0) {
+    std::cout << "WARNING: no sensitivity kernel for this model, "
+              << "delayed acceptance falls back to plain MH" << std::endl;
+  }
+
+  //state of every chain, kept between the segments of DiagnosticsPeriod
+  //steps that the chains are run in
+  std::vector<mh_chain> chains;
+  chains.reserve(n_chains);
+  for (unsigned int c = 0; c < n_chains; c++){
+    chains.push_back(mh_chain(settings.Seed, rank, c, eps, n_params,
+        dyn->N_times * (dyn->N_s + 1), langevin || delayed ? data.m_sensitivities.size() : 0,
+        delayed, settings.SurrogateInterval));
+  }
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int c = 0; c < (int) n_chains; c++){
+    mh_chain & m = chains[c];
+    double * chain = &rawChain[c * length * n_params];
+    std::copy(paramInitials.begin(), paramInitials.end(), chain);
+    std::copy(paramInitials.begin(), paramInitials.end(), m.candidate.begin());
+    m.current = langevin ?
+      zikaLogLikelihoodGradient(&m.candidate[0], data, m.returnValues, m.sensitivities,
+          &m.gradient[0], NULL) :
+      zikaLogLikelihood(&m.candidate[0], data, m.returnValues);
+    rawLogTarget[c * length] = m.current;
+  }
+
+  chain_diagnostics diagnostics(n_chains, n_params);
+  chain_output output(env, n_chains, length, n_params, lag, settings, *dyn);
+  const unsigned int period = settings.DiagnosticsPeriod ? settings.DiagnosticsPeriod : length;
+  unsigned int done = 1;      //positions in every chain
+  while (done < length) {
+    const unsigned int end = std::min(done + period, length);
+    #pragma omp parallel for schedule(dynamic)
+    for (int c = 0; c < (int) n_chains; c++){
+      mh_chain & m = chains[c];
+      std::vector<double> & candidate = m.candidate;
+      double * chain = &rawChain[c * length * n_params];
+      double * logTarget = &rawLogTarget[c * length];
+
+      for (unsigned int k = done; k < end; k++){
+        const double * position = chain + (k - 1) * n_params;
+        if (delayed && k - 1 == m.nextExpansion) {
+          std::copy(position, position + n_params, candidate.begin());
+          const double value = zikaLogLikelihoodGradient(&candidate[0], data, m.returnValues,
+              m.sensitivities, &m.gradient[0], &m.hessian[0]);
+          m.surrogate.expand(position, value, &m.gradient[0], &m.hessian[0]);
+          m.nextExpansion = m.interval ? m.nextExpansion + m.interval : length;
+          m.interval = m.nextExpansion;
+          //the expansion is a solve of its own, charged to the savings
+          screenedOut[c] -= 1.;
+        }
+        bool inside = true;
+        for (unsigned int i = 0; i < n_params; i++){
+          candidate[i] = position[i] + drift * m.gradient[i] + m.eps * m.rng.normal();
+          if (candidate[i] < paramMin[i] || candidate[i] > paramMax[i]) inside = false;
+        }
+        //uniform prior: a candidate outside the box is always rejected
+        bool accept = false;
+        double proposed = 0.;
+        if (inside && langevin) {
+          proposed = zikaLogLikelihoodGradient(&candidate[0], data, m.returnValues,
+              m.sensitivities, &m.candidateGradient[0], NULL);
+          //log q(position | candidate) - log q(candidate | position)
+          double logRatio = 0.;
+          for (unsigned int i = 0; i < n_params; i++){
+            const double back = position[i] - candidate[i] - drift * m.candidateGradient[i];
+            const double forth = candidate[i] - position[i] - drift * m.gradient[i];
+            logRatio -= (back * back - forth * forth) / (2. * eps * eps);
+          }
+          accept = (std::log(m.rng.uniform()) < proposed - m.current + logRatio);
+        }
+        else if (inside) {
+          proposals[c] += 1.;
+          //delayed acceptance, first stage: MH test on the surrogate, only
+          //the candidates that pass it are solved
+          double screen = 0.;
+          bool pass = true;
+          if (delayed && m.surrogate.ready()) {
+            screen = m.surrogate.predict(&candidate[0]) - m.surrogate.predict(position);
+            screen = std::max(-__ZIKA_MAX_SCREEN, std::min(__ZIKA_MAX_SCREEN, screen));
+            pass = (std::log(m.rng.uniform()) < screen);
+            if (!pass) screenedOut[c] += 1.;
+          }
+          if (pass) {
+            //second stage (or plain MH): accept with exp(dL - screen). Draw
+            //first, the solve can stop as soon as the proposal is rejected
+            const double threshold = m.current + screen + std::log(m.rng.uniform());
+            unsigned int n_weeks = data.m_nObserved;
+            if (settings.EarlyStop) {
+              proposed = zikaLogLikelihoodBounded(&candidate[0], data, m.returnValues,
+                  threshold, n_weeks);
+            }
+            else {
+              proposed = zikaLogLikelihood(&candidate[0], data, m.returnValues);
+            }
+            accept = (proposed > threshold);
+            weeks[c] += n_weeks;
+            evaluations[c] += 1.;
+          }
+        }
+        if (accept) {
+          std::copy(candidate.begin(), candidate.begin() + n_params, chain + k * n_params);
+          m.current = proposed;
+          m.gradient.swap(m.candidateGradient);
+          accepted[c]++;
+        }
+        else {
+          std::copy(position, position + n_params, chain + k * n_params);
+        }
+        logTarget[k] = m.current;
+      }
+      if (settings.DiagnosticsPeriod) diagnostics.update(c, chain, end);
+    }
+    done = end;
+    output.append(settings, rawChain, rawLogTarget, done);
+    if (settings.DiagnosticsPeriod && checkConvergence(env, diagnostics, done, length, settings)) {
+      break;
+    }
+  }
+
+  if (done < length) {
+    //stopped on the ESS target: pack the chains to their first 'done' positions
+    for (unsigned int c = 1; c < n_chains; c++){
+      std::copy(&rawChain[c * length * n_params], &rawChain[(c * length + done) * n_params],
+                &rawChain[c * done * n_params]);
+      std::copy(&rawLogTarget[c * length], &rawLogTarget[c * length + done],
+                &rawLogTarget[c * done]);
+    }
+    rawChain.resize(n_chains * done * n_params);
+    rawLogTarget.resize(n_chains * done);
+    if (rank == 0) {
+      std::cout << "ESS target " << settings.TargetEss << " reached after " << done
+                << " of " << length << " positions per chain" << std::endl;
+    }
+  }
+
+  mergeChains(env, rawChain, rawLogTarget, n_chains, done, n_params, lag,
+      settings, filteredChain);
+
+  unsigned int n_accepted = 0;
+  double counts[4] = { 0., 0., 0., 0. }, countsAll[4] = { 0., 0., 0., 0. };
+  for (unsigned int c = 0; c < n_chains; c++){
+    n_accepted += accepted[c];
+    counts[0] += weeks[c];
+    counts[1] += evaluations[c];
+    counts[2] += proposals[c];
+    counts[3] += screenedOut[c];
+  }
+  unsigned int n_acceptedAll = 0;
+  MPI_Reduce(&n_accepted, &n_acceptedAll, 1, MPI_UNSIGNED, MPI_SUM, 0,
+      env.fullComm().Comm());
+  MPI_Reduce(counts, countsAll, 4, MPI_DOUBLE, MPI_SUM, 0, env.fullComm().Comm());
+
+  if (rank == 0) {
+    std::cout << (langevin ? "Threaded MALA: " : delayed ? "Threaded delayed-acceptance MH: " : "Threaded MH: ") << n_procs * n_chains << " chains of " << done
+              << " positions, acceptance rate "
+              << (double) n_acceptedAll / (n_procs * n_chains * std::max(done - 1, 1u));
+    if (countsAll[1] > 0.) {
+      std::cout << "\n  weeks integrated per proposal " << countsAll[0] / countsAll[1]
+                << " of " << data.m_nObserved;
+    }
+    if (delayed && countsAll[2] > 0.) {
+      std::cout << "\n  full solves avoided by the surrogate "
+                << 100. * countsAll[3] / countsAll[2] << "% of "
+                << countsAll[2] << " proposals";
+    }
+    std::cout << std::endl << std::endl;
+  }
+}
+
+void zikaSolvePopulation(
+  const QUESO::FullEnvironment& env,
+  const likelihoodRoutine_Data& data,
+  const std::vector<double>&    paramMin,
+  const std::vector<double>&    paramMax,
+  const std::vector<double>&    paramInitials,
+  const mcmc_settings&          settings,
+  std::vector<double>&          filteredChain)
+{
+  const dynamics_info * dyn = data.m_dynMain;
+  const unsigned int n_params = paramInitials.size();
+  const unsigned int n_temps = settings.NChains;
+  const unsigned int length = settings.ChainLength;
+  const unsigned int lag = settings.FilterLag > 0 ? settings.FilterLag : 1;
+  const unsigned int interval = settings.ExchangeInterval > 0 ? settings.ExchangeInterval : 1;
+  const unsigned int rank = env.fullRank();
+  const unsigned int n_procs = env.fullComm().NumProc();
+  MPI_Comm comm = env.fullComm().Comm();
+
+  //geometric ladder, beta[0] = 1 is the posterior
+  std::vector<double> beta(n_temps, 1.);
+  for (unsigned int t = 1; t < n_temps; t++){
+    beta[t] = std::pow(settings.MaxTemp, -(double) t / (n_temps - 1));
+  }
+
+  //archive of past cold positions of every process, the differences of
+  //which drive the DE-MC proposals; seeded with a gaussian cloud of width
+  //ProposalStd around the initial position (draws from the whole box give
+  //first jumps into stiff corners where every solve is slow)
+  zika_philox rng(settings.Seed, rank, __ZIKA_POP_SHARED_STREAM);
+  const unsigned int n_seed = 10 * n_params;
+  std::vector<double> archive(n_seed * n_params);
+  for (unsigned int r = 0; r < n_seed; r++){
+    for (unsigned int i = 0; i < n_params; i++){
+      archive[r * n_params + i] = std::min(paramMax[i],
+          std::max(paramMin[i], paramInitials[i] + settings.ProposalStd * rng.normal()));
+    }
+  }
+
+  //current position and log-likelihood of every tempered chain
+  std::vector<double> position(n_temps * n_params);
+  std::vector<double> logLike(n_temps, 0.);
+  std::vector<unsigned int> accepted(n_temps, 0);
+  std::vector<unsigned int> swapsTried(n_temps, 0), swapsDone(n_temps, 0);
+  std::vector<double> weeks(n_temps, 0.), evaluations(n_temps, 0.);
+  std::vector<zika_philox> chainRng;
+  std::vector<std::vector<double> > returnValues(n_temps,
+      std::vector<double>(dyn->N_times * (dyn->N_s + 1), 0.));
+  for (unsigned int t = 0; t < n_temps; t++){
+    chainRng.push_back(zika_philox(settings.Seed, rank, __ZIKA_POP_CHAIN_STREAM(t)));
+    std::copy(paramInitials.begin(), paramInitials.end(), &position[t * n_params]);
+  }
+
+  //only the cold chain is recorded
+  std::vector<double> rawChain(length * n_params, 0.);
+  std::vector<double> rawLogTarget(length, 0.);
+
+  //exchange of the cold positions: an MPI_Iallgather posted every
+  //'interval' steps and completed with MPI_Test while the chains keep
+  //stepping; a rank only waits when the previous exchange is still in
+  //flight 'interval' steps later
+  std::vector<double> sendBuffer(n_params), recvBuffer(n_procs * n_params);
+  MPI_Request request = MPI_REQUEST_NULL;
+  bool pending = false;
+  double busyTime = 0., waitTime = 0.;
+  const double startTime = MPI_Wtime();
+
+  #pragma omp parallel for
+  for (int t = 0; t < (int) n_temps; t++){
+    //two zero entries past the deltas, read by the inad_type 3 kernel
+    double candidate[n_params + 2];
+    std::copy(&position[t * n_params], &position[t * n_params] + n_params, candidate);
+    candidate[n_params] = candidate[n_params + 1] = 0.;
+    logLike[t] = zikaLogLikelihood(candidate, data, returnValues[t]);
+  }
+  std::copy(position.begin(), position.begin() + n_params, rawChain.begin());
+  rawLogTarget[0] = logLike[0];
+
+  chain_diagnostics diagnostics(1, n_params);
+  chain_output output(env, 1, length, n_params, lag, settings, *dyn);
+  unsigned int done = length;   //positions in the cold chain, once stopped
+  for (unsigned int k = 1; k < length; k++){
+    if (pending) {
+      int arrived = 0;
+      MPI_Test(&request, &arrived, MPI_STATUS_IGNORE);
+      if (arrived) {
+        archive.insert(archive.end(), recvBuffer.begin(), recvBuffer.end());
+        pending = false;
+      }
+    }
+    if (k % interval == 0) {
+      //every rank posts the same sequence of collectives
+      if (pending) {
+        const double waitStart = MPI_Wtime();
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        waitTime += MPI_Wtime() - waitStart;
+        archive.insert(archive.end(), recvBuffer.begin(), recvBuffer.end());
+      }
+      std::copy(position.begin(), position.begin() + n_params, sendBuffer.begin());
+      MPI_Iallgather(&sendBuffer[0], n_params, MPI_DOUBLE,
+                     &recvBuffer[0], n_params, MPI_DOUBLE, comm, &request);
+      pending = true;
+    }
+
+    //one DE-MC step per tempered chain, on threads
+    const double busyStart = MPI_Wtime();
+    const unsigned int n_archive = archive.size() / n_params;
+    #pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < (int) n_temps; t++){
+      zika_philox & g = chainRng[t];
+      const unsigned int a = (unsigned int) (g.uniform() * n_archive);
+      unsigned int b = (unsigned int) (g.uniform() * n_archive);
+      while (b == a) b = (unsigned int) (g.uniform() * n_archive);
+      //2.38/sqrt(2d), with a jump of the full difference one step in ten
+      const double gamma = (g.uniform() < 0.1) ? 1. : 2.38 / std::sqrt(2. * n_params);
+
+      double * x = &position[t * n_params];
+      double candidate[n_params + 2];
+      candidate[n_params] = candidate[n_params + 1] = 0.;
+      bool inside = true;
+      for (unsigned int i = 0; i < n_params; i++){
+        candidate[i] = x[i] + gamma * (archive[a * n_params + i] - archive[b * n_params + i])
+                     + 0.01 * settings.ProposalStd * g.normal();
+        if (candidate[i] < paramMin[i] || candidate[i] > paramMax[i]) inside = false;
+      }
+      if (inside) {
+        //accept when beta (proposed - current) > log u, drawn first so
+        //that the solve can stop once that is out of reach
+        const double threshold = logLike[t] + std::log(g.uniform()) / beta[t];
+        unsigned int n_weeks = data.m_nObserved;
+        const double proposed = settings.EarlyStop ?
+          zikaLogLikelihoodBounded(candidate, data, returnValues[t], threshold, n_weeks) :
+          zikaLogLikelihood(candidate, data, returnValues[t]);
+        weeks[t] += n_weeks;
+        evaluations[t] += 1.;
+        if (proposed > threshold) {
+          std::copy(candidate, candidate + n_params, x);
+          logLike[t] = proposed;
+          accepted[t]++;
+        }
+      }
+    }
+    busyTime += MPI_Wtime() - busyStart;
+
+    //swaps between neighbouring temperatures, alternating even and odd pairs
+    for (unsigned int t = k % 2; t + 1 < n_temps; t += 2){
+      swapsTried[t]++;
+      if (std::log(rng.uniform()) < (beta[t] - beta[t + 1]) * (logLike[t + 1] - logLike[t])) {
+        std::swap_ranges(&position[t * n_params], &position[(t + 1) * n_params],
+                         &position[(t + 1) * n_params]);
+        std::swap(logLike[t], logLike[t + 1]);
+        swapsDone[t]++;
+      }
+    }
+
+    std::copy(position.begin(), position.begin() + n_params, &rawChain[k * n_params]);
+    rawLogTarget[k] = logLike[0];
+
+    if (settings.DiagnosticsPeriod && ((k + 1) % settings.DiagnosticsPeriod == 0 || k + 1 == length)) {
+      diagnostics.update(0, &rawChain[0], k + 1);
+      output.append(settings, rawChain, rawLogTarget, k + 1);
+      if (checkConvergence(env, diagnostics, k + 1, length, settings) && k + 1 < length) {
+        done = k + 1;
+        break;
+      }
+    }
+  }
+  output.append(settings, rawChain, rawLogTarget, done);
+  if (done < length) {
+    rawChain.resize(done * n_params);
+    rawLogTarget.resize(done);
+    if (rank == 0) {
+      std::cout << "ESS target " << settings.TargetEss << " reached after " << done
+                << " of " << length << " positions per cold chain" << std::endl;
+    }
+  }
+  if (pending) {
+    const double waitStart = MPI_Wtime();
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    waitTime += MPI_Wtime() - waitStart;
+  }
+  const double wallTime = MPI_Wtime() - startTime;
+
+  mergeChains(env, rawChain, rawLogTarget, 1, done, n_params, lag, settings,
+      filteredChain);
+
+  //scaling report: the sampling rate, and the share of the slowest rank's
+  //wall time every rank spent stepping its chains
+  double maxWall = 0., sumBusy = 0., maxWait = 0.;
+  MPI_Reduce(&wallTime, &maxWall, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(&busyTime, &sumBusy, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(&waitTime, &maxWait, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  unsigned int n_accepted = accepted[0], n_acceptedAll = 0;
+  MPI_Reduce(&n_accepted, &n_acceptedAll, 1, MPI_UNSIGNED, MPI_SUM, 0, comm);
+  double counts[2] = { 0., 0. }, countsAll[2] = { 0., 0. };
+  for (unsigned int t = 0; t < n_temps; t++){
+    counts[0] += weeks[t];
+    counts[1] += evaluations[t];
+  }
+  MPI_Reduce(counts, countsAll, 2, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+  if (rank == 0) {
+    const double rate = n_procs * n_temps * (done - 1) / maxWall;
+    const double efficiency = sumBusy / (n_procs * maxWall);
+    std::cout << "Population MH: " << n_procs << " processes x " << n_temps
+              << " temperatures, " << done << " positions per cold chain"
+              << "\n  cold acceptance rate " << (double) n_acceptedAll / (n_procs * std::max(done - 1, 1u))
+              << "\n  swap rate (lowest pair) "
+              << (n_temps > 1 ? (double) swapsDone[0] / std::max(swapsTried[0], 1u) : 0.)
+              << "\n  " << rate << " steps/s, busy fraction " << efficiency
+              << ", max wait on exchanges " << maxWait << " s"
+              << "\n  weeks integrated per proposal "
+              << (countsAll[1] > 0. ? countsAll[0] / countsAll[1] : 0.) << " of " << data.m_nObserved
+              << std::endl << std::endl;
+
+    //one line per run, bench/scaling.sh turns these into a scaling table
+    FILE *report = fopen("outputData/sip_population_scaling.txt","a");
+    if (report) {
+      fprintf(report,"%u %u %u %.6e %.6e %.6e %.6e\n", n_procs, n_temps, done,
+          maxWall, rate, efficiency, maxWait);
+      fclose(report);
+    }
+  }
+}
@@ -0,0 +1,518 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the multilevel Monte Carlo SFP: the qoi means and
+ * percentiles from many fixed-step RK4 solves, corrected level by level
+ * up to the adaptive solver with fewer and fewer coupled samples.
+ *-----------------------------------------------------------------*/
+
+#include "mlmc.h"
+#include "model.h"
+#include "philox.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sys/stat.h>
+
+//Constructor
+mlmc_settings::mlmc_settings()
+:
+  Levels(3),
+  CoarseSteps(2),
+  Tolerance(0.005),
+  InitialSamples(256),
+  MaxSamples(1000000),
+  GridPoints(256),
+  Seed(1),
+  Sigma(0.)
+{
+}
+
+//Destructor
+mlmc_settings::~mlmc_settings()
+{
+}
+
+//samples solved before their sums are taken, after the first round
+#define __ZIKA_MLMC_BLOCK 1024
+
+//a fixed-step solve that blows up is done again with twice the steps, at
+//most this many times, then with the adaptive solver
+#define __ZIKA_MLMC_REFINEMENTS 6
+
+//status of a sample of zikaMlmcSolveBlock
+#define __ZIKA_MLMC_SOLVED 0
+#define __ZIKA_MLMC_FAILED 1      //the adaptive solve failed, the sample is dropped
+#define __ZIKA_MLMC_REFINED 2     //a fixed-step solve needed more steps than its level
+
+//what the solves of every level share
+struct mlmc_problem
+{
+  const std::vector<double> * Ics;
+  const std::vector<double> * Times;
+  const dynamics_info       * Dyn;
+  const std::vector<double> * Samples;
+  unsigned int                N_params;
+  unsigned int                N_rows;     //posterior samples of this process
+  unsigned int                N_qoi;
+  unsigned int                Levels;     //the adaptive level
+  unsigned int                CoarseSteps;
+  unsigned int                Grid;
+  uint64_t                    Seed;
+  int                         Rank;
+  std::vector<double>         Lo, Dx;     //grid of the distribution function of every qoi
+};
+
+//running sums of one level; Local[] and Total[] hold the samples solved,
+//the samples failed, the seconds of all their solves and of the fine
+//solves alone, the samples refined, then the sum and the sum of squares
+//of the correction of every qoi
+#define __ZIKA_MLMC_SUMS 5
+struct mlmc_level
+{
+  unsigned long       Drawn;    //samples drawn by this process
+  std::vector<double> Local;    //this process
+  std::vector<double> Total;    //all processes, at the end of the last round
+  std::vector<double> Cdf;      //this process, see zikaMlmcAddCdf
+  std::vector<double> Step;
+};
+
+//qois of one solve at level l. A fixed-step solve that blows up is
+//refined, so every sample has a value at every level; the value of a
+//level is the same whether it is the fine or the coarse solve of a
+//sample, which keeps the telescoping sum equal to the adaptive level.
+//Returns true when the solve needed more steps than its level has; only
+//a failure of the adaptive solver is thrown
+static bool zikaMlmcSolve(const mlmc_problem& pb, unsigned int l, const double* deltas,
+    std::vector<double>& returnValues)
+{
+  for (unsigned int k = 0; l < pb.Levels && k <= __ZIKA_MLMC_REFINEMENTS; k++){
+    try{
+      zikaComputeModelFixedStep(*pb.Ics, *pb.Times, pb.Dyn, deltas, pb.CoarseSteps << (l + k),
+          returnValues);
+      return k > 0;
+    }catch(const zika_solve_failure & failure)
+    {
+    }
+  }
+  zikaComputeModel(*pb.Ics, *pb.Times, pb.Dyn, deltas, returnValues);
+  return l < pb.Levels;
+}
+
+//samples first to first + n - 1 of this process at level l, on the OpenMP
+//threads: rows gets the qois of the fine solve then those of the coarse
+//one (level l - 1, none at level 0), the status of every sample,
+//seconds the wall time of both solves and of the fine one. The deltas of
+//sample k are a row of the posterior samples drawn from a Philox stream
+//of (rank, k) and l, whatever thread solves it
+static void zikaMlmcSolveBlock(const mlmc_problem& pb, unsigned int l, unsigned long first,
+    unsigned int n, std::vector<double>& rows, std::vector<int>& status,
+    std::vector<double>& seconds)
+{
+  const unsigned int n_qoi = pb.N_qoi;
+  rows.resize((size_t) n * 2 * n_qoi);
+  status.resize(n);
+  seconds.resize(2 * n);
+  #pragma omp parallel
+  {
+    //the inad_type 3 kernel reads two entries past the deltas
+    std::vector<double> deltas(pb.N_params + 2, 0.), fine(n_qoi), coarse(n_qoi, 0.);
+    #pragma omp for schedule(dynamic)
+    for (int i = 0; i < (int) n; i++){
+      zika_philox rng(pb.Seed, ((uint64_t) pb.Rank << 40) + first + i, l);
+      const unsigned int row = std::min(pb.N_rows - 1, (unsigned int) (rng.uniform() * pb.N_rows));
+      std::copy(&(*pb.Samples)[(size_t) row * pb.N_params],
+                &(*pb.Samples)[(size_t) row * pb.N_params] + pb.N_params, deltas.begin());
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      double fineSeconds = 0.;
+      status[i] = __ZIKA_MLMC_SOLVED;
+      try{
+        bool refined = zikaMlmcSolve(pb, l, &deltas[0], fine);
+        fineSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (l > 0) refined = zikaMlmcSolve(pb, l - 1, &deltas[0], coarse) || refined;
+        if (refined) status[i] = __ZIKA_MLMC_REFINED;
+      }catch(const zika_solve_failure & failure)
+      {
+        status[i] = __ZIKA_MLMC_FAILED;
+      }
+      seconds[2 * i] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      seconds[2 * i + 1] = fineSeconds;
+      std::copy(fine.begin(), fine.end(), &rows[(size_t) i * 2 * n_qoi]);
+      std::copy(coarse.begin(), coarse.end(), &rows[(size_t) i * 2 * n_qoi + n_qoi]);
+    }
+  }
+}
+
+//adds the corrections of n samples of level l to the level's sums, in
+//the order of the samples
+static void zikaMlmcAddMoments(const mlmc_problem& pb, unsigned int l, mlmc_level& level,
+    const std::vector<double>& rows, const std::vector<int>& status,
+    const std::vector<double>& seconds, unsigned int n)
+{
+  const unsigned int n_qoi = pb.N_qoi;
+  double * sum = &level.Local[__ZIKA_MLMC_SUMS];
+  double * sum2 = sum + n_qoi;
+  for (unsigned int i = 0; i < n; i++){
+    level.Local[2] += seconds[2 * i];
+    level.Local[3] += seconds[2 * i + 1];
+    if (status[i] == __ZIKA_MLMC_FAILED) {
+      level.Local[1] += 1.;
+      continue;
+    }
+    level.Local[0] += 1.;
+    if (status[i] == __ZIKA_MLMC_REFINED) level.Local[4] += 1.;
+    const double * fine = &rows[(size_t) i * 2 * n_qoi];
+    const double * coarse = fine + n_qoi;
+    for (unsigned int q = 0; q < n_qoi; q++){
+      const double y = (l > 0) ? fine[q] - coarse[q] : fine[q];
+      sum[q] += y;
+      sum2[q] += y * y;
+    }
+  }
+}
+
+//adds weight times the smoothed indicator of value <= x at the grid points
+//x of qoi q: 0 below value - dx, 1 above value + dx, a cubic with zero
+//slopes in between. The points within dx of the value are added to Cdf,
+//the first point past them to Step, where the 1 starts; the sum of Step
+//up to a point is added to Cdf at the end
+static void zikaMlmcAddCdf(const mlmc_problem& pb, mlmc_level& level, unsigned int q,
+    double value, double weight)
+{
+  const double G = pb.Grid;
+  const double u = (value - pb.Lo[q]) / pb.Dx[q];
+  const unsigned int first = (unsigned int) std::min(G, std::max(0., std::ceil(u - 1.)));
+  const unsigned int end = (unsigned int) std::min(G, std::max(0., std::floor(u + 1.) + 1.));
+  double * cdf = &level.Cdf[(size_t) q * pb.Grid];
+  for (unsigned int g = first; g < end; g++){
+    const double z = g - u;
+    cdf[g] += weight * (0.5 + 0.75 * z - 0.25 * z * z * z);
+  }
+  level.Step[(size_t) q * (pb.Grid + 1) + end] += weight;
+}
+
+//adds the distribution functions of n samples of level l: that of the
+//fine qois, minus that of the coarse ones above level 0; the qois are
+//spread over the OpenMP threads
+static void zikaMlmcAddCdfRows(const mlmc_problem& pb, unsigned int l, mlmc_level& level,
+    const std::vector<double>& rows, const std::vector<int>& status, unsigned int n)
+{
+  const unsigned int n_qoi = pb.N_qoi;
+  #pragma omp parallel for schedule(static)
+  for (int q = 0; q < (int) n_qoi; q++){
+    for (unsigned int i = 0; i < n; i++){
+      if (status[i] == __ZIKA_MLMC_FAILED) continue;
+      zikaMlmcAddCdf(pb, level, q, rows[(size_t) i * 2 * n_qoi + q], 1.);
+      if (l > 0) zikaMlmcAddCdf(pb, level, q, rows[(size_t) i * 2 * n_qoi + n_qoi + q], -1.);
+    }
+  }
+}
+
+//value where the distribution function F of the grid first reaches p,
+//linear between the grid points
+static double zikaMlmcInvert(const double* F, unsigned int G, double lo, double dx, double p)
+{
+  if (F[0] >= p) return lo;
+  for (unsigned int g = 1; g < G; g++){
+    if (F[g] >= p) {
+      return lo + dx * (g - 1 + (p - F[g - 1]) / (F[g] - F[g - 1]));
+    }
+  }
+  return lo + dx * (G - 1);
+}
+
+void zikaSolveSfpMlmc(
+  const QUESO::FullEnvironment& env,
+  const std::vector<double>&    initialValues,
+  const std::vector<double>&    timePoints,
+  const dynamics_info*          dyn,
+  const std::vector<double>&    samples,
+  unsigned int                  n_params,
+  const mlmc_settings&          settings,
+  const char*                   statsFile)
+{
+  const int n_procs = env.fullComm().NumProc();
+  const unsigned int dim = initialValues.size();
+  const unsigned int n_times = timePoints.size();
+  const unsigned int n_qoi = n_times * dim;
+  const unsigned int n_levels = settings.Levels + 1;
+  const unsigned int G = std::max(settings.GridPoints, 2u);
+  const unsigned int n_sums = __ZIKA_MLMC_SUMS + 2 * n_qoi;
+
+  mlmc_problem pb;
+  pb.Ics = &initialValues;
+  pb.Times = &timePoints;
+  pb.Dyn = dyn;
+  pb.Samples = &samples;
+  pb.N_params = n_params;
+  pb.N_rows = samples.size() / n_params;
+  pb.N_qoi = n_qoi;
+  pb.Levels = settings.Levels;
+  pb.CoarseSteps = std::max(settings.CoarseSteps, 1u);
+  pb.Grid = G;
+  pb.Seed = settings.Seed;
+  pb.Rank = env.fullRank();
+  pb.Lo.assign(n_qoi, 0.);
+  pb.Dx.assign(n_qoi, 1.);
+  if (pb.N_rows == 0) return;
+
+  std::vector<mlmc_level> levels(n_levels);
+  for (unsigned int l = 0; l < n_levels; l++){
+    levels[l].Drawn = 0;
+    levels[l].Local.assign(n_sums, 0.);
+    levels[l].Total.assign(n_sums, 0.);
+    levels[l].Cdf.assign((size_t) n_qoi * G, 0.);
+    levels[l].Step.assign((size_t) n_qoi * (G + 1), 0.);
+  }
+
+  //samples wanted on every level, all processes
+  std::vector<double> wanted(n_levels, std::max(settings.InitialSamples, (unsigned int) n_procs));
+  std::vector<double> mean(n_qoi), variance((size_t) n_levels * n_qoi), cost(n_levels);
+  std::vector<double> rows, seconds;
+  std::vector<int> status;
+  if (env.fullRank() == 0) {
+    std::cout << "Solving the SFP with multilevel Monte Carlo: " << settings.Levels
+              << " RK4 levels from " << pb.CoarseSteps << " steps per week, then the adaptive solver"
+              << std::endl;
+  }
+
+  for (unsigned int round = 0; ; round++){
+    //the first round is kept whole: the grids of the distribution
+    //functions are taken from it
+    std::vector<std::vector<double> > firstRows(round == 0 ? n_levels : 0);
+    std::vector<std::vector<int> > firstStatus(round == 0 ? n_levels : 0);
+    for (unsigned int l = 0; l < n_levels; l++){
+      const double drawn = levels[l].Total[0] + levels[l].Total[1];
+      if (wanted[l] <= drawn) continue;
+      const unsigned long share = (unsigned long) std::ceil((wanted[l] - drawn) / n_procs);
+      for (unsigned long done = 0; done < share; ){
+        const unsigned int n = (round == 0) ? share
+            : (unsigned int) std::min(share - done, (unsigned long) __ZIKA_MLMC_BLOCK);
+        zikaMlmcSolveBlock(pb, l, levels[l].Drawn, n, rows, status, seconds);
+        zikaMlmcAddMoments(pb, l, levels[l], rows, status, seconds, n);
+        if (round == 0) {
+          firstRows[l].swap(rows);
+          firstStatus[l].swap(status);
+        }
+        else {
+          zikaMlmcAddCdfRows(pb, l, levels[l], rows, status, n);
+        }
+        levels[l].Drawn += n;
+        done += n;
+      }
+    }
+
+    if (round == 0) {
+      //the range of the fine qois of all processes, widened by a quarter
+      //on either side and by the noise
+      std::vector<double> bounds(2 * n_qoi, HUGE_VAL), allBounds(2 * n_qoi);
+      for (unsigned int l = 0; l < n_levels; l++){
+        for (unsigned int i = 0; i < firstStatus[l].size(); i++){
+          if (firstStatus[l][i] == __ZIKA_MLMC_FAILED) continue;
+          for (unsigned int q = 0; q < n_qoi; q++){
+            const double value = firstRows[l][(size_t) i * 2 * n_qoi + q];
+            bounds[q] = std::min(bounds[q], value);
+            bounds[n_qoi + q] = std::min(bounds[n_qoi + q], -value);
+          }
+        }
+      }
+      MPI_Allreduce(&bounds[0], &allBounds[0], 2 * n_qoi, MPI_DOUBLE, MPI_MIN,
+          env.fullComm().Comm());
+      for (unsigned int q = 0; q < n_qoi; q++){
+        double lo = allBounds[q], hi = -allBounds[n_qoi + q];
+        if (lo > hi) lo = hi = 0.;   //every first sample failed
+        double pad = 0.25 * (hi - lo) + 6. * settings.Sigma;
+        if (pad <= 0.) pad = 1.e-6 * std::max(1., std::abs(lo));
+        pb.Lo[q] = lo - pad;
+        pb.Dx[q] = (hi - lo + 2. * pad) / (G - 1);
+      }
+      for (unsigned int l = 0; l < n_levels; l++){
+        zikaMlmcAddCdfRows(pb, l, levels[l], firstRows[l], firstStatus[l], firstStatus[l].size());
+      }
+    }
+
+    for (unsigned int l = 0; l < n_levels; l++){
+      MPI_Allreduce(&levels[l].Local[0], &levels[l].Total[0], n_sums, MPI_DOUBLE, MPI_SUM,
+          env.fullComm().Comm());
+    }
+
+    //estimates: the sum of the mean corrections, their variances and the
+    //cost of a sample of every level
+    std::fill(mean.begin(), mean.end(), 0.);
+    for (unsigned int l = 0; l < n_levels; l++){
+      const std::vector<double> & total = levels[l].Total;
+      const double N = total[0];
+      cost[l] = std::max(total[2] / std::max(total[0] + total[1], 1.), 1.e-9);
+      for (unsigned int q = 0; q < n_qoi; q++){
+        const double m = (N > 0.) ? total[__ZIKA_MLMC_SUMS + q] / N : 0.;
+        const double m2 = (N > 0.) ? total[__ZIKA_MLMC_SUMS + n_qoi + q] / N : 0.;
+        mean[q] += m;
+        variance[(size_t) l * n_qoi + q] = std::max(m2 - m * m, 0.);
+      }
+    }
+
+    //Giles' allocation for the cumulative cases of every week past the
+    //first, the largest over them; all of eps^2 goes to the variance, the
+    //adaptive level making the estimator unbiased for the SFP
+    bool more = false;
+    for (unsigned int j = 1; j < n_times && settings.Tolerance > 0.; j++){
+      const unsigned int q = dim * j + dim - 1;
+      const double eps = settings.Tolerance * std::abs(mean[q]);
+      if (!(eps > 0.)) continue;
+      double sum = 0.;
+      for (unsigned int l = 0; l < n_levels; l++){
+        sum += std::sqrt(variance[(size_t) l * n_qoi + q] * cost[l]);
+      }
+      for (unsigned int l = 0; l < n_levels; l++){
+        const double N = std::ceil(std::sqrt(variance[(size_t) l * n_qoi + q] / cost[l]) * sum / (eps * eps));
+        wanted[l] = std::max(wanted[l], std::min(N, (double) settings.MaxSamples));
+      }
+    }
+    for (unsigned int l = 0; l < n_levels; l++){
+      if (wanted[l] > levels[l].Total[0] + levels[l].Total[1]) more = true;
+    }
+    if (env.fullRank() == 0) {
+      std::cout << "MLMC round " << round << ": samples per level";
+      for (unsigned int l = 0; l < n_levels; l++) std::cout << " " << levels[l].Total[0];
+      std::cout << (more ? ", more needed" : "") << std::endl;
+    }
+    if (!more) break;
+  }
+
+  //the distribution functions, added up on process 0
+  for (unsigned int l = 0; l < n_levels; l++){
+    std::vector<double> & cdf = levels[l].Cdf;
+    std::vector<double> & step = levels[l].Step;
+    for (unsigned int q = 0; q < n_qoi; q++){
+      double run = 0.;
+      for (unsigned int g = 0; g < G; g++){
+        run += step[(size_t) q * (G + 1) + g];
+        cdf[(size_t) q * G + g] += run;
+      }
+    }
+    std::vector<double> all(env.fullRank() == 0 ? cdf.size() : 1);
+    MPI_Reduce(&cdf[0], &all[0], cdf.size(), MPI_DOUBLE, MPI_SUM, 0, env.fullComm().Comm());
+    if (env.fullRank() == 0) cdf.swap(all);
+    std::vector<double>().swap(step);
+  }
+  if (env.fullRank() != 0) return;
+
+  mkdir("outputData", 0755);
+  unsigned long failed = 0;
+  for (unsigned int l = 0; l < n_levels; l++) failed += (unsigned long) levels[l].Total[1];
+  if (failed) {
+    printf("WARNING: %lu MLMC samples were dropped, their adaptive solves failed"
+        " (see outputData/sfp_mlmc_levels.txt)\n", failed);
+  }
+
+  //mean and standard error of every qoi
+  FILE * file = fopen("outputData/sfp_mlmc_mean.txt", "w");
+  if (!file) {
+    printf("WARNING: could not open outputData/sfp_mlmc_mean.txt\n");
+  }
+  else {
+    fprintf(file, "# mean standard_error, one line per qoi\n");
+    for (unsigned int q = 0; q < n_qoi; q++){
+      double se2 = 0.;
+      for (unsigned int l = 0; l < n_levels; l++){
+        if (levels[l].Total[0] > 0.) se2 += variance[(size_t) l * n_qoi + q] / levels[l].Total[0];
+      }
+      fprintf(file, "%.10g %.10g\n", mean[q], std::sqrt(se2));
+    }
+    fclose(file);
+  }
+
+  //cost of the estimate against plain Monte Carlo with the adaptive solver
+  //to the same standard errors, the variance of the qois taken from level 0
+  const unsigned int last = n_qoi - 1;
+  double plainSamples = 0., seconds_all = 0.;
+  for (unsigned int l = 0; l < n_levels; l++) seconds_all += levels[l].Total[2];
+  for (unsigned int j = 1; j < n_times; j++){
+    const unsigned int q = dim * j + dim - 1;
+    double se2 = 0.;
+    for (unsigned int l = 0; l < n_levels; l++){
+      if (levels[l].Total[0] > 0.) se2 += variance[(size_t) l * n_qoi + q] / levels[l].Total[0];
+    }
+    if (se2 > 0.) plainSamples = std::max(plainSamples, variance[q] / se2);
+  }
+  const mlmc_level & top = levels[n_levels - 1];
+  const double adaptiveSeconds = top.Total[3] / std::max(top.Total[0] + top.Total[1], 1.);
+  file = fopen("outputData/sfp_mlmc_levels.txt", "w");
+  if (!file) {
+    printf("WARNING: could not open outputData/sfp_mlmc_levels.txt\n");
+  }
+  else {
+    fprintf(file, "# level steps_per_week samples failed refined seconds_per_sample"
+                  " mean_correction variance_correction (cumulative cases, last week)\n");
+    for (unsigned int l = 0; l < n_levels; l++){
+      fprintf(file, "%u %u %.0f %.0f %.0f %.6e %.10g %.10g\n", l,
+          (l < settings.Levels) ? pb.CoarseSteps << l : 0,
+          levels[l].Total[0], levels[l].Total[1], levels[l].Total[4], cost[l],
+          (levels[l].Total[0] > 0.) ? levels[l].Total[__ZIKA_MLMC_SUMS + last] / levels[l].Total[0] : 0.,
+          variance[(size_t) l * n_qoi + last]);
+    }
+    fprintf(file, "# %.0f adaptive solves and %.3f s of solves; plain Monte Carlo to the same"
+                  " standard errors: %.0f adaptive solves, %.3f s\n",
+        top.Total[0] + top.Total[1], seconds_all, std::ceil(plainSamples),
+        std::ceil(plainSamples) * adaptiveSeconds);
+    fclose(file);
+  }
+  std::cout << "MLMC SFP: " << top.Total[0] + top.Total[1] << " adaptive solves and "
+            << seconds_all << " s of solves, against " << std::ceil(plainSamples)
+            << " adaptive solves and " << std::ceil(plainSamples) * adaptiveSeconds
+            << " s for plain Monte Carlo to the same standard errors" << std::endl;
+
+  //the distribution function of every qoi: the levels added up, convolved
+  //with the noise (steps of the grid spacing, the mass of N(0, Sigma^2)
+  //over each), made monotone and inverted
+  file = fopen(statsFile, "w");
+  if (!file) {
+    printf("WARNING: could not open %s\n", statsFile);
+    return;
+  }
+  static const double percents[5] = { 0.5, 0.025, 0.175, 0.825, 0.975 };
+  std::vector<double> F(G), noisy(G), mass;
+  for (unsigned int q = 0; q < n_qoi; q++){
+    std::fill(F.begin(), F.end(), 0.);
+    for (unsigned int l = 0; l < n_levels; l++){
+      if (levels[l].Total[0] <= 0.) continue;
+      const double * cdf = &levels[l].Cdf[(size_t) q * G];
+      for (unsigned int g = 0; g < G; g++) F[g] += cdf[g] / levels[l].Total[0];
+    }
+    const double dx = pb.Dx[q];
+    const int K = (settings.Sigma > 0.) ? (int) std::min(std::ceil(6. * settings.Sigma / dx), (double) G) : 0;
+    if (K > 0) {
+      mass.resize(2 * K + 1);
+      for (int k = -K; k <= K; k++){
+        mass[k + K] = 0.5 * (std::erfc(-(k + 0.5) * dx / (settings.Sigma * M_SQRT2))
+                           - std::erfc(-(k - 0.5) * dx / (settings.Sigma * M_SQRT2)));
+      }
+      for (int g = 0; g < (int) G; g++){
+        double value = 0.;
+        for (int k = -K; k <= K; k++){
+          const int h = std::min(std::max(g - k, 0), (int) G - 1);
+          value += mass[k + K] * F[h];
+        }
+        noisy[g] = value;
+      }
+      F.swap(noisy);
+    }
+    double top_F = 0.;
+    for (unsigned int g = 0; g < G; g++){
+      top_F = std::max(top_F, std::min(std::max(F[g], 0.), 1.));
+      F[g] = top_F;
+    }
+    for (unsigned int p = 0; p < 5; p++){
+      const double value = std::max(zikaMlmcInvert(&F[0], G, pb.Lo[q], dx, percents[p]), 0.);
+      fprintf(file, (p < 4) ? "%.10g " : "%.10g\n", value);
+    }
+  }
+  fclose(file);
+  std::cout << "QoI percentiles written to " << statsFile << std::endl;
+}
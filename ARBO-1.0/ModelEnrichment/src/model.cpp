@@ -9,8 +9,11 @@
  *-----------------------------------------------------------------*/
 
 #include "model.h"
+#include "rhs.h"
+#include "dual.h"
 /* #include "dynamics_info.h" */
 #include <cmath>
+#include <algorithm>
 #include <vector>
 #include <iostream>
 #include <gsl/gsl_errno.h>
@@ -20,6 +23,8 @@
 #include <gsl/gsl_math.h>
 #include <gsl/gsl_roots.h>
 #include <assert.h>
+#include <atomic>
+#include <chrono>
 #include "eigen3/Eigen/Dense"
 /* //antioch */
 /* #include <antioch/kinetics_evaluator.h> */
@@ -38,32 +43,38 @@ int zikaFunction( double t,
                  double dYdt[],
                  void* params)
 {
-  //here, params is sending the function all the reaction info
-  dynamics_info dyn = *(dynamics_info *) params;
+  //here, params is sending the function all the reaction info and the
+  //deltas of this evaluation; take it by reference, this routine runs on
+  //every stage of every step
+  const zika_system & sys = *(const zika_system *) params;
+  const dynamics_info & dyn = *sys.Dyn;
 
-  //reduced model parameters:
-  double bh = 1/11.3; //\beta_h
-  double ah = 1/5.9;  //\alpha_h
-  double g = 1/7.9;   //\gamma
-  double d = 1/11.;   //\delta
-  double bv = 1/8.6;  //\beta_v
-  double av = 1/9.1;  //\alpha_v
-  double nv = 1.;     //N_v
-  double nh = 206 * pow(10,6);
+  //reduced model parameters (resolved once in dynamics_info)
+  const double bh = dyn.Bh; //\beta_h
+  const double ah = dyn.Ah; //\alpha_h
+  const double g = dyn.G;   //\gamma
+  const double d = dyn.D;   //\delta
+  const double bv = dyn.Bv; //\beta_v
+  const double av = dyn.Av; //\alpha_v
+  const double nv = dyn.Nv; //N_v
+  const double nh = dyn.Nh; //N_h
 
   const unsigned int n_s = dyn.N_s;
   const unsigned int inad_type = dyn.Inad_type;
   const unsigned int pf = dyn.Params_factor;
-  const unsigned int n_deltas = pf * n_s;
-  std::vector<double> delta = dyn.Deltas;
+  const double * delta = sys.Deltas;
 
-  //use pops to copy ``populations'' of state variables
-  std::vector<double> pops(n_s + 1,0);
+  //use pops to copy ``populations'' of state variables (on the stack, so
+  //no heap allocation per RHS call)
+  double pops[n_s + 1];
   for (unsigned int i = 0; i < n_s + 1; i++){
     pops[i] = Y[i];
     if(pops[i] <= 0){
       pops[i] = 0;
     }
+    else if (dyn.PositivityWidth > 0.) {
+      pops[i] = smoothPositive(Y[i], dyn.PositivityWidth * dyn.Scale(i));
+    }
   }
 
   //SEIR-SEI model
@@ -110,39 +121,482 @@ int zikaFunction( double t,
   return GSL_SUCCESS;
 }
 
+template <unsigned int INAD, unsigned int NS>
+int zikaKernel( double t,
+                const double Y[],
+                double dYdt[],
+                void* params)
+{
+  const zika_system & sys = *(const zika_system *) params;
+  zikaRhs<INAD,NS,double,double>(Y, dYdt, sys.Deltas, *sys.Dyn);
+  return GSL_SUCCESS;
+}
+
+//exact jacobian of zikaKernel by forward-mode differentiation of zikaRhs:
+//seed dY_j/dY_j = 1 and read dfdY(i,j) off the derivative parts. The
+//clamping of negative states and the |dYdt| terms get their one-sided
+//derivatives. The system is autonomous, so dfdt = 0.
+template <unsigned int INAD, unsigned int NS>
+int zikaJacobianKernel( double t,
+                        const double Y[],
+                        double *dfdY,
+                        double dfdt[],
+                        void* params)
+{
+  const unsigned int dim = NS + 1;
+  dual<NS + 1> y[NS + 1];
+  dual<NS + 1> f[NS + 1];
+  for (unsigned int j = 0; j < dim; j++){
+    y[j].v = Y[j];
+    y[j].d[j] = 1.;
+  }
+  const zika_system & sys = *(const zika_system *) params;
+  zikaRhs<INAD,NS,dual<NS + 1>,double>(y, f, sys.Deltas, *sys.Dyn);
+  for (unsigned int i = 0; i < dim; i++){
+    for (unsigned int j = 0; j < dim; j++){
+      dfdY[dim*i + j] = f[i].d[j];
+    }
+    dfdt[i] = 0.;
+  }
+  return GSL_SUCCESS;
+}
+
+//state and forward sensitivities S = dY/d(delta) in one system,
+//Z = [Y, S(0,0..np-1), ..., S(NS,0..np-1)]: with Y carrying S as its
+//derivative part and the deltas seeded with the identity, the derivative
+//part of zikaRhs is dS/dt = df/dY S + df/d(delta). The two entries past
+//the deltas read by the inadequacy type 3 kernel get zero derivatives.
+template <unsigned int INAD, unsigned int NS>
+int zikaSensKernel( double t,
+                    const double Z[],
+                    double dZdt[],
+                    void* params)
+{
+  const unsigned int dim = NS + 1;
+  const unsigned int np = inad_traits<INAD,NS>::pf * NS;
+  const zika_system & sys = *(const zika_system *) params;
+  dual<np> y[NS + 1];
+  dual<np> f[NS + 1];
+  dual<np> delta[np + 2];
+  for (unsigned int i = 0; i < dim; i++){
+    y[i].v = Z[i];
+    for (unsigned int p = 0; p < np; p++){
+      y[i].d[p] = Z[dim + np*i + p];
+    }
+  }
+  for (unsigned int p = 0; p < np; p++){
+    delta[p].v = sys.Deltas[p];
+    delta[p].d[p] = 1.;
+  }
+  if (INAD == 3) {
+    delta[np].v = sys.Deltas[np];
+    delta[np + 1].v = sys.Deltas[np + 1];
+  }
+  zikaRhs<INAD,NS,dual<np>,dual<np> >(y, f, delta, *sys.Dyn);
+  for (unsigned int i = 0; i < dim; i++){
+    dZdt[i] = f[i].v;
+    for (unsigned int p = 0; p < np; p++){
+      dZdt[dim + np*i + p] = f[i].d[p];
+    }
+  }
+  return GSL_SUCCESS;
+}
+
+//pick the right-hand side and its jacobian once, at setup, from the
+//inadequacy type. Only the 7 species SEIR-SEI system has specialized
+//kernels, anything else (or a params_factor that does not match the
+//inadequacy type) keeps the generic zikaFunction/zikaJacobian.
+void zikaSelectKernel(dynamics_info* dyn)
+{
+  dyn->Rhs = zikaFunction;
+  dyn->Jac = zikaJacobian;
+  dyn->SensRhs = NULL;
+  if (dyn->N_s != 7) {
+    return;
+  }
+  switch (dyn->Inad_type) {
+    case 0:
+      if (dyn->Params_factor == inad_traits<0,7>::pf) {
+        dyn->Rhs = zikaKernel<0,7>;
+        dyn->Jac = zikaJacobianKernel<0,7>;
+        dyn->SensRhs = zikaSensKernel<0,7>;
+      }
+      break;
+    case 1:
+      if (dyn->Params_factor == inad_traits<1,7>::pf) {
+        dyn->Rhs = zikaKernel<1,7>;
+        dyn->Jac = zikaJacobianKernel<1,7>;
+        dyn->SensRhs = zikaSensKernel<1,7>;
+      }
+      break;
+    case 2:
+      if (dyn->Params_factor == inad_traits<2,7>::pf) {
+        dyn->Rhs = zikaKernel<2,7>;
+        dyn->Jac = zikaJacobianKernel<2,7>;
+        dyn->SensRhs = zikaSensKernel<2,7>;
+      }
+      break;
+    case 3:
+      if (dyn->Params_factor == inad_traits<3,7>::pf) {
+        dyn->Rhs = zikaKernel<3,7>;
+        dyn->Jac = zikaJacobianKernel<3,7>;
+        dyn->SensRhs = zikaSensKernel<3,7>;
+      }
+      break;
+  }
+}
+
 //jacobian for ode solve---------------------------------------------
+//generic fallback for systems without a specialized kernel: one-sided
+//finite differences of zikaFunction, one column per state variable
 int zikaJacobian( double t, 
 				const double Y[],
 				double *dfdY,
 				double dfdt[],
 				void* params )
 {
+  const zika_system & sys = *(const zika_system *) params;
+  const unsigned int dim = sys.Dyn->N_s + 1;
+  double f0[dim];
+  double f1[dim];
+  double Yh[dim];
+
+  zikaFunction(t, Y, f0, params);
+  for (unsigned int j = 0; j < dim; j++){
+    Yh[j] = Y[j];
+  }
+  for (unsigned int j = 0; j < dim; j++){
+    const double h = 1.e-7 * std::max(std::abs(Y[j]), 1.e-6);
+    Yh[j] = Y[j] + h;
+    zikaFunction(t, Yh, f1, params);
+    Yh[j] = Y[j];
+    for (unsigned int i = 0; i < dim; i++){
+      dfdY[dim*i + j] = (f1[i] - f0[i]) / h;
+    }
+  }
+  for (unsigned int i = 0; i < dim; i++){
+    dfdt[i] = 0.;
+  }
   return GSL_SUCCESS;
 }
 
+//GSL stepper for each dynamics_info::Solver; the implicit ones use the
+//jacobian above
+static const gsl_odeiv2_step_type * zikaStepType(unsigned int solver)
+{
+  switch (solver) {
+    case ZIKA_SOLVER_RK8PD:  return gsl_odeiv2_step_rk8pd;
+    case ZIKA_SOLVER_MSBDF:  return gsl_odeiv2_step_msbdf;
+    case ZIKA_SOLVER_BSIMP:  return gsl_odeiv2_step_bsimp;
+    case ZIKA_SOLVER_RK4IMP: return gsl_odeiv2_step_rk4imp;
+    default:                 return gsl_odeiv2_step_rkf45;
+  }
+}
+
+//GSL driver kept alive between solves instead of being allocated and freed
+//on every likelihood/qoi evaluation. There is one per thread, and it is only
+//rebuilt when the dimension or the stepper changes. The first accepted step
+//size of the last solve and its deltas are kept for warm starts.
+struct ode_workspace { ode_workspace();
+ ~ode_workspace();
+
+  gsl_odeiv2_system   sys;
+  gsl_odeiv2_driver * driver;
+  unsigned int        dim;
+  unsigned int        solver;
+  unsigned int        scaled;
+  double              lastH;
+  std::vector<double> lastDeltas;
+};
+
+ode_workspace::ode_workspace()
+: driver(NULL),
+  dim(0),
+  solver(0),
+  scaled(0),
+  lastH(0.)
+{
+}
+
+ode_workspace::~ode_workspace()
+{
+  if (driver) gsl_odeiv2_driver_free(driver);
+}
+
+static thread_local ode_workspace zikaWorkspace;
+
+//(re)builds the driver of ws for a system of dimension dim, with absolute
+//tolerance 1e-8 and relative 1e-4; with dyn.ScaledTolerance the absolute
+//tolerance of component i is 1e-8*dyn.Scale(i) (the scale of the last
+//N_s+1 components is reused for the sensitivities, row by row)
+static void zikaAllocDriver(ode_workspace & ws, const dynamics_info & dyn,
+    unsigned int dim, unsigned int solver, double h)
+{
+  if (ws.driver) gsl_odeiv2_driver_free( ws.driver );
+  if (dyn.ScaledTolerance) {
+    const unsigned int n_s = dyn.N_s + 1;
+    double scaleAbs[dim];
+    for (unsigned int i = 0; i < dim; i++){
+      scaleAbs[i] = dyn.Scale((i < n_s) ? i : (i - n_s) / ((dim - n_s) / n_s));
+    }
+    ws.driver = gsl_odeiv2_driver_alloc_scaled_new( &ws.sys, zikaStepType(solver),
+        h, 1e-8, 1e-4, 1., 0., scaleAbs );
+  }
+  else {
+    ws.driver = gsl_odeiv2_driver_alloc_y_new( &ws.sys, zikaStepType(solver),h,1e-8,1e-4);
+  }
+  ws.dim = dim;
+  ws.solver = solver;
+  ws.scaled = dyn.ScaledTolerance;
+  ws.lastH = 0.;
+}
+
+//steps taken and rejected by all the solves of the process, see
+//zikaSolverStats
+static std::atomic<unsigned long> zikaSolves(0), zikaSteps(0), zikaRejected(0),
+  zikaFailed(0);
+
+void zikaCountSteps(unsigned long solves, unsigned long steps, unsigned long rejected,
+    unsigned long failed)
+{
+  zikaSolves += solves;
+  zikaSteps += steps;
+  zikaRejected += rejected;
+  zikaFailed += failed;
+}
+
+zika_solver_stats zikaSolverStats()
+{
+  zika_solver_stats stats = { zikaSolves, zikaSteps, zikaRejected, zikaFailed };
+  return stats;
+}
+
+void zikaResetSolverStats()
+{
+  zikaSolves = 0;
+  zikaSteps = 0;
+  zikaRejected = 0;
+  zikaFailed = 0;
+}
+
+const char* zika_solve_failure::what() const throw()
+{
+  switch (Reason) {
+    case ZIKA_FAILURE_RHS_CALLS:  return "zika solve: too many right-hand side calls";
+    case ZIKA_FAILURE_MIN_STEP:   return "zika solve: step size below the minimum";
+    case ZIKA_FAILURE_WALL_CLOCK: return "zika solve: out of time";
+    default:                      return "zika solve: GSL could not take a step";
+  }
+}
+
+static double zikaClock()
+{
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//arms the budget of dyn for a solve with right-hand side rhs
+static void zikaStartBudget(zika_budget & budget, const dynamics_info & dyn,
+    int (*rhs)(double, const double[], double[], void*))
+{
+  budget.Rhs = rhs;
+  budget.Calls = 0;
+  budget.MaxCalls = dyn.MaxRhsCalls;
+  budget.Deadline = (dyn.MaxSeconds > 0.) ? zikaClock() + dyn.MaxSeconds : 0.;
+  budget.Failure = 0;
+}
+
+//what the solver calls instead of the right-hand side: counts the calls,
+//looks at the clock every 256 of them, and makes GSL give up the step
+//(GSL_EBADFUNC) once the budget is spent
+static int zikaBudgetedRhs(double t, const double Y[], double dYdt[], void* params)
+{
+  const zika_system & sys = *(const zika_system *) params;
+  zika_budget & budget = *sys.Budget;
+  budget.Calls++;
+  if (budget.MaxCalls > 0 && budget.Calls > budget.MaxCalls) {
+    budget.Failure = ZIKA_FAILURE_RHS_CALLS;
+    return GSL_EBADFUNC;
+  }
+  if (budget.Deadline > 0. && (budget.Calls & 255) == 0 && zikaClock() > budget.Deadline) {
+    budget.Failure = ZIKA_FAILURE_WALL_CLOCK;
+    return GSL_EBADFUNC;
+  }
+  return budget.Rhs(t, Y, dYdt, params);
+}
+
+//a step that GSL could not take ends the solve with a zika_solve_failure,
+//whose reason is the budget's if that is what stopped it
+static void zikaCheckStatus(int status, const zika_budget & budget)
+{
+  if (status == GSL_SUCCESS) return;
+  int reason = budget.Failure;
+  if (reason == 0) {
+    reason = (status == GSL_ENOPROG) ? ZIKA_FAILURE_MIN_STEP : ZIKA_FAILURE_SOLVER;
+  }
+  zikaCountSteps(1, 0, 0, 1);
+  throw zika_solve_failure(reason);
+}
+
+//true when every delta is within 'radius' of the deltas of the last solve
+static bool zikaIsNearby(const ode_workspace & ws, const dynamics_info & dyn,
+    const double * deltas)
+{
+  const unsigned int n_params = dyn.Params_factor * dyn.N_s;
+  if (ws.lastDeltas.size() != n_params) return false;
+  for (unsigned int i = 0; i < n_params; i++){
+    if (std::abs(deltas[i] - ws.lastDeltas[i]) > dyn.WarmStartRadius) return false;
+  }
+  return true;
+}
+
+//dense output: let the stepper of d take the steps its controller picks
+//all the way to the last output time, from t, and fill the output times
+//in between by cubic Hermite interpolation of the state and its derivative
+//at both ends of each accepted step. h is the initial step size on entry,
+//and the step size after the first accepted step on return. Returns the
+//number of output times stored, as zikaComputeModel.
+static unsigned int zikaDenseSolve(
+  gsl_odeiv2_driver *         d,
+  const zika_budget &         budget,
+  double                      minStep,
+  const std::vector<double>&  timePoints,
+  double                      t,
+  double                      Y[],
+  double &                    h,
+  std::vector<double>&        returnValues,
+  zika_observer               observer,
+  void*                       context)
+{
+  const unsigned int dim = d->sys->dimension;
+  const unsigned int n_times = timePoints.size();
+  const double finalTime = timePoints[n_times - 1];
+  //most steppers already evaluate the derivative at the end of the step
+  //and leave it in the evolve object, the others get one more right-hand
+  //side call per step
+  const bool dydtOut = d->s->type->gives_exact_dydt_out;
+  double Y0[dim], F0[dim], F1[dim];
+  zikaCheckStatus(d->sys->function(t, Y, F1, d->sys->params), budget);
+  double hFirst = 0.;
+  unsigned int i = 1;
+  while (i < n_times) {
+    const double t0 = t;
+    std::copy(Y, Y + dim, Y0);
+    std::copy(F1, F1 + dim, F0);
+    int status = gsl_odeiv2_evolve_apply( d->e, d->c, d->s, d->sys,
+           &t, finalTime, &h, Y );
+    //no driver_apply here to check the minimum step size
+    if (status == GSL_SUCCESS && t < finalTime && std::abs(h) < minStep) {
+      status = GSL_ENOPROG;
+    }
+    zikaCheckStatus(status, budget);
+    if (hFirst == 0.) hFirst = h;
+    if (dydtOut) {
+      std::copy(d->e->dydt_out, d->e->dydt_out + dim, F1);
+    }
+    else {
+      zikaCheckStatus(d->sys->function(t, Y, F1, d->sys->params), budget);
+    }
+    // every output time this step went past
+    const double dt = t - t0;
+    for (; i < n_times && timePoints[i] <= t; i++){
+      const double s = (timePoints[i] - t0) / dt;
+      const double h00 = (1. + 2. * s) * (1. - s) * (1. - s);
+      const double h10 = s * (1. - s) * (1. - s);
+      const double h01 = s * s * (3. - 2. * s);
+      const double h11 = s * s * (s - 1.);
+      for (unsigned int j = 0; j < dim; j++){
+        returnValues[dim*i + j] = h00 * Y0[j] + h10 * dt * F0[j]
+                                + h01 * Y[j] + h11 * dt * F1[j];
+      }
+      if (observer && !observer(i, &returnValues[dim*i], context)) {
+        h = std::min(hFirst, timePoints[1] - timePoints[0]);
+        return i + 1;
+      }
+    }
+  }
+  h = std::min(hFirst, timePoints[1] - timePoints[0]);
+  return n_times;
+}
+
 void zikaComputeModel(
-  std::vector<double>&  initialValues,
-  std::vector<double>&  timePoints,
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
   dynamics_info*        dyn,
   std::vector<double>&  returnValues)
+{
+  zikaComputeModel(initialValues, timePoints, dyn, &dyn->Deltas[0], returnValues);
+}
+
+void zikaComputeModel(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info*  dyn,
+  const double*         deltas,
+  std::vector<double>&  returnValues)
+{
+  zikaComputeModel(initialValues, timePoints, dyn, deltas, returnValues, NULL, NULL);
+}
+
+unsigned int zikaComputeModel(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info*  dyn,
+  const double*         deltas,
+  std::vector<double>&  returnValues,
+  zika_observer         observer,
+  void*                 context)
 {  
   // Compute model
   // GSL prep
   unsigned int dim = initialValues.size();
   unsigned int n_s = dim - 1;
-  gsl_odeiv2_system sys = { zikaFunction, 
-			   zikaJacobian, 
-			   dim, dyn };
+  // dyn is only read, the deltas of this evaluation travel next to it, so
+  // concurrent solves on different threads do not share any state
+  zika_budget budget;
+  zikaStartBudget(budget, *dyn, dyn->Rhs ? dyn->Rhs : zikaFunction);
+  zika_system system = { dyn, deltas, &budget };
+  ode_workspace & ws = zikaWorkspace;
+  ws.sys.function = zikaBudgetedRhs;
+  ws.sys.jacobian = dyn->Jac ? dyn->Jac : zikaJacobian;
+  ws.sys.dimension = dim;
+  ws.sys.params = &system;
   
   double h = 1e-10;    //initial step-size
-  gsl_odeiv2_driver * d = gsl_odeiv2_driver_alloc_y_new( &sys, gsl_odeiv2_step_rkf45,h,1e-8,1e-4);   
+  if (ws.driver == NULL || ws.dim != dim || ws.solver != dyn->Solver ||
+      ws.scaled != dyn->ScaledTolerance) {
+    zikaAllocDriver(ws, *dyn, dim, dyn->Solver, h);
+  }
+  // warm start from the last solve if its deltas were close to these
+  if (dyn->WarmStart && ws.lastH > 0. && zikaIsNearby(ws, *dyn, deltas)) {
+    h = ws.lastH;
+  }
+  gsl_odeiv2_driver * d = ws.driver;
+  gsl_odeiv2_driver_reset_hstart( d, h );
+  gsl_odeiv2_driver_set_hmin( d, dyn->MinStep );
   // initialize values
   double Y[dim];
   for (unsigned int i = 0; i < dim; ++i){
     Y[i] = initialValues[i];
     returnValues[i] = initialValues[i];
   };
-  double t = 7.0;
+  if (observer && !observer(0, &returnValues[0], context)) {
+    return 1;
+  }
+  unsigned int n_done = timePoints.size();
+  // from the first output time, day 7 for a whole season, a later week when
+  // a particle filter carries a state forward (src/smc.cpp)
+  double t = timePoints[0];
+  if (dyn->DenseOutput && n_done > 1) {
+    n_done = zikaDenseSolve(d, budget, dyn->MinStep, timePoints, t, Y, h,
+        returnValues, observer, context);
+    zikaCountSteps(1, d->e->count, d->e->failed_steps);
+    if (dyn->WarmStart) {
+      ws.lastH = h;
+      ws.lastDeltas.assign(deltas, deltas + dyn->Params_factor * dyn->N_s);
+    }
+    return n_done;
+  }
   double prevt;
   double sumY;
 //  std::cout << "Starting Integration..." << std::endl;
@@ -167,30 +621,143 @@ void zikaComputeModel(
         //std::cout<<"T = "<<Y[n_species]<<"\n";
 //        for( i = 0; i<7;i++) sumY+=Y[i];
 //        std::cout<<"N = "<<sumY<<"\n";
-        // check that the evolution was successful
-        #ifdef UQ_FATAL_TEST_MACRO
-          UQ_FATAL_TEST_MACRO( status != GSL_SUCCESS,
-             0,
-             "ZIKA",
-             "The status of GSL integration != GSL_SUCCESS" );
-        #else 
-          if ( status != GSL_SUCCESS )
-          {
-     //       std::cout<< "h approx = " << t-prevt<<"\n\n";
-            std::cout << "ERROR: status of GSL integration != GSL_SUCCESS" <<
-              std::endl;
-            assert( status == GSL_SUCCESS );
-          }
-        #endif
+        // check that the evolution was successful, give the solve up
+        // (zika_solve_failure) if not
+        zikaCheckStatus(status, budget);
       }
     //  std::cout << " h is " << h << std::endl;
     // save results, right now return values are all the species of the reduced
     // model
     for (unsigned int j = 0; j < dim; j++){
       returnValues[dim*i +j] = Y[j];}
+    // step size the controller settled on over the first output interval
+    if (i == 1) {
+      h = std::min(d->h, timePoints[1] - timePoints[0]);
+    }
+    // the caller has seen enough, e.g. a proposal that is already rejected
+    if (observer && !observer(i, &returnValues[dim*i], context)) {
+      n_done = i + 1;
+      break;
+    }
   }
+  zikaCountSteps(1, d->e->count, d->e->failed_steps);
   // std::cout << "C = " << Y[7] << std::endl;
   // std::cout << "O2 = " << Y[1] << std::endl;
-  // deallocate memory
-  gsl_odeiv2_driver_free( d );
+  // keep the driver for the next solve, remember where this one started
+  if (dyn->WarmStart && n_done > 1) {
+    ws.lastH = h;
+    ws.lastDeltas.assign(deltas, deltas + dyn->Params_factor * dyn->N_s);
+  }
+  return n_done;
+}
+
+void zikaComputeModelFixedStep(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info*  dyn,
+  const double*         deltas,
+  unsigned int          stepsPerInterval,
+  std::vector<double>&  returnValues)
+{
+  const unsigned int dim = initialValues.size();
+  int (*rhs)(double, const double[], double[], void*) = dyn->Rhs ? dyn->Rhs : zikaFunction;
+  //no budget: the number of right-hand side calls is fixed
+  zika_system system = { dyn, deltas, NULL };
+  double Y[dim], Z[dim], k1[dim], k2[dim], k3[dim], k4[dim];
+  for (unsigned int i = 0; i < dim; ++i){
+    Y[i] = initialValues[i];
+    returnValues[i] = initialValues[i];
+  }
+  double t = timePoints[0];
+  for (unsigned int j = 1; j < timePoints.size(); j++){
+    const double h = (timePoints[j] - timePoints[j - 1]) / stepsPerInterval;
+    for (unsigned int s = 0; s < stepsPerInterval; s++){
+      //classical Runge-Kutta
+      rhs(t, Y, k1, &system);
+      for (unsigned int i = 0; i < dim; i++) Z[i] = Y[i] + 0.5 * h * k1[i];
+      rhs(t + 0.5 * h, Z, k2, &system);
+      for (unsigned int i = 0; i < dim; i++) Z[i] = Y[i] + 0.5 * h * k2[i];
+      rhs(t + 0.5 * h, Z, k3, &system);
+      for (unsigned int i = 0; i < dim; i++) Z[i] = Y[i] + h * k3[i];
+      rhs(t + h, Z, k4, &system);
+      for (unsigned int i = 0; i < dim; i++){
+        Y[i] += h / 6. * (k1[i] + 2. * (k2[i] + k3[i]) + k4[i]);
+      }
+      t = timePoints[j - 1] + (s + 1) * h;
+    }
+    t = timePoints[j];
+    for (unsigned int i = 0; i < dim; i++){
+      //a step too long for the dynamics blows up instead of failing
+      if (!std::isfinite(Y[i])) {
+        zikaCountSteps(1, (j - 1) * stepsPerInterval, 0, 1);
+        throw zika_solve_failure(ZIKA_FAILURE_SOLVER);
+      }
+      returnValues[dim*j + i] = Y[i];
+    }
+  }
+  zikaCountSteps(1, (timePoints.size() - 1) * stepsPerInterval, 0);
+}
+
+//second driver per thread for the sensitivity solves, whose dimension
+//differs from the state solves that share zikaWorkspace
+static thread_local ode_workspace zikaSensWorkspace;
+
+bool zikaComputeSensitivities(
+  const std::vector<double>&  initialValues,
+  const std::vector<double>&  timePoints,
+  const dynamics_info*  dyn,
+  const double*         deltas,
+  std::vector<double>&  returnValues,
+  std::vector<double>&  sensitivities)
+{
+  if (dyn->SensRhs == NULL) return false;
+
+  const unsigned int dim = initialValues.size();
+  const unsigned int np = dyn->Params_factor * dyn->N_s;
+  const unsigned int dimZ = dim * (1 + np);
+  zika_budget budget;
+  zikaStartBudget(budget, *dyn, dyn->SensRhs);
+  zika_system system = { dyn, deltas, &budget };
+  ode_workspace & ws = zikaSensWorkspace;
+  ws.sys.function = zikaBudgetedRhs;
+  ws.sys.jacobian = NULL;
+  ws.sys.dimension = dimZ;
+  ws.sys.params = &system;
+
+  //there is no jacobian of the augmented system, the implicit steppers
+  //fall back to rkf45 here
+  const unsigned int solver =
+    (dyn->Solver == ZIKA_SOLVER_RK8PD) ? ZIKA_SOLVER_RK8PD : ZIKA_SOLVER_RKF45;
+  double h = 1e-10;    //initial step-size
+  if (ws.driver == NULL || ws.dim != dimZ || ws.solver != solver ||
+      ws.scaled != dyn->ScaledTolerance) {
+    zikaAllocDriver(ws, *dyn, dimZ, solver, h);
+  }
+  gsl_odeiv2_driver * d = ws.driver;
+  gsl_odeiv2_driver_reset_hstart( d, h );
+  gsl_odeiv2_driver_set_hmin( d, dyn->MinStep );
+
+  // the initial values do not depend on the deltas: S(t0) = 0
+  double Z[dimZ];
+  for (unsigned int i = 0; i < dimZ; ++i){
+    Z[i] = (i < dim) ? initialValues[i] : 0.;
+  }
+  for (unsigned int i = 0; i < dim; ++i){
+    returnValues[i] = initialValues[i];
+  }
+  std::fill(sensitivities.begin(), sensitivities.begin() + dim * np, 0.);
+
+  double t = timePoints[0];
+  for (unsigned int i = 1; i < timePoints.size(); i++){
+    const double finalTime = timePoints[i];
+    while (t < finalTime)
+      {
+        int status = gsl_odeiv2_driver_apply( d, &t, finalTime, Z );
+        zikaCheckStatus(status, budget);
+      }
+    for (unsigned int j = 0; j < dim; j++){
+      returnValues[dim*i +j] = Z[j];}
+    std::copy(Z + dim, Z + dimZ, sensitivities.begin() + dim * np * i);
+  }
+  return true;
 }
@@ -0,0 +1,413 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the Monte Carlo engine for the parameter and
+ * initial condition uncertainty of the SEIR-SEI model, the C++
+ * counterpart of UncertaintyQuantification/main_SEIR_SEI_MC_example*.m.
+ *-----------------------------------------------------------------*/
+
+#include "montecarlo.h"
+#include "model.h"
+#include "options.h"
+#include "binfile.h"
+#include "maxent.h"
+#include "convergence.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+static const char* zikaMcInputNames[ZIKA_MC_INPUTS] = {
+  "N", "betaH", "alphaH", "gamma", "betaV", "alphaV", "delta",
+  "EH0", "IH0", "RH0", "EV0", "IV0", "C0"
+};
+
+const char* zikaMcInputName(unsigned int i)
+{
+  return (i < ZIKA_MC_INPUTS) ? zikaMcInputNames[i] : "";
+}
+
+//Constructor
+zika_random_input::zika_random_input()
+: Type(ZIKA_DIST_FIXED),
+  A(0.),
+  B(0.),
+  C(0.),
+  Lambda(0.)
+{
+}
+
+//Destructor
+zika_random_input::~zika_random_input()
+{
+}
+
+//relative mean of the exponential of rate u/(b-a) truncated to [a, b],
+//(mean - a)/(b - a) = 1/u - 1/(exp(u) - 1), decreasing from 1 to 0
+static double zikaTruncExpMean(double u)
+{
+  if (std::fabs(u) < 1.e-6) return 0.5 - u / 12.;
+  return 1. / u - 1. / std::expm1(u);
+}
+
+bool zika_random_input::parse(const std::string& text)
+{
+  std::istringstream stream(text);
+  std::string name;
+  stream >> name;
+  double values[3] = { 0., 0., 0. };
+  unsigned int n = 0;
+  while (n < 3 && (stream >> values[n])) n++;
+  A = values[0]; B = values[1]; C = values[2];
+  Lambda = 0.;
+  if      (name == "fixed"     && n == 1) { Type = ZIKA_DIST_FIXED; }
+  else if (name == "uniform"   && n == 2 && A <= B) { Type = ZIKA_DIST_UNIFORM; }
+  else if (name == "normal"    && n == 2 && B >= 0.) { Type = ZIKA_DIST_NORMAL; }
+  else if (name == "lognormal" && n == 2 && A > 0. && B >= 0.) { Type = ZIKA_DIST_LOGNORMAL; }
+  else if (name == "gamma"     && n == 2 && A > 0. && B > 0.) { Type = ZIKA_DIST_GAMMA; }
+  else if (name == "maxent"    && n == 3 && A < C && C < B) {
+    //the maximum entropy density on [A, B] with mean C is c exp(-Lambda x),
+    //Lambda found by bisection on the mean, in units of 1/(B - A)
+    Type = ZIKA_DIST_MAXENT;
+    const double target = (C - A) / (B - A);
+    double lo = -700., hi = 700.;
+    for (unsigned int it = 0; it < 200; it++){
+      const double u = 0.5 * (lo + hi);
+      if (zikaTruncExpMean(u) > target) lo = u;
+      else hi = u;
+    }
+    Lambda = 0.5 * (lo + hi) / (B - A);
+  }
+  else return false;
+  return true;
+}
+
+//Marsaglia and Tsang's method, shape k >= 1 (k < 1 through k + 1)
+static double zikaGamma(double k, zika_philox& rng)
+{
+  if (k < 1.) return zikaGamma(k + 1., rng) * std::pow(rng.uniform(), 1. / k);
+  const double d = k - 1. / 3., c = 1. / std::sqrt(9. * d);
+  for (;;) {
+    double x, v;
+    do {
+      x = rng.normal();
+      v = 1. + c * x;
+    } while (v <= 0.);
+    v = v * v * v;
+    const double u = rng.uniform();
+    if (std::log(u) < 0.5 * x * x + d - d * v + d * std::log(v)) return d * v;
+  }
+}
+
+double zika_random_input::sample(zika_philox& rng) const
+{
+  switch (Type) {
+    case ZIKA_DIST_UNIFORM:
+      return A + (B - A) * rng.uniform();
+    case ZIKA_DIST_NORMAL:
+      return A + B * rng.normal();
+    case ZIKA_DIST_LOGNORMAL: {
+      //A and B are the mean and std of the lognormal itself
+      const double s2 = std::log1p(B * B / (A * A));
+      return std::exp(std::log(A) - 0.5 * s2 + std::sqrt(s2) * rng.normal());
+    }
+    case ZIKA_DIST_GAMMA:
+      return B * zikaGamma(A, rng);
+    case ZIKA_DIST_MAXENT: {
+      //inverse of the truncated exponential CDF
+      const double u = Lambda * (B - A);
+      if (std::fabs(u) < 1.e-12) return A + (B - A) * rng.uniform();
+      return A - std::log1p(rng.uniform() * std::expm1(-u)) / Lambda;
+    }
+    default:
+      return A;
+  }
+}
+
+//Constructor
+mc_problem::mc_problem(const char* fileName)
+:
+  Samples(1024),
+  Seed(30081984),
+  NWeeks(52),
+  Solver(ZIKA_SOLVER_RKF45),
+  MaxRhsCalls(2000000),
+  BlockSize(1024),
+  Tolerance(0.),
+  MinSamples(2000),
+  Output("outputData/mc_seir_sei.zbin"),
+  MaxEntMoments(4),
+  MaxEntPoints(201),
+  MaxEntOutput("outputData/mc_seir_sei-maxent"),
+  Ok(true)
+{
+  //nominal values of the Brazil 2016 outbreak, as in the MATLAB examples
+  //(Dantas, Tosin & Cunha Jr, 2018)
+  const double nominal[ZIKA_MC_INPUTS] = {
+    206.e6, 1. / 8.33, 1. / 12., 1. / 3., 1. / 7.77, 1. / 10., 1. / 18.,
+    6827., 10000., 29639., 4.14e-4, 0., 8201.
+  };
+  for (unsigned int i = 0; i < ZIKA_MC_INPUTS; i++) Inputs[i].A = nominal[i];
+
+  std::ifstream file(fileName);
+  if (!file) {
+    std::cout << "WARNING: could not open " << fileName << ", using the defaults" << std::endl;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    //strip comments, then split on the first '='; the value is the whole
+    //rest of the line, distributions take several words
+    std::string::size_type pos = line.find('#');
+    if (pos != std::string::npos) line.erase(pos);
+    pos = line.find('=');
+    if (pos == std::string::npos) continue;
+    std::string key, value = line.substr(pos + 1);
+    std::istringstream(line.substr(0, pos)) >> key;
+    const std::string::size_type first = value.find_first_not_of(" \t");
+    const std::string::size_type last = value.find_last_not_of(" \t\r");
+    if (key.empty() || first == std::string::npos) continue;
+    value = value.substr(first, last - first + 1);
+
+    bool known = true;
+    if      (key == "mc_samples")     { Samples = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "mc_seed")        { Seed = std::strtoull(value.c_str(), NULL, 10); }
+    else if (key == "mc_nWeeks")      { NWeeks = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "mc_maxRhsCalls") { MaxRhsCalls = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "mc_blockSize")   { BlockSize = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "mc_tolerance")   { Tolerance = std::strtod(value.c_str(), NULL); }
+    else if (key == "mc_minSamples")  { MinSamples = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "mc_output")      { Output = value; }
+    else if (key == "mc_maxentMoments") { MaxEntMoments = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "mc_maxentPoints")  { MaxEntPoints = std::strtoul(value.c_str(), NULL, 10); }
+    else if (key == "mc_maxentOutput")  { MaxEntOutput = value; }
+    else if (key == "mc_solver")      { known = zikaParseSolver(value, Solver); }
+    else {
+      known = false;
+      for (unsigned int i = 0; i < ZIKA_MC_INPUTS; i++){
+        if (key == std::string("mc_") + zikaMcInputNames[i]) {
+          known = Inputs[i].parse(value);
+          break;
+        }
+      }
+    }
+    if (!known) {
+      std::cout << "WARNING: could not use '" << key << " = " << value << "'" << std::endl;
+      Ok = false;
+    }
+  }
+  if (NWeeks < 2) NWeeks = 2;
+  if (BlockSize == 0) BlockSize = 1024;
+  if (MaxEntPoints < 2) MaxEntPoints = 201;
+}
+
+//Destructor
+mc_problem::~mc_problem()
+{
+}
+
+void zikaDrawInputs(const mc_problem& problem, uint64_t s, double inputs[])
+{
+  for (unsigned int i = 0; i < ZIKA_MC_INPUTS; i++){
+    zika_philox rng(problem.Seed, s, i);
+    inputs[i] = problem.Inputs[i].sample(rng);
+  }
+}
+
+bool zikaSolveSample(
+  const double                  inputs[],
+  const std::vector<double>&    timePoints,
+  dynamics_info&                dyn,
+  std::vector<double>&          returnValues,
+  double                        newCases[],
+  double                        cumCases[])
+{
+  const unsigned int n_weeks = timePoints.size();
+  const unsigned int dim = dyn.N_s + 1;
+  dyn.Nh = inputs[ZIKA_MC_N];
+  dyn.Bh = inputs[ZIKA_MC_BETAH];
+  dyn.Ah = inputs[ZIKA_MC_ALPHAH];
+  dyn.G  = inputs[ZIKA_MC_GAMMA];
+  dyn.Bv = inputs[ZIKA_MC_BETAV];
+  dyn.Av = inputs[ZIKA_MC_ALPHAV];
+  dyn.D  = inputs[ZIKA_MC_DELTA];
+  dyn.Nv = 1.;    //the vectors are proportions
+
+  std::vector<double> initialValues(dim, 0.);
+  initialValues[0] = inputs[ZIKA_MC_N] - inputs[ZIKA_MC_EH0] - inputs[ZIKA_MC_IH0]
+                   - inputs[ZIKA_MC_RH0];
+  initialValues[1] = inputs[ZIKA_MC_EH0];
+  initialValues[2] = inputs[ZIKA_MC_IH0];
+  initialValues[3] = inputs[ZIKA_MC_RH0];
+  initialValues[4] = 1. - inputs[ZIKA_MC_EV0] - inputs[ZIKA_MC_IV0];
+  initialValues[5] = inputs[ZIKA_MC_EV0];
+  initialValues[6] = inputs[ZIKA_MC_IV0];
+  initialValues[7] = inputs[ZIKA_MC_C0];
+
+  try{
+    zikaComputeModel(initialValues, timePoints, &dyn, &dyn.Deltas[0], returnValues);
+  }
+  catch (const zika_solve_failure&) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::fill(newCases, newCases + n_weeks, nan);
+    std::fill(cumCases, cumCases + n_weeks, nan);
+    return false;
+  }
+  for (unsigned int j = 0; j < n_weeks; j++){
+    cumCases[j] = returnValues[dim * j + 7];
+    newCases[j] = (j == 0) ? cumCases[0] : cumCases[j] - cumCases[j - 1];
+  }
+  return true;
+}
+
+mc_summary zikaRunMonteCarlo(const mc_problem& problem)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const unsigned int n_weeks = problem.NWeeks;
+  const unsigned int n_cols = ZIKA_MC_INPUTS + 2 * n_weeks;
+  const unsigned int blockSize = problem.BlockSize;
+
+  std::vector<std::string> names;
+  for (unsigned int i = 0; i < ZIKA_MC_INPUTS; i++) names.push_back(zikaMcInputNames[i]);
+  char name[__ZIKA_BIN_NAME];
+  for (unsigned int j = 0; j < n_weeks; j++){
+    snprintf(name, sizeof(name), "NC_w%u", j);
+    names.push_back(name);
+  }
+  for (unsigned int j = 0; j < n_weeks; j++){
+    snprintf(name, sizeof(name), "C_w%u", j);
+    names.push_back(name);
+  }
+  zika_bin_writer writer(problem.Output.c_str(), names, problem.Samples, n_weeks, 2, 1.);
+
+  std::vector<double> timePoints(n_weeks);
+  for (unsigned int j = 0; j < n_weeks; j++) timePoints[j] = 7. * (j + 1);
+
+  mc_summary summary = { 0, 0, 0., 0., 0., false };
+  double sumFinal = 0.;
+  mc_convergence convergence(problem.Tolerance, problem.MinSamples);
+  FILE * convFile = NULL;
+  if (problem.Tolerance > 0.) {
+    std::string convName = problem.Output;
+    const std::string::size_type dot = convName.rfind('.');
+    if (dot != std::string::npos && convName.find('/', dot) == std::string::npos) convName.erase(dot);
+    convName += ".conv.txt";
+    convFile = fopen(convName.c_str(), "w");
+  }
+  std::vector<double> block(blockSize * n_cols, 0.);
+  std::vector<int> solved(blockSize, 0);
+  for (unsigned int first = 0; first < problem.Samples; first += blockSize){
+    const unsigned int n_block = std::min(blockSize, problem.Samples - first);
+    #pragma omp parallel
+    {
+      //every thread its own model description; inadequacy type 0 is the
+      //plain SEIR-SEI model of rhs_SEIR_SEI.m, the deltas stay zero
+      unsigned int n_s = 7, inad_type = 0, params_factor = 1;
+      std::vector<double> deltas(n_s, 0.);
+      dynamics_info dyn(n_s, n_weeks, inad_type, params_factor, deltas);
+      zikaSelectKernel(&dyn);
+      dyn.Solver = problem.Solver;
+      dyn.MaxRhsCalls = problem.MaxRhsCalls;
+      //no warm start and no wall-clock budget: either would make a sample
+      //depend on the thread, or the machine, that solved it
+      dyn.WarmStart = 0;
+      dyn.MaxSeconds = 0.;
+      std::vector<double> returnValues(n_weeks * (n_s + 1), 0.);
+
+      #pragma omp for schedule(dynamic, 8)
+      for (int r = 0; r < (int) n_block; r++){
+        double * row = &block[r * n_cols];
+        zikaDrawInputs(problem, first + r, row);
+        solved[r] = zikaSolveSample(row, timePoints, dyn, returnValues,
+            row + ZIKA_MC_INPUTS, row + ZIKA_MC_INPUTS + n_weeks) ? 1 : 0;
+      }
+    }
+    //in sample order, so the sums do not depend on the threads either
+    double quantities[ZIKA_CONV_QUANTITIES];
+    for (unsigned int r = 0; r < n_block; r++){
+      if (solved[r]) {
+        sumFinal += block[r * n_cols + n_cols - 1];
+        zikaConvQuantities(&block[r * n_cols + ZIKA_MC_INPUTS + n_weeks], 1, n_weeks, quantities);
+        convergence.add(quantities);
+      }
+      else summary.Failed++;
+    }
+    summary.Samples += n_block;
+    if (writer.ok() && !writer.append(&block[0], n_block)) {
+      printf("WARNING: could not write %s\n", problem.Output.c_str());
+    }
+    if (convFile) convergence.write(convFile, first == 0);
+    if (convergence.converged()) break;
+  }
+  if (convFile) fclose(convFile);
+  summary.RelativeError = convergence.worstError();
+  summary.Converged = convergence.converged();
+
+  const unsigned int n_solved = summary.Samples - summary.Failed;
+  summary.MeanFinalCases = n_solved ? sumFinal / n_solved : 0.;
+  summary.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return summary;
+}
+
+int zikaMcMaxEnt(const mc_problem& problem)
+{
+  zika_bin_reader reader(problem.Output.c_str());
+  if (!reader.ok() || reader.cols() < ZIKA_MC_INPUTS + 2 * problem.NWeeks) {
+    printf("WARNING: could not read %s\n", problem.Output.c_str());
+    return -1;
+  }
+  //the new and cumulative cases are the columns after the inputs, side by
+  //side in the file: one strided view of all of them
+  const unsigned int n_vars = 2 * problem.NWeeks;
+  maxent_settings settings;
+  settings.Moments = problem.MaxEntMoments;
+  settings.Points = problem.MaxEntPoints;
+  std::vector<maxent_density> densities;
+  zikaMaxEntDensities(reader.column(ZIKA_MC_INPUTS), reader.rows(), n_vars, 1,
+      reader.header().Capacity, settings, densities);
+
+  const std::string textName = problem.MaxEntOutput + ".txt";
+  FILE * file = fopen(textName.c_str(), "w");
+  if (!file) {
+    printf("WARNING: could not write %s\n", textName.c_str());
+    return -1;
+  }
+  fprintf(file, "# maximum entropy densities of %s, %u moments, %u points\n",
+      problem.Output.c_str(), settings.Moments, settings.Points);
+  fprintf(file, "# name xmin xmax converged iterations entropy lambda_0..lambda_%u (of t = (2x - xmin - xmax)/(xmax - xmin))\n",
+      settings.Moments - 1);
+  int failed = 0;
+  std::vector<std::string> names(n_vars);
+  for (unsigned int v = 0; v < n_vars; v++){
+    const maxent_density & d = densities[v];
+    names[v] = reader.name(ZIKA_MC_INPUTS + v);
+    if (!d.Converged && !d.Degenerate) failed++;
+    fprintf(file, "%s %.9e %.9e %d %u %.9e", names[v].c_str(), d.XMin, d.XMax,
+        d.Converged ? 1 : 0, d.Iterations, d.Entropy);
+    for (unsigned int n = 0; n < d.Lambda.size(); n++) fprintf(file, " %.9e", d.Lambda[n]);
+    fprintf(file, "\n");
+  }
+  fclose(file);
+
+  //densities as the rows of a .zbin file, point j of column v at
+  //XMin + j (XMax - XMin)/(Points - 1)
+  const std::string binName = problem.MaxEntOutput + ".zbin";
+  zika_bin_writer writer(binName.c_str(), names, settings.Points, problem.NWeeks, 2, 1.);
+  std::vector<double> rows(settings.Points * n_vars);
+  for (unsigned int v = 0; v < n_vars; v++){
+    for (unsigned int j = 0; j < settings.Points; j++) rows[j * n_vars + v] = densities[v].Pdf[j];
+  }
+  if (!writer.ok() || !writer.append(&rows[0], settings.Points)) {
+    printf("WARNING: could not write %s\n", binName.c_str());
+    return -1;
+  }
+  return failed;
+}
@@ -0,0 +1,215 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ * 
+ * This file contains the code reading the zika run options.
+ *-----------------------------------------------------------------*/
+
+#include "options.h"
+#include "dynamics_info.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+//Constructor
+zika_options::zika_options(const char* fileName, const char* quesoFileName)
+:
+  Solver(ZIKA_SOLVER_RKF45),
+  WarmStart(0),
+  WarmStartRadius(0.05),
+  DenseOutput(0),
+  ScaledTolerance(0),
+  PositivityWidth(0.),
+  MaxRhsCalls(0),
+  MinStep(0.),
+  MaxSeconds(0.),
+  FailureLogLikelihood(-500000.),
+  SfpBatch(0),
+  SfpSamples(20000),
+  SfpTolerance(0.),
+  SfpMinSamples(2000),
+  SfpMlmc(0),
+  MlmcLevels(3),
+  MlmcCoarseSteps(2),
+  MlmcTolerance(0.005),
+  MlmcInitialSamples(256),
+  MlmcMaxSamples(1000000),
+  MlmcGrid(256),
+  Sampler(ZIKA_SAMPLER_QUESO),
+  NChains(1),
+  ChainLength(10000),
+  ProposalStd(0.01),
+  FilterLag(20),
+  Seed(1),
+  MaxTemp(10.),
+  ExchangeInterval(10),
+  EarlyStop(1),
+  SurrogateInterval(300),
+  MapSeed(0),
+  BinaryOutput(0),
+  QoiStats(0),
+  QoiNoise(0),
+  DiagnosticsPeriod(100),
+  TargetEss(0.),
+  TargetRhat(1.01),
+  SmcParticles(2000),
+  SmcEssFraction(0.5),
+  SmcMoves(5),
+  SmcState("outputData/smc_state"),
+  SmcForecast(1),
+  Data("./inputs/data.txt"),
+  NWeeks(0),
+  RepFactor(1.),
+  Var(25000000.),
+  SweepEssFraction(0.1),
+  SweepStore("outputData/sip_sweep_samples.zbin")
+{
+  //QUESO's keys all start with its prefixes, none clashes with a zika_ one
+  if (quesoFileName) parse(quesoFileName);
+  parse(fileName);
+
+  read("ip_mh_rawChain_displayPeriod", DiagnosticsPeriod);
+  read("fp_mc_qseq_size", SfpSamples);
+
+  read("zika_warmStart", WarmStart);
+  read("zika_warmStartRadius", WarmStartRadius);
+  read("zika_denseOutput", DenseOutput);
+  read("zika_scaledTolerance", ScaledTolerance);
+  read("zika_positivityWidth", PositivityWidth);
+  read("zika_maxRhsCalls", MaxRhsCalls);
+  read("zika_minStep", MinStep);
+  read("zika_maxSeconds", MaxSeconds);
+  read("zika_failureLogLikelihood", FailureLogLikelihood);
+  read("zika_sfpBatch", SfpBatch);
+  read("zika_sfpSamples", SfpSamples);
+  read("zika_sfpTolerance", SfpTolerance);
+  read("zika_sfpMinSamples", SfpMinSamples);
+  read("zika_sfpMlmc", SfpMlmc);
+  read("zika_mlmcLevels", MlmcLevels);
+  read("zika_mlmcCoarseSteps", MlmcCoarseSteps);
+  read("zika_mlmcTolerance", MlmcTolerance);
+  read("zika_mlmcInitialSamples", MlmcInitialSamples);
+  read("zika_mlmcMaxSamples", MlmcMaxSamples);
+  read("zika_mlmcGrid", MlmcGrid);
+  read("zika_nChains", NChains);
+  read("zika_chainLength", ChainLength);
+  read("zika_proposalStd", ProposalStd);
+  read("zika_filterLag", FilterLag);
+  read("zika_seed", Seed);
+  read("zika_maxTemp", MaxTemp);
+  read("zika_exchangeInterval", ExchangeInterval);
+  read("zika_earlyStop", EarlyStop);
+  read("zika_surrogateInterval", SurrogateInterval);
+  read("zika_mapSeed", MapSeed);
+  read("zika_binaryOutput", BinaryOutput);
+  read("zika_qoiStats", QoiStats);
+  read("zika_qoiNoise", QoiNoise);
+  read("zika_diagnosticsPeriod", DiagnosticsPeriod);
+  read("zika_targetEss", TargetEss);
+  read("zika_targetRhat", TargetRhat);
+  read("zika_smcParticles", SmcParticles);
+  read("zika_smcEssFraction", SmcEssFraction);
+  read("zika_smcMoves", SmcMoves);
+  read("zika_smcState", SmcState);
+  read("zika_smcForecast", SmcForecast);
+  if (SmcState == "none") SmcState.clear();
+  read("zika_data", Data);
+  read("zika_dataRegion", DataRegion);
+  read("zika_nWeeks", NWeeks);
+  read("zika_repFactor", RepFactor);
+  read("zika_var", Var);
+  read("zika_sweepRepFactors", SweepRepFactors);
+  read("zika_sweepVars", SweepVars);
+  read("zika_sweepEssFraction", SweepEssFraction);
+  read("zika_sweepStore", SweepStore);
+
+  std::string solver;
+  read("zika_solver", solver);
+  if (!solver.empty() && !zikaParseSolver(solver, Solver)) {
+    std::cout << "WARNING: unknown zika_solver '" << solver
+              << "', using rkf45" << std::endl;
+  }
+
+  std::string sampler;
+  read("zika_sampler", sampler);
+  if      (sampler == "queso")   { Sampler = ZIKA_SAMPLER_QUESO; }
+  else if (sampler == "threads") { Sampler = ZIKA_SAMPLER_THREADS; }
+  else if (sampler == "population") { Sampler = ZIKA_SAMPLER_POPULATION; }
+  else if (sampler == "mala")    { Sampler = ZIKA_SAMPLER_MALA; }
+  else if (sampler == "delayed") { Sampler = ZIKA_SAMPLER_DELAYED; }
+  else if (sampler == "smc")     { Sampler = ZIKA_SAMPLER_SMC; }
+  else if (!sampler.empty()) {
+    std::cout << "WARNING: unknown zika_sampler '" << sampler
+              << "', using queso" << std::endl;
+  }
+  if (NChains == 0) NChains = 1;
+  if (ChainLength == 0) ChainLength = 1;
+}
+
+//Destructor
+zika_options::~zika_options()
+{
+}
+
+bool zikaParseSolver(const std::string& name, unsigned int& solver)
+{
+  if      (name == "rkf45")  { solver = ZIKA_SOLVER_RKF45; }
+  else if (name == "rk8pd")  { solver = ZIKA_SOLVER_RK8PD; }
+  else if (name == "msbdf")  { solver = ZIKA_SOLVER_MSBDF; }
+  else if (name == "bsimp")  { solver = ZIKA_SOLVER_BSIMP; }
+  else if (name == "rk4imp") { solver = ZIKA_SOLVER_RK4IMP; }
+  else return false;
+  return true;
+}
+
+void zika_options::parse(const char* fileName)
+{
+  std::ifstream file(fileName);
+  std::string line;
+  while (std::getline(file, line)) {
+    //strip comments, then split on the first '='
+    std::string::size_type pos = line.find('#');
+    if (pos != std::string::npos) line.erase(pos);
+    pos = line.find('=');
+    if (pos == std::string::npos) continue;
+    std::string key, value;
+    std::istringstream(line.substr(0, pos)) >> key;
+    std::istringstream(line.substr(pos + 1)) >> value;
+    if (!key.empty() && !value.empty()) m_entries[key] = value;
+  }
+}
+
+void zika_options::read(const char* key, unsigned int & value) const
+{
+  std::map<std::string, std::string>::const_iterator it = m_entries.find(key);
+  if (it != m_entries.end()) value = std::strtoul(it->second.c_str(), NULL, 10);
+}
+
+void zika_options::read(const char* key, double & value) const
+{
+  std::map<std::string, std::string>::const_iterator it = m_entries.find(key);
+  if (it != m_entries.end()) value = std::strtod(it->second.c_str(), NULL);
+}
+
+void zika_options::read(const char* key, std::string & value) const
+{
+  std::map<std::string, std::string>::const_iterator it = m_entries.find(key);
+  if (it != m_entries.end()) value = it->second;
+}
+
+//comma separated, without spaces: the value is the first word
+void zika_options::read(const char* key, std::vector<double> & values) const
+{
+  std::map<std::string, std::string>::const_iterator it = m_entries.find(key);
+  if (it == m_entries.end()) return;
+  values.clear();
+  std::istringstream list(it->second);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    if (!item.empty()) values.push_back(std::strtod(item.c_str(), NULL));
+  }
+}
@@ -10,6 +10,7 @@
 
 #include "qoi.h"
 #include "model.h"
+#include "ensemble.h"
 #include "dynamics_info.h"
 #include <cmath>
 //------------------------------------------------------
@@ -24,7 +25,9 @@ qoiRoutine_Data::qoiRoutine_Data(
 : m_env(&env),
   m_times(times),
   m_ics(ics),
-  m_dynMain(dynInfo)
+  m_dynMain(dynInfo),
+  m_returnValues(dynInfo->N_times * (dynInfo->N_s + 1), 0.),
+  m_stats(NULL)
 {
 }
 
@@ -61,10 +64,8 @@ qoiRoutine(
     = ((qoiRoutine_Data *) functionDataPtr)->m_dynMain;
 
   const unsigned int n_s = dyn->N_s;          //the number of species included in the model
-  const unsigned int n_times = dyn->N_times;  //the number of time points in every time series of data
   const unsigned int pf = dyn->Params_factor;    //the number of initial conditions
   const unsigned int n_params = pf * n_s;      //the number of parameters to be calibrated
-  const unsigned int dim = n_s + 1;
 
   //set up lambda vector for loop, right now just one
   /* std::vector<double> phiPoints(n_phis,0.); */
@@ -72,24 +73,27 @@ qoiRoutine(
   /*   phiPoints[j] = phis[n_times * j]; */
   /* } */
 
-  std::vector<double> timePoints(n_times,0.);
-  for (unsigned int i = 0; i < n_times; i++){
-    timePoints[i] = times[i];
-  }
-
-  //return time points of all state variables + C
-  std::vector<double> returnValues(n_times * dim, 0.);
+  //return time points of all state variables + C, preallocated in the data
+  //struct
+  std::vector<double>& returnValues
+    = ((qoiRoutine_Data *) functionDataPtr)->m_returnValues;
 
   //std::cout << "hello in qoi----------------------------------\n";
   /* for (unsigned int i = 0; i < n_params; i++){  dyn->Deltas[i] = -std::exp(paramValues[i]); } */
+  //the deltas of this evaluation stay local, dyn is only read
+  //the inad_type 3 kernel reads two entries past the deltas
+  double deltas[n_params + 2];
+  deltas[n_params] = deltas[n_params + 1] = 0.;
   for (unsigned int i = 0; i < n_params; i++){  
-      /* dyn->Deltas[i] = -std::abs(paramValues[i]); */
-      dyn->Deltas[i] = paramValues[i];
+      /* deltas[i] = -std::abs(paramValues[i]); */
+      deltas[i] = paramValues[i];
   }
-  /* for (unsigned int i = 0; i < n_params; i++){  dyn->Deltas[i] = 0.; } */
+  /* for (unsigned int i = 0; i < n_params; i++){  deltas[i] = 0.; } */
 
   try{
-    zikaComputeModel(ics,timePoints,dyn,returnValues);
+    zikaComputeModel(ics,times,dyn,deltas,returnValues);
+    zika_qoi_stats * stats = ((qoiRoutine_Data *) functionDataPtr)->m_stats;
+    if (stats) stats->add(&returnValues[0]);
     //std::cout<< "qoi: ret val = " <<  returnValues[7 * 9 + 6] << std::endl; 
     for (unsigned int j = 0; j < returnValues.size(); j++){
       /* std::cout << "i = " << i << " and j = " << j << "\n"; */
@@ -97,13 +101,33 @@ qoiRoutine(
 //      std::cout << "returnValues[j] = " << returnValues[j] << "\n\n";
   //    std::cout << "j = " << j << "\n\n";
   }
-  }catch(int exception)
+  }catch(const zika_solve_failure & failure)
   {
+    //the solve was given up, the qois are zero as for a failed sample of
+    //qoiRoutineBatch
     for (unsigned int j = 0; j < returnValues.size(); j++){
-      /* std::cout << "i = " << i << " and j = " << j << "\n"; */
-        //qoiValues same as returnValues here
-      qoiValues[j] = returnValues[j];}
+      qoiValues[j] = 0.;}
     }
 
   return;
 }
+
+void
+qoiRoutineBatch(
+  const std::vector<double>& paramValues,
+  unsigned int               n_samples,
+  const void*                functionDataPtr,
+  std::vector<double>&       qoiValues)
+{
+  qoiRoutine_Data * data = (qoiRoutine_Data *) functionDataPtr;
+
+  //rows of failed samples are left at zero by the ensemble integrator
+  zikaComputeEnsemble(data->m_ics, data->m_times, data->m_dynMain, paramValues,
+      n_samples, qoiValues, data->m_batchStatus);
+  if (data->m_stats) {
+    const unsigned int n_qoi = data->m_times.size() * (data->m_dynMain->N_s + 1);
+    for (unsigned int s = 0; s < n_samples; s++){
+      if (data->m_batchStatus[s] == 0) data->m_stats->add(&qoiValues[s * n_qoi]);
+    }
+  }
+}
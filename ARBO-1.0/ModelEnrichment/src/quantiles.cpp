@@ -0,0 +1,205 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the streaming quantile sketch used for the
+ * statistics of the qois of the statistical forward problem.
+ *-----------------------------------------------------------------*/
+
+#include "quantiles.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+//Constructor
+zika_tdigest::zika_tdigest(double compression)
+: m_compression(compression),
+  m_weight(0.),
+  m_bufferWeight(0.),
+  m_min(std::numeric_limits<double>::infinity()),
+  m_max(-std::numeric_limits<double>::infinity())
+{
+}
+
+//Destructor
+zika_tdigest::~zika_tdigest()
+{
+}
+
+void zika_tdigest::add(double x, double weight)
+{
+  if (!(weight > 0.) || std::isnan(x)) return;
+  m_bufferMeans.push_back(x);
+  m_bufferWeights.push_back(weight);
+  m_bufferWeight += weight;
+  m_min = std::min(m_min, x);
+  m_max = std::max(m_max, x);
+  //merge the buffer once it holds a few times the centroids kept
+  if (m_bufferMeans.size() >= 5 * (size_t) m_compression) compress();
+}
+
+void zika_tdigest::merge(const zika_tdigest& other)
+{
+  for (unsigned int k = 0; k < other.m_means.size(); k++){
+    add(other.m_means[k], other.m_weights[k]);
+  }
+  for (unsigned int k = 0; k < other.m_bufferMeans.size(); k++){
+    add(other.m_bufferMeans[k], other.m_bufferWeights[k]);
+  }
+}
+
+//scale function k1: a centroid spans at most one unit of
+//k(q) = compression/(2 pi) asin(2q - 1)
+void zika_tdigest::compress()
+{
+  if (m_bufferMeans.empty()) return;
+  const unsigned int n = m_means.size() + m_bufferMeans.size();
+  std::vector<unsigned int> order(n);
+  for (unsigned int k = 0; k < n; k++) order[k] = k;
+  const unsigned int n_old = m_means.size();
+  const std::vector<double> & oldMeans = m_means;
+  const std::vector<double> & bufferMeans = m_bufferMeans;
+  std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+    const double ma = (a < n_old) ? oldMeans[a] : bufferMeans[a - n_old];
+    const double mb = (b < n_old) ? oldMeans[b] : bufferMeans[b - n_old];
+    return ma < mb;
+  });
+
+  const double total = m_weight + m_bufferWeight;
+  const double scale = m_compression / (2. * M_PI);
+  std::vector<double> means, weights;
+  means.reserve(2 * (size_t) m_compression);
+  weights.reserve(2 * (size_t) m_compression);
+  double done = 0.;     //weight of the centroids closed so far
+  double limit = total * (std::sin(std::asin(-1.) + 1. / scale) + 1.) / 2.;
+  for (unsigned int k = 0; k < n; k++){
+    const unsigned int i = order[k];
+    const double m = (i < n_old) ? m_means[i] : m_bufferMeans[i - n_old];
+    const double w = (i < n_old) ? m_weights[i] : m_bufferWeights[i - n_old];
+    if (!means.empty() && done + weights.back() + w <= limit) {
+      //fold into the open centroid
+      weights.back() += w;
+      means.back() += (m - means.back()) * w / weights.back();
+    }
+    else {
+      if (!means.empty()) {
+        done += weights.back();
+        const double q = std::min(done / total, 1.);
+        const double kq = scale * std::asin(2. * q - 1.) + 1.;
+        limit = (kq >= scale * M_PI / 2.) ? total : total * (std::sin(kq / scale) + 1.) / 2.;
+      }
+      means.push_back(m);
+      weights.push_back(w);
+    }
+  }
+  m_means.swap(means);
+  m_weights.swap(weights);
+  m_weight = total;
+  m_bufferMeans.clear();
+  m_bufferWeights.clear();
+  m_bufferWeight = 0.;
+}
+
+double zika_tdigest::quantile(double q, double sigma)
+{
+  compress();
+  const unsigned int n = m_means.size();
+  if (n == 0) return std::numeric_limits<double>::quiet_NaN();
+  q = std::min(std::max(q, 0.), 1.);
+
+  if (sigma > 0.) {
+    //CDF of the mixture, sum_k w_k Phi((x - m_k)/sigma) / W
+    const double lo0 = m_min - 10. * sigma, hi0 = m_max + 10. * sigma;
+    double lo = lo0, hi = hi0;
+    for (unsigned int it = 0; it < 100 && hi - lo > 1.e-12 * (hi0 - lo0); it++){
+      const double x = 0.5 * (lo + hi);
+      double cdf = 0.;
+      for (unsigned int k = 0; k < n; k++){
+        cdf += m_weights[k] * 0.5 * std::erfc((m_means[k] - x) / (sigma * M_SQRT2));
+      }
+      if (cdf / m_weight < q) lo = x;
+      else hi = x;
+    }
+    return 0.5 * (lo + hi);
+  }
+
+  //interpolate between the centroid means, each taken at the middle of its
+  //weight, and between the extremes and the outer centroids
+  const double target = q * m_weight;
+  double cum = 0.;
+  double prevX = m_min, prevCum = 0.;
+  for (unsigned int k = 0; k < n; k++){
+    const double mid = cum + 0.5 * m_weights[k];
+    if (target <= mid) {
+      if (mid == prevCum) return m_means[k];
+      return prevX + (m_means[k] - prevX) * (target - prevCum) / (mid - prevCum);
+    }
+    prevX = m_means[k];
+    prevCum = mid;
+    cum += m_weights[k];
+  }
+  if (m_weight == prevCum) return m_max;
+  return prevX + (m_max - prevX) * (target - prevCum) / (m_weight - prevCum);
+}
+
+//Constructor
+zika_qoi_stats::zika_qoi_stats(unsigned int n_qoi, double compression)
+: m_digests(n_qoi, zika_tdigest(compression))
+{
+}
+
+//Destructor
+zika_qoi_stats::~zika_qoi_stats()
+{
+}
+
+void zika_qoi_stats::add(const double* qois)
+{
+  for (unsigned int i = 0; i < m_digests.size(); i++) m_digests[i].add(qois[i]);
+}
+
+void zika_qoi_stats::pack(std::vector<double>& buffer, std::vector<int>& counts)
+{
+  buffer.clear();
+  counts.resize(m_digests.size());
+  for (unsigned int i = 0; i < m_digests.size(); i++){
+    const std::vector<double> & means = m_digests[i].means();
+    const std::vector<double> & weights = m_digests[i].weights();
+    counts[i] = means.size();
+    for (unsigned int k = 0; k < means.size(); k++){
+      buffer.push_back(means[k]);
+      buffer.push_back(weights[k]);
+    }
+  }
+}
+
+void zika_qoi_stats::unpack(const double* buffer, const int* counts)
+{
+  for (unsigned int i = 0; i < m_digests.size(); i++){
+    for (int k = 0; k < counts[i]; k++){
+      m_digests[i].add(buffer[0], buffer[1]);
+      buffer += 2;
+    }
+  }
+}
+
+void zika_qoi_stats::write(const char* fileName, double sigma)
+{
+  FILE *file = fopen(fileName,"w");
+  if (!file) {
+    printf("WARNING: could not open %s\n", fileName);
+    return;
+  }
+  static const double levels[5] = { 0.5, 0.025, 0.175, 0.825, 0.975 };
+  for (unsigned int i = 0; i < m_digests.size(); i++){
+    for (unsigned int l = 0; l < 5; l++){
+      const double value = std::max(m_digests[i].quantile(levels[l], sigma), 0.);
+      fprintf(file, (l < 4) ? "%.10g " : "%.10g\n", value);
+    }
+  }
+  fclose(file);
+}
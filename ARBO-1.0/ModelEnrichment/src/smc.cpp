@@ -0,0 +1,482 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the sequential Monte Carlo assimilation of the
+ * weekly cases: a resample-move particle filter over the deltas, kept
+ * from one run to the next so that a new week of data only costs one
+ * week of integration per particle.
+ *-----------------------------------------------------------------*/
+
+#include "smc.h"
+#include "dynamics_info.h"
+#include "model.h"
+#include "binfile.h"
+#include "philox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Constructor
+smc_settings::smc_settings()
+:
+  Particles(2000),
+  EssFraction(0.5),
+  Moves(5),
+  Seed(1),
+  State("outputData/smc_state"),
+  Forecast(1),
+  RepFactor(1.)
+{
+}
+
+//Destructor
+smc_settings::~smc_settings()
+{
+}
+
+//Philox streams of the filter: the initial draws of particle p, its moves
+//after the resampling at week k, and the uniform of that resampling
+#define __ZIKA_SMC_INIT_STREAM 0
+#define __ZIKA_SMC_MOVE_STREAM(k) (1 + 2 * (k))
+#define __ZIKA_SMC_RESAMPLE_STREAM(k) (2 + 2 * (k))
+
+//log-likelihood of the cumulative cases C at week j, one term of
+//zikaLogLikelihood
+static double zikaSmcWeek(const likelihoodRoutine_Data& data, unsigned int j, double C)
+{
+  const double diff = C - data.m_csc[j];
+  return -0.5 * diff * diff / data.m_var;
+}
+
+//running misfit of one move, fed week by week by the solve, that stops it
+//once the move is rejected, as zikaLogLikelihoodBounded
+struct smc_monitor
+{
+  const double * Csc;
+  double Var;
+  double MaxMisfit;
+  double Misfit;
+};
+
+static bool zikaSmcObserver(unsigned int i, const double Y[], void* context)
+{
+  smc_monitor & m = *(smc_monitor *) context;
+  const double diff = (Y[7] - m.Csc[i]);
+  m.Misfit += diff * diff / m.Var;
+  return m.Misfit <= m.MaxMisfit;
+}
+
+//effective sample size of n particles of 'width' doubles whose log-weight
+//is at offset 'at', and the log of the sum of their weights
+static double zikaSmcEss(const std::vector<double>& particles, unsigned int n,
+    unsigned int width, unsigned int at, double& logSum)
+{
+  double top = -HUGE_VAL;
+  for (unsigned int p = 0; p < n; p++) top = std::max(top, particles[p * width + at]);
+  if (!(top > -HUGE_VAL)) {
+    logSum = -HUGE_VAL;
+    return 0.;
+  }
+  double sum = 0., sum2 = 0.;
+  for (unsigned int p = 0; p < n; p++){
+    const double w = std::exp(particles[p * width + at] - top);
+    sum += w;
+    sum2 += w * w;
+  }
+  logSum = top + std::log(sum);
+  return sum * sum / sum2;
+}
+
+//systematic resampling: n indices of particles drawn in proportion to
+//their weights, from a single uniform u
+static void zikaSmcResample(const std::vector<double>& particles, unsigned int n,
+    unsigned int width, unsigned int at, double u, std::vector<unsigned int>& index)
+{
+  double logSum;
+  zikaSmcEss(particles, n, width, at, logSum);
+  index.resize(n);
+  double cumulative = 0.;
+  unsigned int p = 0;
+  for (unsigned int k = 0; k < n; k++){
+    const double target = (k + u) / n;
+    while (p < n - 1) {
+      const double w = std::exp(particles[p * width + at] - logSum);
+      if (cumulative + w > target) break;
+      cumulative += w;
+      p++;
+    }
+    index[k] = p;
+  }
+}
+
+//name of the last column of a state file: a hash (FNV-1a) of what its
+//particles were computed from besides the model, the cumulative cases
+//of the n_weeks weeks assimilated, the variance of the data and the seed
+static std::string zikaSmcFingerprint(const likelihoodRoutine_Data& data, unsigned int n_weeks,
+    uint64_t seed)
+{
+  uint64_t hash = 14695981039346656037ull;
+  const unsigned char * bytes = (const unsigned char *) &data.m_csc[0];
+  for (size_t b = 0; b < n_weeks * sizeof(double); b++) hash = (hash ^ bytes[b]) * 1099511628211ull;
+  bytes = (const unsigned char *) &data.m_var;
+  for (size_t b = 0; b < sizeof(double); b++) hash = (hash ^ bytes[b]) * 1099511628211ull;
+  bytes = (const unsigned char *) &seed;
+  for (size_t b = 0; b < sizeof(uint64_t); b++) hash = (hash ^ bytes[b]) * 1099511628211ull;
+  char name[__ZIKA_BIN_NAME];
+  snprintf(name, sizeof(name), "data_%016llx", (unsigned long long) hash);
+  return name;
+}
+
+//reads the particles of a previous run from fileName; returns the weeks
+//they have assimilated, or 0 when there is no such file or it does not
+//match this run: other model or particles, or other data for the weeks
+//it assimilated (revised counts), variance or seed
+static unsigned int zikaSmcRead(const std::string& fileName, unsigned int n_part,
+    unsigned int width, unsigned int dim, unsigned int n_weeks, double rep_factor,
+    const likelihoodRoutine_Data& data, uint64_t seed, std::vector<double>& particles)
+{
+  if (access(fileName.c_str(), R_OK) != 0) return 0;
+  zika_bin_reader reader(fileName.c_str());
+  if (!reader.ok()) return 0;
+  const zika_bin_header & header = reader.header();
+  if (reader.cols() != width + 1 || reader.rows() != n_part || header.Dim != dim ||
+      header.RepFactor != rep_factor || header.NWeeks == 0 || header.NWeeks > n_weeks) {
+    printf("WARNING: %s does not match this run, starting from the prior\n", fileName.c_str());
+    return 0;
+  }
+  if (reader.name(width) != zikaSmcFingerprint(data, header.NWeeks, seed)) {
+    printf("WARNING: %s was assimilated from other data (revised weeks), variance or seed,"
+        " starting from the prior\n", fileName.c_str());
+    return 0;
+  }
+  for (unsigned int c = 0; c < width; c++){
+    const double * column = reader.column(c);
+    for (unsigned int p = 0; p < n_part; p++) particles[p * width + c] = column[p];
+  }
+  return header.NWeeks;
+}
+
+//writes the particles through a temporary file, so that a run that stops
+//while writing leaves the previous state in place; the last column, of
+//zeros, is named by zikaSmcFingerprint
+static void zikaSmcWrite(const std::string& fileName, const std::vector<double>& particles,
+    unsigned int n_part, unsigned int n_params, unsigned int dim, unsigned int n_weeks,
+    double rep_factor, const likelihoodRoutine_Data& data, uint64_t seed)
+{
+  std::vector<std::string> names = zikaParamNames(n_params, NULL);
+  for (unsigned int i = 0; i < dim; i++){
+    std::ostringstream name;
+    name << "Y" << i;
+    names.push_back(name.str());
+  }
+  names.push_back("log_weight");
+  names.push_back("log_likelihood");
+  names.push_back(zikaSmcFingerprint(data, n_weeks, seed));
+  const unsigned int width = names.size() - 1;
+  std::vector<double> rows(n_part * (width + 1), 0.);
+  for (unsigned int p = 0; p < n_part; p++){
+    std::copy(&particles[p * width], &particles[p * width] + width, &rows[p * (width + 1)]);
+  }
+  const std::string temporary = fileName + ".tmp";
+  bool ok;
+  {
+    zika_bin_writer writer(temporary.c_str(), names, n_part, n_weeks, dim, rep_factor);
+    ok = writer.ok() && writer.append(&rows[0], n_part);
+  }
+  if (!ok || std::rename(temporary.c_str(), fileName.c_str()) != 0) {
+    printf("WARNING: could not write %s\n", fileName.c_str());
+  }
+}
+
+//gathers n_local rows of 'cols' values from every process and writes them
+//from process 0 to fileName
+static void zikaSmcGatherWrite(const QUESO::FullEnvironment& env, const char* fileName,
+    const std::vector<std::string>& names, const std::vector<double>& rows,
+    unsigned int n_local, unsigned int n_weeks, unsigned int dim, double rep_factor)
+{
+  const unsigned int rank = env.fullRank();
+  const unsigned int n_procs = env.fullComm().NumProc();
+  std::vector<double> all(rank == 0 ? n_procs * rows.size() : 0);
+  MPI_Gather(const_cast<double*>(&rows[0]), rows.size(), MPI_DOUBLE,
+             rank == 0 ? &all[0] : NULL, rows.size(), MPI_DOUBLE, 0, env.fullComm().Comm());
+  if (rank != 0) return;
+  zika_bin_writer writer(fileName, names, n_procs * n_local, n_weeks, dim, rep_factor);
+  if (!writer.ok() || !writer.append(&all[0], n_procs * n_local)) {
+    printf("WARNING: could not write %s\n", fileName);
+  }
+}
+
+void zikaSolveSmc(
+  const QUESO::FullEnvironment& env,
+  const likelihoodRoutine_Data& data,
+  const std::vector<double>&    paramMin,
+  const std::vector<double>&    paramMax,
+  const smc_settings&           settings,
+  std::vector<double>&          filteredChain)
+{
+  const dynamics_info * dyn = data.m_dynMain;
+  const unsigned int n_params = paramMin.size();
+  const unsigned int dim = dyn->N_s + 1;
+  const unsigned int n_times = dyn->N_times;
+  //the weeks of the data, those after them are only forecast
+  const unsigned int n_weeks = data.m_nObserved;
+  const unsigned int n_part = std::max(settings.Particles, 1u);
+  const unsigned int rank = env.fullRank();
+  const unsigned int n_procs = env.fullComm().NumProc();
+  MPI_Comm comm = env.fullComm().Comm();
+  const std::vector<double> & times = data.m_times;
+
+  //a particle: its deltas, the state at the last week assimilated, its
+  //log-weight and the log-likelihood of the weeks so far
+  const unsigned int width = n_params + dim + 2;
+  const unsigned int at_state = n_params, at_weight = n_params + dim, at_like = at_weight + 1;
+  std::vector<double> particles(n_part * width, 0.);
+
+  std::string stateName;
+  unsigned int done = 0;     //weeks assimilated, the initial one included
+  if (!settings.State.empty()) {
+    std::ostringstream name;
+    name << settings.State << "-" << rank << ".zbin";
+    stateName = name.str();
+    done = zikaSmcRead(stateName, n_part, width, dim, n_weeks, settings.RepFactor, data,
+        settings.Seed, particles);
+  }
+  //every process goes through the same weeks, the status is reduced over
+  //them: start all from the prior unless all their files agree
+  unsigned int doneMin = done, doneMax = done;
+  MPI_Allreduce(&done, &doneMin, 1, MPI_UNSIGNED, MPI_MIN, comm);
+  MPI_Allreduce(&done, &doneMax, 1, MPI_UNSIGNED, MPI_MAX, comm);
+  if (doneMin != doneMax) done = 0;
+  const bool resumed = (done > 0);
+  if (!resumed) {
+    //week 0 is the initial condition, the same for every particle
+    const double initial = zikaSmcWeek(data, 0, data.m_ics[7]);
+    for (unsigned int p = 0; p < n_part; p++){
+      double * q = &particles[p * width];
+      zika_philox rng(settings.Seed, (uint64_t) rank * n_part + p, __ZIKA_SMC_INIT_STREAM);
+      for (unsigned int i = 0; i < n_params; i++){
+        q[i] = paramMin[i] + rng.uniform() * (paramMax[i] - paramMin[i]);
+      }
+      std::copy(data.m_ics.begin(), data.m_ics.begin() + dim, q + at_state);
+      q[at_weight] = 0.;
+      q[at_like] = initial;
+    }
+    done = 1;
+  }
+  const unsigned int first = done;
+
+  mkdir("outputData", 0755);
+  FILE * status = NULL;
+  if (rank == 0) {
+    status = fopen("outputData/sip_smc_status.txt", resumed ? "a" : "w");
+    if (!status) printf("WARNING: could not open outputData/sip_smc_status.txt\n");
+    else if (!resumed) fprintf(status, "# week ess resampled acceptance log_evidence\n");
+  }
+
+  //weeks integrated and moves tried and accepted by this process
+  double counts[3] = { 0., 0., 0. };
+  unsigned int n_resampled = 0;
+  std::vector<double> previous(n_part * width);
+  std::vector<unsigned int> index;
+  for (unsigned int k = first; k < n_weeks; k++){
+    double logBefore;
+    zikaSmcEss(particles, n_part, width, at_weight, logBefore);
+
+    //every particle over week k alone, from its own state
+    const std::vector<double> step(&times[k - 1], &times[k] + 1);
+    #pragma omp parallel
+    {
+      std::vector<double> candidate(n_params + 2, 0.), initial(dim), returnValues(2 * dim);
+      #pragma omp for schedule(dynamic, 16)
+      for (int p = 0; p < (int) n_part; p++){
+        double * q = &particles[p * width];
+        std::copy(q, q + n_params, candidate.begin());
+        std::copy(q + at_state, q + at_state + dim, initial.begin());
+        double increment;
+        try {
+          zikaComputeModel(initial, step, dyn, &candidate[0], returnValues);
+          std::copy(&returnValues[dim], &returnValues[dim] + dim, q + at_state);
+          increment = zikaSmcWeek(data, k, q[at_state + 7]);
+        } catch (const zika_solve_failure & failure) {
+          //as for the samplers; the state is left behind, the weight makes
+          //sure the particle does not survive the next resampling
+          increment = data.m_failureLogLikelihood;
+        }
+        q[at_weight] += increment;
+        q[at_like] += increment;
+      }
+    }
+    counts[0] += n_part;
+
+    double logAfter;
+    const double ess = zikaSmcEss(particles, n_part, width, at_weight, logAfter);
+    double moves[2] = { 0., 0. };
+    const bool resample = (ess < settings.EssFraction * n_part);
+    if (resample) {
+      n_resampled++;
+      //random walk scaled by the spread of the weighted population
+      std::vector<double> scale(n_params, 0.);
+      for (unsigned int i = 0; i < n_params; i++){
+        double mean = 0., square = 0.;
+        for (unsigned int p = 0; p < n_part; p++){
+          const double w = std::exp(particles[p * width + at_weight] - logAfter);
+          const double x = particles[p * width + i];
+          mean += w * x;
+          square += w * x * x;
+        }
+        const double spread = std::sqrt(std::max(square - mean * mean, 0.));
+        scale[i] = std::max(2.38 / std::sqrt((double) n_params) * spread,
+                            1.e-3 * (paramMax[i] - paramMin[i]));
+      }
+
+      zika_philox draw(settings.Seed, rank, __ZIKA_SMC_RESAMPLE_STREAM(k));
+      zikaSmcResample(particles, n_part, width, at_weight, draw.uniform(), index);
+      previous.swap(particles);
+      for (unsigned int p = 0; p < n_part; p++){
+        std::copy(&previous[index[p] * width], &previous[index[p] * width] + width,
+                  &particles[p * width]);
+        particles[p * width + at_weight] = 0.;
+      }
+
+      //rejuvenation: MH moves on the posterior of weeks 0..k, solved from
+      //week 0 and stopped as soon as the move is rejected
+      const std::vector<double> prefix(times.begin(), times.begin() + k + 1);
+      #pragma omp parallel
+      {
+        std::vector<double> candidate(n_params + 2, 0.), returnValues((k + 1) * dim);
+        double local[3] = { 0., 0., 0. };
+        #pragma omp for schedule(dynamic, 4)
+        for (int p = 0; p < (int) n_part; p++){
+          double * q = &particles[p * width];
+          zika_philox rng(settings.Seed, (uint64_t) rank * n_part + p, __ZIKA_SMC_MOVE_STREAM(k));
+          for (unsigned int m = 0; m < settings.Moves; m++){
+            bool inside = true;
+            for (unsigned int i = 0; i < n_params; i++){
+              candidate[i] = q[i] + scale[i] * rng.normal();
+              if (candidate[i] < paramMin[i] || candidate[i] > paramMax[i]) inside = false;
+            }
+            const double threshold = q[at_like] + std::log(rng.uniform());
+            //uniform prior: a candidate outside the box is always rejected
+            if (!inside) continue;
+            local[1] += 1.;
+            smc_monitor monitor = { &data.m_csc[0], data.m_var, -2. * threshold, 0. };
+            unsigned int n_done = 1;
+            try {
+              n_done = zikaComputeModel(data.m_ics, prefix, dyn, &candidate[0], returnValues,
+                  zikaSmcObserver, &monitor);
+            } catch (const zika_solve_failure & failure) {
+              monitor.Misfit = HUGE_VAL;
+            }
+            local[0] += n_done - 1;
+            const double proposed = -0.5 * monitor.Misfit;
+            if (n_done == k + 1 && proposed > threshold) {
+              std::copy(candidate.begin(), candidate.begin() + n_params, q);
+              std::copy(&returnValues[k * dim], &returnValues[k * dim] + dim, q + at_state);
+              q[at_like] = proposed;
+              local[2] += 1.;
+            }
+          }
+        }
+        #pragma omp critical
+        {
+          counts[0] += local[0];
+          moves[0] += local[1];
+          moves[1] += local[2];
+        }
+      }
+      counts[1] += moves[0];
+      counts[2] += moves[1];
+    }
+
+    //one line per week, over all processes: mean ESS per process, the
+    //share of processes that resampled, the acceptance of their moves and
+    //the mean log of the evidence of the new week
+    double line[5] = { ess, resample ? 1. : 0., moves[0], moves[1], logAfter - logBefore };
+    double lineAll[5] = { 0., 0., 0., 0., 0. };
+    MPI_Reduce(line, lineAll, 5, MPI_DOUBLE, MPI_SUM, 0, comm);
+    if (status) {
+      fprintf(status, "%u %.3f %.3f %.4f %.9e\n", k, lineAll[0] / n_procs, lineAll[1] / n_procs,
+          lineAll[2] > 0. ? lineAll[3] / lineAll[2] : 0., lineAll[4] / n_procs);
+      fflush(status);
+    }
+  }
+  if (status) fclose(status);
+
+  if (!stateName.empty()) {
+    zikaSmcWrite(stateName, particles, n_part, n_params, dim, n_weeks, settings.RepFactor,
+        data, settings.Seed);
+  }
+
+  //the posterior at the last week, resampled to equal weights for the SFP
+  zika_philox draw(settings.Seed, rank, __ZIKA_SMC_RESAMPLE_STREAM(n_weeks));
+  zikaSmcResample(particles, n_part, width, at_weight, draw.uniform(), index);
+  filteredChain.resize(n_part * n_params);
+  std::vector<double> rows(n_part * (n_params + 1));
+  for (unsigned int p = 0; p < n_part; p++){
+    const double * q = &particles[index[p] * width];
+    std::copy(q, q + n_params, &filteredChain[p * n_params]);
+    std::copy(q, q + n_params, &rows[p * (n_params + 1)]);
+    rows[p * (n_params + 1) + n_params] = q[at_like];
+  }
+  zikaSmcGatherWrite(env, "outputData/sip_smc_particles.zbin",
+      zikaParamNames(n_params, "log_likelihood"), rows, n_part, n_weeks, dim, settings.RepFactor);
+
+  //forecast: the cumulative cases of every resampled particle from its
+  //state at the last week assimilated to the end of the season
+  if (settings.Forecast && n_weeks < n_times) {
+    const unsigned int n_ahead = n_times - n_weeks + 1;
+    const std::vector<double> ahead(times.begin() + n_weeks - 1, times.end());
+    std::vector<double> forecast(n_part * n_ahead, 0.);
+    #pragma omp parallel
+    {
+      std::vector<double> candidate(n_params + 2, 0.), initial(dim), returnValues(n_ahead * dim);
+      #pragma omp for schedule(dynamic, 16)
+      for (int p = 0; p < (int) n_part; p++){
+        const double * q = &particles[index[p] * width];
+        std::copy(q, q + n_params, candidate.begin());
+        std::copy(q + at_state, q + at_state + dim, initial.begin());
+        try {
+          zikaComputeModel(initial, ahead, dyn, &candidate[0], returnValues);
+          for (unsigned int j = 0; j < n_ahead; j++){
+            forecast[p * n_ahead + j] = returnValues[j * dim + 7];
+          }
+        } catch (const zika_solve_failure & failure) {
+          std::fill(&forecast[p * n_ahead], &forecast[p * n_ahead] + n_ahead, NAN);
+        }
+      }
+    }
+    counts[0] += (double) n_part * (n_ahead - 1);
+    std::vector<std::string> names;
+    for (unsigned int j = 0; j < n_ahead; j++){
+      std::ostringstream name;
+      name << "C_w" << n_weeks - 1 + j;
+      names.push_back(name.str());
+    }
+    zikaSmcGatherWrite(env, "outputData/sip_smc_forecast.zbin", names, forecast, n_part,
+        n_ahead, dim, settings.RepFactor);
+  }
+
+  double countsAll[3] = { 0., 0., 0. };
+  MPI_Reduce(counts, countsAll, 3, MPI_DOUBLE, MPI_SUM, 0, comm);
+  if (rank == 0) {
+    std::cout << "SMC: " << n_procs * n_part << " particles, ";
+    if (first < n_weeks) {
+      std::cout << "weeks " << first << " to " << n_weeks - 1 << " of the data assimilated";
+    }
+    else {
+      std::cout << "no new week of data";
+    }
+    std::cout << (resumed ? " (resumed)" : "") << ", resampled " << n_resampled << " times";
+    if (countsAll[1] > 0.) std::cout << ", move acceptance " << countsAll[2] / countsAll[1];
+    std::cout << "\n  weeks integrated per particle " << countsAll[0] / (n_procs * n_part)
+              << std::endl << std::endl;
+  }
+}
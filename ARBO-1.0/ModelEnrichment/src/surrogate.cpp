@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file: 
+ * 
+ * This file contains the code for the quadratic surrogate of the
+ * log-likelihood used by the delayed-acceptance sampler.
+ *-----------------------------------------------------------------*/
+
+#include "surrogate.h"
+#include <algorithm>
+
+//Constructor
+quadratic_surrogate::quadratic_surrogate(unsigned int n_params)
+: m_params(n_params),
+  m_ready(false),
+  m_anchor(n_params, 0.),
+  m_value(0.),
+  m_gradient(n_params, 0.),
+  m_hessian(n_params * n_params, 0.)
+{
+}
+
+//Destructor
+quadratic_surrogate::~quadratic_surrogate()
+{
+}
+
+void quadratic_surrogate::expand(
+    const double* anchor,
+    double value,
+    const double* gradient,
+    const double* hessian)
+{
+  std::copy(anchor, anchor + m_params, m_anchor.begin());
+  m_value = value;
+  std::copy(gradient, gradient + m_params, m_gradient.begin());
+  std::copy(hessian, hessian + m_params * m_params, m_hessian.begin());
+  m_ready = true;
+}
+
+//L(a) + g.(x-a) + 0.5 (x-a)' H (x-a)
+double quadratic_surrogate::predict(const double* x) const
+{
+  double value = m_value;
+  for (unsigned int i = 0; i < m_params; i++){
+    double hd = 0.;
+    for (unsigned int j = 0; j < m_params; j++){
+      hd += m_hessian[i * m_params + j] * (x[j] - m_anchor[j]);
+    }
+    value += (x[i] - m_anchor[i]) * (m_gradient[i] + 0.5 * hd);
+  }
+  return value;
+}
@@ -0,0 +1,285 @@
+/*-------------------------------------------------------------------
+ * ARBO - Arbovirus Modeling and Uncertainty Quantification Toolbox
+ *-----------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------
+ * Brief description of this file:
+ *
+ * This file contains the sweep over the under-reporting factor and the
+ * variance of the data: the posterior samples of one run, with their
+ * cumulative cases, reweighted to the likelihood of every alternative
+ * instead of sampling it again.
+ *-----------------------------------------------------------------*/
+
+#include "sweep.h"
+#include "dynamics_info.h"
+#include "binfile.h"
+#include "model.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+//Constructor
+sweep_samples::sweep_samples()
+:
+  N(0),
+  RepFactor(1.)
+{
+}
+
+//Destructor
+sweep_samples::~sweep_samples()
+{
+}
+
+void zikaSweepGather(
+  const QUESO::FullEnvironment& env,
+  const std::vector<double>&    filteredChain,
+  unsigned int                  n_params,
+  sweep_samples&                samples)
+{
+  const int n_procs = env.fullComm().NumProc();
+  int length = filteredChain.size();
+  std::vector<int> lengths(n_procs), offsets(n_procs, 0);
+  MPI_Allgather(&length, 1, MPI_INT, &lengths[0], 1, MPI_INT, env.fullComm().Comm());
+  for (int p = 1; p < n_procs; p++) offsets[p] = offsets[p - 1] + lengths[p - 1];
+  const unsigned int total = offsets[n_procs - 1] + lengths[n_procs - 1];
+  samples.N = total / n_params;
+  samples.Deltas.assign(total + 1, 0.);   //never empty, for &[0]
+  MPI_Allgatherv(const_cast<double*>(filteredChain.data()), length, MPI_DOUBLE,
+                 &samples.Deltas[0], &lengths[0], &offsets[0], MPI_DOUBLE,
+                 env.fullComm().Comm());
+  samples.Deltas.resize(total);
+}
+
+void zikaSweepSolve(
+  const QUESO::FullEnvironment& env,
+  const likelihoodRoutine_Data& data,
+  unsigned int                  n_params,
+  double                        rep_factor,
+  sweep_samples&                samples)
+{
+  const int rank = env.fullRank();
+  const int n_procs = env.fullComm().NumProc();
+  const unsigned int n_times = data.m_dynMain->N_times;
+  const unsigned int dim = data.m_dynMain->N_s + 1;
+  const unsigned int N = samples.N;
+
+  //every process fills its rows, the others stay zero and the sums give
+  //all of them to every process
+  std::vector<double> local(N * n_times + 1, 0.);
+  #pragma omp parallel
+  {
+    //the inad_type 3 kernel reads two entries past the deltas
+    std::vector<double> deltas(n_params + 2, 0.), returnValues(n_times * dim);
+    #pragma omp for schedule(dynamic, 16)
+    for (int s = rank; s < (int) N; s += n_procs){
+      std::copy(&samples.Deltas[s * n_params], &samples.Deltas[s * n_params] + n_params,
+                deltas.begin());
+      //all N_times weeks, the forecast after the data included
+      bool failed = false;
+      try
+        {
+          zikaComputeModel(data.m_ics, data.m_times, data.m_dynMain, &deltas[0], returnValues);
+        } catch( const zika_solve_failure & failure )
+        {
+          failed = true;
+        }
+      for (unsigned int j = 0; j < n_times; j++){
+        local[s * n_times + j] = failed ? NAN : returnValues[dim * j + 7];
+      }
+    }
+  }
+  std::vector<double> all(local.size());
+  MPI_Allreduce(&local[0], &all[0], local.size(), MPI_DOUBLE, MPI_SUM, env.fullComm().Comm());
+  samples.RepFactor = rep_factor;
+  samples.Cases.assign(all.begin(), all.begin() + N * n_times);
+  //over the observed weeks, as zikaLogLikelihood
+  zikaSweepLogLikelihood(data, samples, samples.LogLikelihood);
+}
+
+void zikaSweepLogLikelihood(
+  const likelihoodRoutine_Data& data,
+  const sweep_samples&          samples,
+  std::vector<double>&          logLikelihood)
+{
+  const unsigned int n_times = data.m_csc.size();
+  logLikelihood.resize(samples.N);
+  for (unsigned int s = 0; s < samples.N; s++){
+    //the misfit of zikaLogLikelihood, over the observed weeks only
+    double misfitValue = 0.;
+    for (unsigned int j = 0; j < data.m_nObserved; j++){
+      const double diff = samples.Cases[s * n_times + j] - data.m_csc[j];
+      misfitValue += diff * diff / data.m_var;
+    }
+    logLikelihood[s] = std::isfinite(misfitValue) ? -0.5 * misfitValue : data.m_failureLogLikelihood;
+  }
+}
+
+void zikaSweepWrite(
+  const QUESO::FullEnvironment& env,
+  const char*                   fileName,
+  const sweep_samples&          samples,
+  unsigned int                  n_params,
+  unsigned int                  n_weeks,
+  unsigned int                  dim)
+{
+  if (env.fullRank() != 0) return;
+  std::vector<std::string> names = zikaParamNames(n_params, "log_likelihood");
+  for (unsigned int j = 0; j < n_weeks; j++){
+    std::ostringstream name;
+    name << "C_w" << j;
+    names.push_back(name.str());
+  }
+  const unsigned int width = names.size();
+  std::vector<double> rows(samples.N * width);
+  for (unsigned int s = 0; s < samples.N; s++){
+    double * row = &rows[s * width];
+    std::copy(&samples.Deltas[s * n_params], &samples.Deltas[s * n_params] + n_params, row);
+    row[n_params] = samples.LogLikelihood[s];
+    std::copy(&samples.Cases[s * n_weeks], &samples.Cases[s * n_weeks] + n_weeks,
+              row + n_params + 1);
+  }
+  zika_bin_writer writer(fileName, names, samples.N, n_weeks, dim, samples.RepFactor);
+  if (!writer.ok() || (samples.N && !writer.append(&rows[0], samples.N))) {
+    printf("WARNING: could not write %s\n", fileName);
+  }
+}
+
+bool zikaSweepRead(
+  const char*                   fileName,
+  unsigned int                  n_params,
+  unsigned int                  n_weeks,
+  sweep_samples&                samples)
+{
+  if (access(fileName, R_OK) != 0) return false;
+  zika_bin_reader reader(fileName);
+  if (!reader.ok()) return false;
+  if (reader.cols() != n_params + 1 + n_weeks || reader.header().NWeeks != n_weeks ||
+      reader.rows() == 0 || reader.name(n_params) != "log_likelihood") {
+    printf("WARNING: %s does not match this run, sampling again\n", fileName);
+    return false;
+  }
+  const unsigned int N = reader.rows();
+  samples.N = N;
+  samples.RepFactor = reader.header().RepFactor;
+  samples.Deltas.resize(N * n_params);
+  samples.LogLikelihood.assign(reader.column(n_params), reader.column(n_params) + N);
+  samples.Cases.resize(N * n_weeks);
+  for (unsigned int p = 0; p < n_params; p++){
+    const double * column = reader.column(p);
+    for (unsigned int s = 0; s < N; s++) samples.Deltas[s * n_params + p] = column[s];
+  }
+  for (unsigned int j = 0; j < n_weeks; j++){
+    const double * column = reader.column(n_params + 1 + j);
+    for (unsigned int s = 0; s < N; s++) samples.Cases[s * n_weeks + j] = column[s];
+  }
+  return true;
+}
+
+double zikaSweepWeights(
+  const std::vector<double>&    logWeights,
+  const sweep_samples&          samples,
+  std::vector<double>&          weights)
+{
+  const unsigned int N = samples.N;
+  const unsigned int n_weeks = N ? samples.Cases.size() / N : 0;
+  weights.assign(N, 0.);
+  double top = -HUGE_VAL;
+  for (unsigned int s = 0; s < N; s++){
+    if (std::isfinite(samples.Cases[s * n_weeks + n_weeks - 1])) top = std::max(top, logWeights[s]);
+  }
+  if (!std::isfinite(top)) return 0.;
+  double sum = 0., sum2 = 0.;
+  for (unsigned int s = 0; s < N; s++){
+    if (!std::isfinite(samples.Cases[s * n_weeks + n_weeks - 1])) continue;
+    weights[s] = std::exp(logWeights[s] - top);
+    sum += weights[s];
+  }
+  for (unsigned int s = 0; s < N; s++){
+    weights[s] /= sum;
+    sum2 += weights[s] * weights[s];
+  }
+  return 1. / sum2;
+}
+
+//fraction of the weight of the samples whose cases plus N(0, sigma^2)
+//noise fall below x at week j
+static double zikaSweepCdf(const sweep_samples& samples, const std::vector<double>& weights,
+    unsigned int j, double sigma, double x)
+{
+  const unsigned int n_weeks = samples.Cases.size() / samples.N;
+  double F = 0.;
+  for (unsigned int s = 0; s < samples.N; s++){
+    if (weights[s] == 0.) continue;
+    F += weights[s] * 0.5 * std::erfc((samples.Cases[s * n_weeks + j] - x) / (sigma * M_SQRT2));
+  }
+  return F;
+}
+
+void zikaSweepReport(
+  FILE*                         summary,
+  const char*                   casesName,
+  const likelihoodRoutine_Data& data,
+  double                        rep_factor,
+  double                        ess,
+  bool                          resampled,
+  const sweep_samples&          samples,
+  const std::vector<double>&    weights,
+  unsigned int                  n_params)
+{
+  if (data.m_env->fullRank() != 0) return;
+  const unsigned int N = samples.N;
+  const unsigned int n_weeks = data.m_csc.size();
+  const double sigma = std::sqrt(data.m_var);
+
+  if (summary) {
+    fprintf(summary, "%.10g %.10g %.1f %u %d", rep_factor, data.m_var, ess, N, (int) resampled);
+    for (unsigned int p = 0; p < n_params; p++){
+      double mean = 0., mean2 = 0.;
+      for (unsigned int s = 0; s < N; s++){
+        mean += weights[s] * samples.Deltas[s * n_params + p];
+        mean2 += weights[s] * samples.Deltas[s * n_params + p] * samples.Deltas[s * n_params + p];
+      }
+      fprintf(summary, " %.10g %.10g", mean, std::sqrt(std::max(mean2 - mean * mean, 0.)));
+    }
+    fprintf(summary, "\n");
+    fflush(summary);
+  }
+
+  FILE * file = fopen(casesName, "w");
+  if (!file) {
+    printf("WARNING: could not open %s\n", casesName);
+    return;
+  }
+  fprintf(file, "# rep_factor = %.10g, var = %.10g, ESS = %.1f of %u samples, %s\n",
+      rep_factor, data.m_var, ess, N, resampled ? "sampled again" : "reweighted");
+  fprintf(file, "# week data mean 50%% 2.5%% 17.5%% 82.5%% 97.5%%\n");
+  static const double levels[5] = { 0.5, 0.025, 0.175, 0.825, 0.975 };
+  for (unsigned int j = 0; j < n_weeks; j++){
+    double mean = 0., lo = HUGE_VAL, hi = -HUGE_VAL;
+    for (unsigned int s = 0; s < N; s++){
+      if (weights[s] == 0.) continue;
+      const double C = samples.Cases[s * n_weeks + j];
+      mean += weights[s] * C;
+      lo = std::min(lo, C);
+      hi = std::max(hi, C);
+    }
+    //the weeks after the data are forecast, with no data to show
+    fprintf(file, "%u %.10g %.10g", j, j < data.m_nObserved ? data.m_csc[j] : NAN, mean);
+    //the percentiles of the mixture, by bisection
+    for (unsigned int l = 0; l < 5; l++){
+      double a = lo - 8. * sigma, b = hi + 8. * sigma;
+      for (unsigned int it = 0; it < 60 && b - a > 1.e-9 * (std::abs(a) + std::abs(b)); it++){
+        const double x = 0.5 * (a + b);
+        if (zikaSweepCdf(samples, weights, j, sigma, x) < levels[l]) a = x;
+        else b = x;
+      }
+      fprintf(file, " %.10g", std::max(0.5 * (a + b), 0.));
+    }
+    fprintf(file, "\n");
+  }
+  fclose(file);
+}